@@ -0,0 +1,21 @@
+#include <iostream>
+#include "tool/ShardMerge.h"
+
+/**
+ * Merges the feature files written by the shards of an experiment, in shard order:
+ * MergeShards <output file> <shard 0 file> <shard 1 file> ...
+ */
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <output file> <shard 0 file> [<shard 1 file> ...]" << std::endl;
+		return 1;
+	}
+
+	std::vector<std::string> shard_files(argv + 2, argv + argc);
+	tool::merge_shards(shard_files, argv[1]);
+
+	std::cout << "Merged " << shard_files.size() << " shards in " << argv[1] << std::endl;
+	return 0;
+}
@@ -17,7 +17,7 @@
 #include "process/SaveFeatures.h"
 #include "process/SimplePreprocessing.h"
 #include "process/OrientationAmplitude.h"
-#include "process/MaxScaling.h"
+#include "process/InputStage.h"
 #include "process/CompositeChannels.h"
 #include "process/OnOffFilter.h"
 #include "process/OnOffTempFilter.h"
@@ -45,6 +45,11 @@ int main(int argc, char **argv)
 	//{
 		std::string _dataset = "DVS_128";
 		const char *input_path_ptr = std::getenv("INPUT_INDEX");
+		// Optional reduction of the samples while they are read, e.g. SPATIAL_FACTOR=2 gives 64x64 frames.
+		const char *spatial_factor_ptr = std::getenv("SPATIAL_FACTOR");
+		const char *temporal_factor_ptr = std::getenv("TEMPORAL_FACTOR");
+		size_t spatial_factor = spatial_factor_ptr == nullptr ? 1 : std::stoul(spatial_factor_ptr);
+		size_t temporal_factor = temporal_factor_ptr == nullptr ? 1 : std::stoul(temporal_factor_ptr);
 
 		Experiment<SparseIntermediateExecutionNew> experiment(argc, argv, _dataset, false, false);
 
@@ -59,31 +64,30 @@ int main(int argc, char **argv)
 		//size_t filter_number = 64;
 		//size_t sampling_size = 655; //(_frame_size_height * _frame_size_width) / (filter_size * filter_size);
 
-		experiment.push<process::MaxScaling>(); 
+		// Same scaling as MaxScaling (division by 255) in a single in-place pass, INPUT_STAGE_LATENCY_CODING would also code the frames.
+		experiment.push<process::InputStage>(INPUT_STAGE_SCALING, 255.0f);
 		//experiment.push<process::DefaultOnOffFilter>(7, 1.0, 4.0); 
 
 
 		//std::string input_index(input_path_ptr);
 
-		//experiment.push<LatencyCoding>();
-
 		// The location of the dataset Videos, seperated into train and test folders that contain labeled folders of videos.
 		if (input_path_ptr == nullptr)
 			throw std::runtime_error("Require to define INPUT_INDEX 1,2 or 3 variable");
 		else if (strcmp(input_path_ptr, "1")==0)
 		{	
-			experiment.add_train<dataset::SpikingVideo>("/home/gzhang/npydataset/train_data_frames_number.npy","/home/gzhang/npydataset/train_label_frames_number.npy");
-			experiment.add_test<dataset::SpikingVideo>("/home/gzhang/npydataset/test_data_frames_number.npy","/home/gzhang/npydataset/test_label_frames_number.npy");
+			experiment.add_train<dataset::SpikingVideo>("/home/gzhang/npydataset/train_data_frames_number.npy","/home/gzhang/npydataset/train_label_frames_number.npy", spatial_factor, temporal_factor);
+			experiment.add_test<dataset::SpikingVideo>("/home/gzhang/npydataset/test_data_frames_number.npy","/home/gzhang/npydataset/test_label_frames_number.npy", spatial_factor, temporal_factor);
 		}
 		else if (strcmp(input_path_ptr, "2")==0)
 		{
-			experiment.add_train<dataset::SpikingVideo>("/home/gzhang/npydataset/train_data_frames_time.npy","/home/gzhang/npydataset/train_label_frames_time.npy");
-			experiment.add_test<dataset::SpikingVideo>("/home/gzhang/npydataset/test_data_frames_time.npy","/home/gzhang/npydataset/test_label_frames_time.npy");
+			experiment.add_train<dataset::SpikingVideo>("/home/gzhang/npydataset/train_data_frames_time.npy","/home/gzhang/npydataset/train_label_frames_time.npy", spatial_factor, temporal_factor);
+			experiment.add_test<dataset::SpikingVideo>("/home/gzhang/npydataset/test_data_frames_time.npy","/home/gzhang/npydataset/test_label_frames_time.npy", spatial_factor, temporal_factor);
 		}
 		else if (strcmp(input_path_ptr, "3")==0)
 		{
-			experiment.add_train<dataset::SpikingVideo>("/home/gzhang/npydataset/train_data_frames_fixed_duration.npy","/home/gzhang/npydataset/train_label_frames_fixed_duration.npy");
-			experiment.add_test<dataset::SpikingVideo>("/home/gzhang/npydataset/test_data_frames_fixed_duration.npy","/home/gzhang/npydataset/test_label_frames_fixed_duration.npy");
+			experiment.add_train<dataset::SpikingVideo>("/home/gzhang/npydataset/train_data_frames_fixed_duration.npy","/home/gzhang/npydataset/train_label_frames_fixed_duration.npy", spatial_factor, temporal_factor);
+			experiment.add_test<dataset::SpikingVideo>("/home/gzhang/npydataset/test_data_frames_fixed_duration.npy","/home/gzhang/npydataset/test_label_frames_fixed_duration.npy", spatial_factor, temporal_factor);
 		}
 		else
 			throw std::runtime_error("INPUT_INDEX faulte");
@@ -0,0 +1,12 @@
+#ifndef _DISK_CACHE_H
+#define _DISK_CACHE_H
+
+#include <string>
+
+/**
+ * @brief Counts size bytes in the cache folder directory, false if its files would exceed limit bytes.
+ * The folder is measured by the first call of the run, the count is then shared by all the caches and threads of the run that use this folder.
+ */
+bool reserve_disk_cache(const std::string &directory, size_t size, size_t limit);
+
+#endif
@@ -20,6 +20,7 @@
 #include "InputLayer.h"
 #include "Logger.h"
 #include "Monitor.h"
+#include "Philox.h"
 
 class AbstractExperiment
 {
@@ -45,17 +46,24 @@ public:
 	}
 
 	template <typename T, typename... Args>
-	void add_train(Args &&...args)
+	T &add_train(Args &&...args)
 	{
-		_train_data.push_back(new T(std::forward<Args>(args)...));
-		_check_data_shape(_train_data.back()->shape());
+		T *input = new T(std::forward<Args>(args)...);
+		_train_data.push_back(input);
+		_check_data_shape(input->shape());
+		return *input;
 	}
 
+	/**
+	 * @brief Adds a test input, the returned reference allows to restrict it to a shard with Input::shard().
+	 */
 	template <typename T, typename... Args>
-	void add_test(Args &&...args)
+	T &add_test(Args &&...args)
 	{
-		_test_data.push_back(new T(std::forward<Args>(args)...));
-		_check_data_shape(_test_data.back()->shape());
+		T *input = new T(std::forward<Args>(args)...);
+		_test_data.push_back(input);
+		_check_data_shape(input->shape());
+		return *input;
 	}
 
 	template <typename T, typename... Args>
@@ -122,6 +130,12 @@ public:
 	OutputStream &print() const;
 
 	std::default_random_engine &random_generator();
+	/**
+	 * @brief Counter-based random stream of a process, keyed by the experiment name.
+	 * Two calls with the same (stream, epoch, sample) return the same numbers whatever the order of the calls,
+	 * so that samples can be processed in parallel with the same results as a serial run.
+	 */
+	Philox random_stream(size_t stream, size_t epoch = 0, size_t sample = 0) const;
 	/*
 	InputLayer& input_layer();
 	const InputLayer& input_layer() const;
@@ -163,6 +177,7 @@ protected:
 #endif
 
 	std::ostream &_print_date(std::ostream &stream) const;
+	std::default_random_engine _stream_generator(size_t stream) const;
 
 	void _save(const std::string &filename) const;
 	void _load(const std::string &filename);
@@ -178,6 +193,7 @@ protected:
 
 	std::string _name;
 	std::default_random_engine _random_generator;
+	uint64_t _seed;
 
 	//std::vector<Process*> _preprocessing;
 
@@ -0,0 +1,121 @@
+#ifndef _FEATURE_STORE_H
+#define _FEATURE_STORE_H
+
+#include <fstream>
+#include <map>
+
+#include "Input.h"
+#include "SparseTensor.h"
+
+#define FEATURE_STORE_MAGIC 0x53464E43
+#define FEATURE_STORE_VERSION 1
+#define FEATURE_STORE_VARINT_INDICES 0x1
+#define FEATURE_STORE_FLOAT32 0
+#define FEATURE_STORE_CHUNK_SIZE (1 << 20)
+
+/**
+ * @brief Binary file of labeled sparse tensors, used to save the features instead of the JSON dumps.
+ *
+ * Layout (little endian):
+ * - header: magic, version, flags, dtype, dimension number, dimensions (uint32), sample count (uint64), label table offset (uint64)
+ * - chunks of about FEATURE_STORE_CHUNK_SIZE bytes: sample number (uint32), byte size (uint32), then for each sample
+ *   the label id (uint32), the default value (float), the number of values (uint32), the indices and the values
+ * - label table: label number (uint32), then the length (uint16) and the characters of each label
+ *
+ * With the varint flag, the indices are stored as variable length deltas (7 bits per byte) instead of uint32, the values are always raw floats.
+ * The sample count and the label table offset are written by close().
+ * append() reopens a closed store and writes the new samples over its label table, which is written again, larger, by close().
+ */
+class FeatureStoreWriter {
+
+public:
+	FeatureStoreWriter();
+	FeatureStoreWriter(const std::string& filename, const Shape& shape, bool varint_indices = true);
+	~FeatureStoreWriter();
+
+	FeatureStoreWriter(const FeatureStoreWriter& that) = delete;
+	FeatureStoreWriter& operator=(const FeatureStoreWriter& that) = delete;
+
+	void open(const std::string& filename, const Shape& shape, bool varint_indices = true);
+	/**
+	 * @brief Opens a store to add samples after the ones it already has, the file is created if it does not exist.
+	 * The samples are encoded like the ones already in the store, varint_indices is only used for a new file.
+	 */
+	void append(const std::string& filename, const Shape& shape, bool varint_indices = true);
+	void write(const std::string& label, const SparseTensor<float>& t);
+	void write(const std::string& label, const Tensor<float>& t);
+	void close();
+
+	bool is_open() const;
+
+private:
+	void _flush_chunk();
+
+	std::fstream _file;
+	Shape _shape;
+	bool _varint_indices;
+	uint64_t _sample_count;
+	std::map<std::string, uint32_t> _labels;
+	std::vector<std::string> _label_table;
+	std::vector<char> _chunk;
+	uint32_t _chunk_sample_count;
+	std::streampos _count_position;
+};
+
+class FeatureStoreReader : public Input {
+
+public:
+	FeatureStoreReader();
+	FeatureStoreReader(const std::string& filename);
+	~FeatureStoreReader();
+
+	void open(const std::string& filename);
+
+	/**
+	 * @brief Returns true if the file starts with the feature store magic number.
+	 */
+	static bool is_feature_store(const std::string& filename);
+
+	virtual bool has_next() const;
+	virtual std::pair<std::string, Tensor<InputType>> next();
+	std::pair<std::string, SparseTensor<float>> next_sparse();
+
+	virtual void reset();
+	virtual void close();
+
+	size_t size() const;
+	virtual std::string to_string() const;
+
+	virtual const Shape& shape() const;
+	const std::vector<std::string>& labels() const;
+	bool varint_indices() const;
+
+private:
+	void _read_chunk();
+
+	std::string _name;
+	std::ifstream _file;
+	Shape _shape;
+	bool _varint_indices;
+	uint64_t _sample_count;
+	uint64_t _cursor;
+	std::vector<std::string> _label_table;
+	std::streampos _data_position;
+
+	std::vector<char> _chunk;
+	size_t _chunk_cursor;
+	uint32_t _chunk_remaining;
+};
+
+/**
+ * @brief Writes a vector of labeled sparse tensors in a feature store file, the file is truncated.
+ * An empty vector gives a store with no sample and an empty shape.
+ */
+void SaveFeatureStore(const std::string& filename, const std::vector<std::pair<std::string, SparseTensor<float>>>& data, bool varint_indices = true);
+
+/**
+ * @brief Appends the samples of a feature store file to output as dense tensors.
+ */
+void LoadFeatureStore(const std::string& filename, std::vector<std::pair<std::string, Tensor<float>>>& output);
+
+#endif
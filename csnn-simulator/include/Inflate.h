@@ -0,0 +1,21 @@
+#ifndef _INFLATE_H
+#define _INFLATE_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Decompresses a raw DEFLATE stream (RFC 1951), as stored in the members of a zip archive.
+ * The decompressed size has to be known, it is given by the zip directory.
+ * Throws std::runtime_error if the stream is invalid or doesn't match the expected size.
+ *
+ * The build has no zlib, this covers what is needed to read the .npz archives written by numpy.savez_compressed.
+ */
+void inflate_raw(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size);
+
+/**
+ * @brief CRC-32 (ISO 3309) of a buffer, used to check the zip members.
+ */
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <string>
 #include "Tensor.h"
+#include "SparseTensor.h"
 
 typedef float InputType;
 
@@ -21,11 +22,39 @@ public:
 
 	virtual bool has_next() const = 0;
 	virtual std::pair<std::string, Tensor<InputType>> next() = 0;
+
+	/**
+	 * @brief Next sample in the representation of the sparse executions. The inputs that produce few values can override it
+	 * to build the sparse tensor directly, without the dense tensor of next().
+	 */
+	virtual std::pair<std::string, SparseTensor<InputType>> next_sparse() {
+		std::pair<std::string, Tensor<InputType>> entry = next();
+		return std::make_pair(entry.first, to_sparse_tensor(entry.second));
+	}
 	virtual void reset() = 0;
 	virtual void close() = 0;
 
 	virtual std::string to_string() const = 0;
 
+	/**
+	 * @brief Restricts the input to one shard out of number, so that several processes can each read a part of the dataset.
+	 * The shards are contiguous ranges of samples, the outputs of the shards concatenated in shard order are in the original order.
+	 *
+	 * @param index the shard of this process, in [0, number).
+	 * @param number the number of shards.
+	 */
+	virtual void shard(size_t, size_t) {
+		throw std::runtime_error("Sharding is not supported by "+to_string());
+	}
+
+protected:
+	static std::pair<size_t, size_t> shard_range(size_t size, size_t index, size_t number) {
+		if(number == 0 || index >= number) {
+			throw std::runtime_error("Invalid shard "+std::to_string(index)+"/"+std::to_string(number));
+		}
+		return std::make_pair(size*index/number, size*(index+1)/number);
+	}
+
 };
 
 #endif
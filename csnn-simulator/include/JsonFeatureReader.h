@@ -0,0 +1,77 @@
+#ifndef _JSON_FEATURE_READER_H
+#define _JSON_FEATURE_READER_H
+
+#include <fstream>
+
+#include "Input.h"
+#include "SparseTensor.h"
+
+#define JSON_FEATURE_READER_BUFFER_SIZE (1 << 16)
+
+/**
+ * @brief Streaming reader of the legacy JSON feature files written by SavePairVector and SaveFeature.
+ *
+ * The file is a top-level array of objects {"label": ..., "dim_0": ..., "dim_n": ..., "data": [...]}.
+ * Instead of loading the whole document, the file is scanned through a fixed size buffer and only one sample object is parsed at a time,
+ * so the memory used does not depend on the number of samples. The data can also be a string holding the values, as in the oldest dumps.
+ * Unknown keys are skipped. Numbers are parsed with std::from_chars, which does not depend on the locale.
+ *
+ * The sample following the current one is parsed in advance, so that has_next() and shape() are known without reading further.
+ */
+class JsonFeatureReader : public Input {
+
+public:
+	JsonFeatureReader();
+	JsonFeatureReader(const std::string& filename);
+	~JsonFeatureReader();
+
+	JsonFeatureReader(const JsonFeatureReader& that) = delete;
+	JsonFeatureReader& operator=(const JsonFeatureReader& that) = delete;
+
+	void open(const std::string& filename);
+
+	virtual bool has_next() const;
+	virtual std::pair<std::string, Tensor<InputType>> next();
+	std::pair<std::string, SparseTensor<float>> next_sparse();
+
+	virtual void reset();
+	virtual void close();
+
+	virtual std::string to_string() const;
+
+	/**
+	 * @brief Shape of the first sample of the file.
+	 */
+	virtual const Shape& shape() const;
+
+private:
+	int _get();
+	int _peek();
+	int _skip_whitespace();
+	void _expect(char c);
+
+	void _parse_sample();
+	void _parse_string(std::string& out);
+	void _parse_number(float& out);
+	void _parse_data_array();
+	void _parse_data_string();
+	void _skip_value();
+	void _start();
+
+	std::string _name;
+	std::ifstream _file;
+	Shape _shape;
+
+	std::vector<char> _buffer;
+	size_t _buffer_cursor;
+	size_t _buffer_size;
+
+	bool _has_next;
+	bool _last; // the array ends after the parsed sample
+	std::string _label;
+	std::vector<size_t> _dims;
+	std::vector<float> _values;
+	std::string _token;
+};
+
+#endif
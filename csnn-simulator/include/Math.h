@@ -30,23 +30,62 @@ Tensor<float> operator*(const Tensor<float>& lhs, const Tensor<float>& rhs);
 Tensor<float> div(const Tensor<float>& lhs, const Tensor<float>& rhs);
 Tensor<float> operator/(const Tensor<float>& lhs, const Tensor<float>& rhs);
 
+/**
+ * @brief Element-wise operations written in out, which can be lhs or rhs to work in place. out is allocated if its shape is different.
+ */
+void add(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out);
+void sub(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out);
+void mul(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out);
+void div(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out);
+
+/**
+ * @brief The operators on a temporary reuse its values for the result.
+ */
+Tensor<float> operator+(Tensor<float>&& lhs, const Tensor<float>& rhs);
+Tensor<float> operator-(Tensor<float>&& lhs, const Tensor<float>& rhs);
+Tensor<float> operator*(Tensor<float>&& lhs, const Tensor<float>& rhs);
+Tensor<float> operator/(Tensor<float>&& lhs, const Tensor<float>& rhs);
+
 Tensor<float> sqrt(const Tensor<float>& in);
+Tensor<float> sqrt(Tensor<float>&& in);
 Tensor<float> diag(const Tensor<float>& in);
 
 Tensor<float> dot(const Tensor<float>& lhs, const Tensor<float>& rhs, size_t n = 1);
 
+/**
+ * @brief alpha*dot(lhs, transpose(rhs)) of two matrices, without the transposed copy.
+ * dot_transpose(x, x, 1.0/n) is the covariance of the centered columns of x.
+ */
+Tensor<float> dot_transpose(const Tensor<float>& lhs, const Tensor<float>& rhs, float alpha = 1.0);
+
 Tensor<float> sep_sign(const Tensor<float>& in);
 
 Tensor<float> reshape(const Tensor<float>& in, const Shape& new_shape);
 Tensor<float> flatten(const Tensor<float>& in);
 
+/**
+ * @brief Reshape of a temporary, which keeps its values without copy.
+ */
+Tensor<float> reshape(Tensor<float>&& in, const Shape& new_shape);
+Tensor<float> flatten(Tensor<float>&& in);
+
 Tensor<float> create(float value, const Shape& shape);
 float mean(const Tensor<float>& in);
 Tensor<float> mean1(const Tensor<float>& in);
 
 Tensor<float> expand_in(const Tensor<float>& in, const Shape& new_dims);
 
+/**
+ * @brief out = out-expand_in(in, ...) in place, out has the dimensions of in followed by the expanded ones.
+ * Centers the rows of a matrix with sub_expand_in(x, mean1(x)).
+ */
+void sub_expand_in(Tensor<float>& out, const Tensor<float>& in);
+
+/**
+ * @brief Transpose of a matrix by cache blocks, in several threads for the large matrices.
+ */
 Tensor<float> transpose(const Tensor<float>& in);
+void transpose(const Tensor<float>& in, Tensor<float>& out);
 Tensor<float> scale(const Tensor<float>& in, float min = 0.0, float max = 1.0);
 
 void debug_tensor(const Tensor<float>& in, const std::string& name);
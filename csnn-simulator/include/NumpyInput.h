@@ -4,6 +4,10 @@
 #include "Input.h"
 #include "NumpyReader.h"
 
+/**
+ * @brief Reads the samples of a .npz archive holding a 4-dimension data array (arr_0.npy) and a label array (arr_1.npy).
+ * The data array is not converted at load time, each sample is converted when next() is called.
+ */
 class NumpyInput : public Input {
 
 public:
@@ -15,6 +19,7 @@ public:
 	virtual std::pair<std::string, Tensor<InputType>> next();
 	virtual void reset();
 	virtual void close();
+	virtual void shard(size_t index, size_t number);
 
 	virtual std::string to_string() const;
 
@@ -22,11 +27,14 @@ public:
 
 private:
 	std::string _name;
-	NumpyArchive _archive;
-	NumpyArray* _data;
-	NumpyArray* _label;
+	NumpyLazyArchive _archive;
+	const NumpyLazyArray* _data;
+	NumpyArray _label;
+	Shape _shape;
 
 	size_t _current;
+	size_t _begin;
+	size_t _end;
 };
 
 #endif
@@ -4,151 +4,145 @@
 #include <iostream>
 #include "NumpyStruct.h"
 
+#define ZIP_END_OF_DIRECTORY_MAGIC 0x06054b50
+#define ZIP64_END_OF_DIRECTORY_MAGIC 0x06064b50
+#define ZIP64_END_OF_DIRECTORY_LOCATOR_MAGIC 0x07064b50
 
-class NumpyReader {
+#define ZIP_STORED 0
+#define ZIP_DEFLATED 8
 
-public:
-	NumpyReader() = delete;
+/**
+ * @brief An array of a numpy file or archive whose values are converted only when they are read.
+ *
+ * The members stored without compression stay in the file and each slice is read on demand,
+ * the deflated members are kept decompressed in their original data type, which is smaller than the double of NumpyArray.
+ * Reading a slice is not thread safe for the members that stay in the file.
+ */
+class NumpyLazyArray {
 
-	static void load(const std::string& filename, NumpyArchive& archive) {
-		std::ifstream file(filename, std::ios::in | std::ios::binary);
+	friend class NumpyReader;
 
-		if(!file) {
-			throw std::runtime_error("Unable to open "+filename);
-		}
+public:
+	NumpyLazyArray();
 
-		while(read_zip(file, archive));
+	NumpyLazyArray(const NumpyLazyArray& that) = delete;
+	NumpyLazyArray& operator=(const NumpyLazyArray& that) = delete;
+	NumpyLazyArray(NumpyLazyArray&& that) = default;
+	NumpyLazyArray& operator=(NumpyLazyArray&& that) = default;
 
-		file.close();
+	size_t dimension_number() const {
+		return _dimension.size();
 	}
 
-	static NumpyArray load(const std::string& filename) {
-		std::ifstream file(filename, std::ios::in | std::ios::binary);
-
-		if(!file) {
-			throw std::runtime_error("Unable to open "+filename);
-		}
-
-		return read_npy_array(file);
+	size_t dimension(size_t index) const {
+		return _dimension.at(index);
 	}
 
+	const std::vector<size_t>& dimensions() const {
+		return _dimension;
+	}
 
-private:
-	static bool read_zip(std::ifstream& file, NumpyArchive& archive) {
-		uint32_t magic;
-		file.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
-		magic = LittleEndian::convert(magic);
-
-		if(magic == ZIP_FILE_MAGIC) {
-			uint16_t min_version;
-			uint16_t general_flag;
-			uint16_t compression_method;
-			uint16_t last_modification_time;
-			uint16_t last_modification_date;
-			uint32_t crc;
-			uint32_t compressed_size;
-			uint32_t uncompressed_size;
-
-			file.read(reinterpret_cast<char*>(&min_version), sizeof(uint16_t));
-			min_version = LittleEndian::convert(min_version);
-
-			file.read(reinterpret_cast<char*>(&general_flag), sizeof(uint16_t));
-			general_flag = LittleEndian::convert(general_flag);
-
-			file.read(reinterpret_cast<char*>(&compression_method), sizeof(uint16_t));
-			compression_method = LittleEndian::convert(compression_method);
-
-			file.read(reinterpret_cast<char*>(&last_modification_time), sizeof(uint16_t));
-			last_modification_time = LittleEndian::convert(last_modification_time);
-
-			file.read(reinterpret_cast<char*>(&last_modification_date), sizeof(uint16_t));
-			last_modification_date = LittleEndian::convert(last_modification_date);
-
-			file.read(reinterpret_cast<char*>(&crc), sizeof(uint32_t));
-			crc = LittleEndian::convert(crc);
-
-			file.read(reinterpret_cast<char*>(&compressed_size), sizeof(uint32_t));
-			compressed_size = LittleEndian::convert(compressed_size);
-
-			file.read(reinterpret_cast<char*>(&uncompressed_size), sizeof(uint32_t));
-			uncompressed_size = LittleEndian::convert(uncompressed_size);
-
-			if(compression_method != 0 || compressed_size != uncompressed_size) {
-				throw std::runtime_error("Unsupported compression method");
-			}
+	size_t size() const {
+		return _size;
+	}
 
-			uint16_t name_length;
-			uint16_t extra_field_length;
+	/**
+	 * @brief Number of values of one index of the first dimension.
+	 */
+	size_t slice_size() const;
 
-			file.read(reinterpret_cast<char*>(&name_length), sizeof(uint16_t));
-			name_length = LittleEndian::convert(name_length);
+	/**
+	 * @brief Converts the values of one index of the first dimension, in row major order.
+	 */
+	void slice(size_t index, float* out) const;
+	void slice(size_t index, double* out) const;
 
-			file.read(reinterpret_cast<char*>(&extra_field_length), sizeof(uint16_t));
-			extra_field_length = LittleEndian::convert(extra_field_length);
+	/**
+	 * @brief Converts count values starting at the flat index start.
+	 */
+	void read(size_t start, size_t count, float* out) const;
+	void read(size_t start, size_t count, double* out) const;
 
-			char* file_name_bytes = new char[name_length];
-			file.read(file_name_bytes, name_length);
+	/**
+	 * @brief Converts the whole array.
+	 */
+	NumpyArray load() const;
 
-			char* extra_length_bytes = new char[extra_field_length];
-			file.read(extra_length_bytes, extra_field_length);
+private:
+	template<typename T>
+	void _read(size_t start, size_t count, T* out) const;
+
+	std::string _descr;
+	std::vector<size_t> _dimension;
+	size_t _size;
+	size_t _item_size;
+
+	// Decompressed member, the values start at _offset. Empty if the values are read from the file.
+	std::vector<uint8_t> _data;
+	std::string _filename;
+	uint64_t _offset;
+	mutable std::ifstream _file;
+	mutable std::vector<uint8_t> _buffer;
+};
 
-			std::string file_name(file_name_bytes, name_length);
-			std::cout << "Read " << file_name << "..." << std::endl;
+typedef std::map<std::string, NumpyLazyArray> NumpyLazyArchive;
 
-			delete[] file_name_bytes;
-			delete[] extra_length_bytes;
+class NumpyReader {
 
-			archive.add(file_name, read_npy_array(file));
+public:
+	NumpyReader() = delete;
 
-			return true;
+	/**
+	 * @brief Loads all the arrays of a .npz archive, the members can be stored or deflated.
+	 */
+	static void load(const std::string& filename, NumpyArchive& archive) {
+		NumpyLazyArchive lazy_archive;
+		open(filename, lazy_archive);
 
-		}
-		else if(magic == ZIP_DICTIONNARY_MAGIC) {
-			return false;
-		}
-		else {
-			throw std::runtime_error("Bad file format : unknwon zip magic");
+		for(const auto& entry : lazy_archive) {
+			std::cout << "Read " << entry.first << "..." << std::endl;
+			_print_shape(entry.second.dimensions());
+			archive.add(entry.first, entry.second.load());
 		}
 	}
 
+	/**
+	 * @brief Loads a .npy file.
+	 */
+	static NumpyArray load(const std::string& filename) {
+		NumpyLazyArray array = open(filename);
+		_print_shape(array.dimensions());
+		return array.load();
+	}
 
-	static NumpyArray read_npy_array(std::ifstream& file) {
-		uint8_t magic_1;
-		char magic_2[5];
-		file.read(reinterpret_cast<char*>(&magic_1), sizeof(uint8_t));
-		file.read(magic_2, 5);
-
-		if(magic_1 != NPY_MAGIC_1 || std::string(magic_2, 5) != NPY_MAGIC_2) {
-			throw std::runtime_error("Bad file format : not a numpy file");
-		}
-
-		uint8_t major_version;
-		uint8_t minor_version;
-
-		file.read(reinterpret_cast<char*>(&major_version), sizeof(uint8_t));
-		file.read(reinterpret_cast<char*>(&minor_version), sizeof(uint8_t));
-
-		uint16_t header_length;
-
-		file.read(reinterpret_cast<char*>(&header_length), sizeof(uint16_t));
-		header_length = LittleEndian::convert(header_length);
-
-		char* header_length_bytes = new char[header_length];
-		file.read(header_length_bytes, header_length);
-
-		std::string header_str(header_length_bytes, header_length);
-
-		size_t cursor = 0;
-		std::unique_ptr<NumpyHeaderObject> header = NumpyHeaderObject::read(header_str, cursor);
-		NumpyHeaderMap& cast_header = dynamic_cast<NumpyHeaderMap&>(*header);
-
-		NumpyHeaderTuple& shape = dynamic_cast<NumpyHeaderTuple&>(*cast_header.value().at("shape"));
+	/**
+	 * @brief Opens the arrays of a .npz archive without converting them.
+	 * The deflated members are decompressed in parallel and checked against their CRC.
+	 *
+	 * @param thread_number number of decompression threads, 0 uses the number of cores.
+	 */
+	static void open(const std::string& filename, NumpyLazyArchive& archive, size_t thread_number = 0);
 
-		std::vector<size_t> dimensions;
-		std::transform(std::begin(shape.value()), std::end(shape.value()), std::back_inserter(dimensions), [](const std::unique_ptr<NumpyHeaderObject>& element) {
-			return dynamic_cast<NumpyHeaderInt&>(*element).value();
-		});
+	/**
+	 * @brief Opens a .npy file without reading its values.
+	 */
+	static NumpyLazyArray open(const std::string& filename);
 
+private:
+	struct ZipMember {
+		std::string name;
+		uint16_t compression_method;
+		uint32_t crc;
+		uint64_t compressed_size;
+		uint64_t uncompressed_size;
+		uint64_t local_header_offset;
+	};
+
+	static std::vector<ZipMember> _read_directory(std::ifstream& file, const std::string& filename);
+	static uint64_t _data_offset(std::ifstream& file, const ZipMember& member);
+	static size_t _parse_npy_header(const uint8_t* data, size_t size, NumpyLazyArray& array);
+
+	static void _print_shape(const std::vector<size_t>& dimensions) {
 		std::cout << "Shape: [";
 		for(size_t i=0; i<dimensions.size(); i++) {
 			if(i != 0)
@@ -156,61 +150,6 @@ private:
 			std::cout << dimensions.at(i);
 		}
 		std::cout << "]" << std::endl;
-
-		NumpyArray array(dimensions);
-
-		std::string descr = dynamic_cast<NumpyHeaderString&>(*cast_header.value().at("descr")).value();
-
-		if(descr == "<f8") {
-			char* byte_array = new char[array.size()*sizeof(double)];
-			file.read(byte_array, array.size()*sizeof(double));
-
-			for(size_t i=0; i<array.size(); i++)
-				array.at_index(i) = LittleEndian::convert(*(reinterpret_cast<double*>(byte_array)+i));
-
-			delete[] byte_array;
-		}
-		else if(descr == ">f8") {
-			char* byte_array = new char[array.size()*sizeof(double)];
-			file.read(byte_array, array.size()*sizeof(double));
-
-			for(size_t i=0; i<array.size(); i++)
-				array.at_index(i) = BigEndian::convert(*(reinterpret_cast<double*>(byte_array)+i));
-
-			delete[] byte_array;
-		}
-		else if(descr == "<f4") {
-			char* byte_array = new char[array.size()*sizeof(float)];
-			file.read(byte_array, array.size()*sizeof(float));
-
-			for(size_t i=0; i<array.size(); i++)
-				array.at_index(i) = LittleEndian::convert(*(reinterpret_cast<float*>(byte_array)+i));
-
-			delete[] byte_array;
-		}
-		else if(descr == ">f4") {
-			char* byte_array = new char[array.size()*sizeof(float)];
-			file.read(byte_array, array.size()*sizeof(float));
-
-			for(size_t i=0; i<array.size(); i++)
-				array.at_index(i) = BigEndian::convert(*(reinterpret_cast<float*>(byte_array)+i));
-
-			delete[] byte_array;
-		}
-		else if(descr == "<i8") {
-			char* byte_array = new char[array.size()*sizeof(int64_t)];
-			file.read(byte_array, array.size()*sizeof(int64_t));
-
-			for(size_t i=0; i<array.size(); i++)
-				array.at_index(i) = LittleEndian::convert(*(reinterpret_cast<int64_t*>(byte_array)+i));
-
-			delete[] byte_array;
-		}
-		else {
-			throw std::runtime_error("unsupported format: "+descr);
-		}
-
-		return array;
 	}
 
 };
@@ -0,0 +1,44 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Number of ranges parallel_range splits [0, size) into: at most one per hardware thread, and none of less than min_size items.
+ */
+inline size_t parallel_thread_number(size_t size, size_t min_size = 1)
+{
+	size_t thread_number = std::max<size_t>(1, std::thread::hardware_concurrency());
+	return std::max<size_t>(1, std::min(thread_number, size / std::max<size_t>(1, min_size)));
+}
+
+/**
+ * @brief Calls function(thread, begin, end) on parallel_thread_number(size, min_size) contiguous ranges of [0, size), each one in its own thread,
+ * the first one in the calling thread. thread is the index of the range, so that the callers can allocate their buffers once per thread
+ * and keep per-thread partial results. The small sizes stay in the calling thread.
+ */
+template <typename Function>
+void parallel_range(size_t size, size_t min_size, Function function)
+{
+	size_t thread_number = parallel_thread_number(size, min_size);
+	if (thread_number <= 1)
+	{
+		function(0, 0, size);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_number; i++)
+	{
+		threads.emplace_back(function, i, size * i / thread_number, size * (i + 1) / thread_number);
+	}
+	function(0, 0, size / thread_number);
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+}
+
+#endif
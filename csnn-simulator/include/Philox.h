@@ -0,0 +1,59 @@
+#ifndef _PHILOX_H
+#define _PHILOX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <string>
+
+// Epochs reserved above the training passes, so that the parameter initialization and the test set draw from streams
+// that no training sample uses.
+#define PHILOX_INITIALIZATION_EPOCH 0xFFFFFFFFu
+#define PHILOX_TEST_EPOCH 0xFFFFFFFEu
+
+/**
+ * @brief Counter-based random number generator (Philox4x32-10).
+ * A stream is fully determined by a key (the experiment seed) and a counter (stream, epoch, sample), so any sample of any epoch
+ * can be drawn independently of the others: a worker processing a subset of the samples gets the same numbers as a serial run.
+ * The class satisfies UniformRandomBitGenerator and can be used with the std distributions.
+ *
+ * @param seed the key of the generator, derived from the experiment name.
+ * @param stream the index of the process (layer) that draws the numbers.
+ * @param epoch the current epoch (or pass).
+ * @param sample the index of the current sample.
+ */
+class Philox
+{
+
+public:
+	typedef uint32_t result_type;
+
+	Philox(uint64_t seed, size_t stream, size_t epoch = 0, size_t sample = 0);
+
+	static constexpr result_type min()
+	{
+		return std::numeric_limits<result_type>::min();
+	}
+
+	static constexpr result_type max()
+	{
+		return std::numeric_limits<result_type>::max();
+	}
+
+	result_type operator()();
+
+	/**
+	 * @brief Returns a 64 bits seed derived from a string, used to key the streams of an experiment.
+	 */
+	static uint64_t seed_from(const std::string &name);
+
+private:
+	void _generate();
+
+	uint32_t _key[2];
+	uint32_t _counter[4];
+	uint32_t _output[4];
+	size_t _cursor;
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <filesystem>
 
 #include "Input.h"
+#include "SparseTensor.h"
 #include "Color.h"
 #include "ClassParameter.h"
 
@@ -83,6 +84,42 @@ public:
 	virtual void process_test(const std::string& label, Tensor<float>& sample) = 0;
 };
 
+/**
+ * @brief Implemented by the single pass processes that can work on the samples of the sparse executions as they are stored,
+ * which saves the conversion of each sample to a dense tensor and back.
+ */
+class SparseProcess {
+
+public:
+	virtual ~SparseProcess() = default;
+
+	virtual void process_train_sparse(const std::string& label, SparseTensor<float>& sample) = 0;
+	virtual void process_test_sparse(const std::string& label, SparseTensor<float>& sample) = 0;
+};
+
+/**
+ * @brief Implemented by the two pass processes that can also compute their statistics on the samples of the sparse executions as they are stored.
+ * The first pass calls compute_sparse, the second one process_train_sparse.
+ */
+class SparseTwoPassProcess : public SparseProcess {
+
+public:
+	virtual void compute_sparse(const std::string& label, const SparseTensor<float>& sample) = 0;
+};
+
+/**
+ * @brief Implemented by the layers that can read the spikes of the samples of the sparse executions as they are stored,
+ * the values of a sample are then the times of its spikes and the dense tensor of the input times is never built.
+ */
+class SparseSpikeProcess {
+
+public:
+	virtual ~SparseSpikeProcess() = default;
+
+	virtual void process_train_sparse_sample(const std::string& label, SparseTensor<float>& sample, size_t current_pass, size_t current_index, size_t number) = 0;
+	virtual void process_test_sparse_sample(const std::string& label, SparseTensor<float>& sample, size_t current_index, size_t number) = 0;
+};
+
 class TwoPassProcess : public Process {
 
 public:
@@ -0,0 +1,11 @@
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#ifdef SMID_AVX256
+#include <immintrin.h>
+
+// Number of floats (or 32 bits integers) in a 256 bits register
+#define AVX_256_N 8
+#endif
+
+#endif
@@ -4,6 +4,7 @@
 #include <vector>
 #include "Spike.h"
 #include "Tensor.h"
+#include "SparseTensor.h"
 
 class SpikeConverter {
 
@@ -14,6 +15,13 @@ public:
 	static void to_spike(const Tensor<Time>& in, std::vector<Spike>& out, size_t x_start, size_t y_start, size_t x_end, size_t y_end);
 
 	static void from_spike(const std::vector<Spike>& in, Tensor<Time>& out);
+
+	/**
+	 * @brief Same conversions on the samples of the sparse executions, where the pixels without spike are the INFINITE_TIME default value:
+	 * only the stored values are read or written, the dense tensor of the times is never built.
+	 */
+	static void to_spike(const SparseTensor<Time>& in, std::vector<Spike>& out);
+	static void from_spike(const std::vector<Spike>& in, SparseTensor<Time>& out);
 };
 
 #endif
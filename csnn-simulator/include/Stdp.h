@@ -16,6 +16,22 @@ public:
 
     virtual float process(float w, const Time pre, Time post) = 0;
 
+	/**
+	 * @brief Weight reached after count updates of a synapse whose pre-synaptic neuron did not fire (pre = INFINITE_TIME).
+	 * This term does not depend on the post-synaptic spike time, so the updates can be accumulated and applied later.
+	 * Rules that have a closed form override it, the default one iterates process until the weight stops changing.
+	 */
+	virtual float process_silent(float w, uint32_t count) {
+		for(uint32_t i=0; i<count; i++) {
+			float v = process(w, INFINITE_TIME, 0.0f);
+			if(v == w) {
+				break;
+			}
+			w = v;
+		}
+		return w;
+	}
+
 	virtual void adapt_parameters(float factor) = 0;
 
 };
@@ -270,6 +270,88 @@ public:
 		return this->_shape.number() == 0;
 	}
 
+	/**
+	 * @brief Header on the values as a (dim(0), dim(1)) matrix whose channels are the remaining dimensions, without copy.
+	 * The (x, y) plane (k, conv) of a (height, width, depth, conv) tensor is the channel k * conv_depth + conv.
+	 * The header of a const tensor must not be written.
+	 */
+	cv::Mat mat() const
+	{
+		if (_shape.number() < 2)
+		{
+			throw std::runtime_error("mat: expected at least 2 dimensions");
+		}
+
+		size_t channels = _channel_number();
+		if (channels > CV_CN_MAX)
+		{
+			throw std::runtime_error("mat: too many channels (" + std::to_string(channels) + ")");
+		}
+
+		return cv::Mat(_shape.dim(0), _shape.dim(1), CV_MAKETYPE(cv::DataType<T>::depth, channels), const_cast<T *>(_data));
+	}
+
+	/**
+	 * @brief Copies the (x, y) plane (k, conv) of a (height, width, depth, conv) tensor in a single pass.
+	 * out keeps its buffer if it already has the size and type of the plane.
+	 */
+	void plane(size_t k, size_t conv, cv::Mat &out) const
+	{
+		size_t channels = _channel_number();
+		size_t channel = k * _shape.dim(3) + conv;
+		if (channel >= channels)
+		{
+			throw std::runtime_error("plane: out of range");
+		}
+
+		if (channels <= CV_CN_MAX)
+		{
+			cv::extractChannel(mat(), out, channel);
+			return;
+		}
+
+		out.create(_shape.dim(0), _shape.dim(1), cv::DataType<T>::type);
+		const T *src = _data + channel;
+		for (int i = 0; i < out.rows; i++)
+		{
+			T *row = out.ptr<T>(i);
+			for (int j = 0; j < out.cols; j++, src += channels)
+			{
+				row[j] = *src;
+			}
+		}
+	}
+
+	/**
+	 * @brief Writes a (height, width) single channel matrix in the (x, y) plane (k, conv) of a (height, width, depth, conv) tensor.
+	 */
+	void set_plane(size_t k, size_t conv, const cv::Mat &in)
+	{
+		size_t channels = _channel_number();
+		size_t channel = k * _shape.dim(3) + conv;
+		if (channel >= channels || in.rows != static_cast<int>(_shape.dim(0)) || in.cols != static_cast<int>(_shape.dim(1)) || in.type() != cv::DataType<T>::type)
+		{
+			throw std::runtime_error("set_plane: incompatible plane");
+		}
+
+		if (channels <= CV_CN_MAX)
+		{
+			cv::Mat header = mat();
+			cv::insertChannel(in, header, channel);
+			return;
+		}
+
+		T *dst = _data + channel;
+		for (int i = 0; i < in.rows; i++)
+		{
+			const T *row = in.ptr<T>(i);
+			for (int j = 0; j < in.cols; j++, dst += channels)
+			{
+				*dst = row[j];
+			}
+		}
+	}
+
 	T *begin()
 	{
 		return _data;
@@ -432,6 +514,14 @@ public:
 
 		out = Tensor<float>(Shape({_height, _width, _depth, _conv_depth}));
 
+		// The single channel frames are the channels of the tensor header, merged in one pass.
+		if (_depth == 1 && _conv_depth <= CV_CN_MAX && _same_float_frames(frames))
+		{
+			cv::Mat header = out.mat();
+			cv::merge(frames, header);
+			return;
+		}
+
 		// CONV_DEPTH by being incremented every frame.
 		size_t _conv_count = 0;
 
@@ -492,6 +582,19 @@ public:
 
 		out = Tensor<float>(Shape({_height, _width, depth, _conv_depth}));
 
+		// The frame f is the plane (f % depth, f / depth), the frames are ordered by channel and merged in one pass.
+		if (_depth == 1 && frames.size() == depth * _conv_depth && frames.size() <= CV_CN_MAX && _same_float_frames(frames))
+		{
+			std::vector<cv::Mat> channels(frames.size());
+			for (size_t f = 0; f < frames.size(); f++)
+			{
+				channels[(f % depth) * _conv_depth + f / depth] = frames[f];
+			}
+			cv::Mat header = out.mat();
+			cv::merge(channels, header);
+			return;
+		}
+
 		// CONV_DEPTH by being incremented every frame.
 		size_t _conv_count = 0;
 		size_t _depth_count = 0;
@@ -773,6 +876,13 @@ public:
 
 		out = Tensor<float>(Shape({_height, _width, _depth, _conv_depth}));
 
+		if (frame.dims == 2 && frame.type() == CV_32F)
+		{
+			cv::Mat header = out.mat();
+			frame.copyTo(header);
+			return;
+		}
+
 		for (size_t i = 0; i < _height; i++)
 			for (size_t j = 0; j < _width; j++)
 			{
@@ -835,16 +945,19 @@ public:
 		size_t _depth = in.shape().dim(2);
 		size_t _conv_depth = in.shape().dim(3);
 
-		// CONV_DEPTH by being incremented every frame.
+		// The frames are the channels of the tensor header, split in one pass. Only the first depth is kept.
+		if (_depth == 1 && _conv_depth <= CV_CN_MAX)
+		{
+			std::vector<cv::Mat> channels;
+			cv::split(in.mat(), channels);
+			frames.insert(frames.end(), channels.begin(), channels.end());
+			return;
+		}
+
 		for (size_t conv = 0; conv < _conv_depth; conv++)
 		{
 			cv::Mat frame(_height, _width, CV_32F);
-
-			for (size_t i = 0; i < _height; i++)
-				for (size_t j = 0; j < _width; j++)
-				{
-					frame.at<float>(i, j) = in.at(i, j, 0, conv);
-				}
+			in.plane(0, conv, frame);
 			frames.push_back(frame);
 		}
 	}
@@ -861,15 +974,23 @@ public:
 		size_t _depth = in.shape().dim(2);
 		size_t _conv_depth = in.shape().dim(3);
 
+		// The plane (k, conv) is the channel k * _conv_depth + conv of the tensor header, split in one pass.
+		if (_depth * _conv_depth <= CV_CN_MAX)
+		{
+			std::vector<cv::Mat> channels;
+			cv::split(in.mat(), channels);
+			for (size_t conv = 0; conv < _conv_depth; conv++)
+				for (size_t k = 0; k < _depth; k++)
+					frames.push_back(channels[k * _conv_depth + conv]);
+			return;
+		}
+
 		// CONV_DEPTH by being incremented every frame.
 		for (size_t conv = 0; conv < _conv_depth; conv++)
 			for (size_t k = 0; k < _depth; k++)
 			{
 				cv::Mat frame(_height, _width, CV_32F);
-				for (size_t i = 0; i < _height; i++)
-					for (size_t j = 0; j < _width; j++)
-						frame.at<float>(i, j) = in.at(i, j, k, conv);
-
+				in.plane(k, conv, frame);
 				frames.push_back(frame);
 			}
 	}
@@ -1610,6 +1731,24 @@ public:
 	}
 
 private:
+	static bool _same_float_frames(const std::vector<cv::Mat> &frames)
+	{
+		for (const cv::Mat &frame : frames)
+		{
+			if (frame.dims != 2 || frame.type() != CV_32F || frame.size() != frames[0].size())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t _channel_number() const
+	{
+		size_t plane_size = _shape.dim(0) * _shape.dim(1);
+		return plane_size == 0 ? 0 : _shape.product() / plane_size;
+	}
+
 	Shape _shape;
 	T *_data;
 };
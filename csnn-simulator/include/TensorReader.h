@@ -5,7 +5,13 @@
 #include <iostream>
 
 #include "Input.h"
+#include "TensorWriter.h"
 
+/**
+ * @brief Reads the files written by TensorWriter.
+ * If the file has an index, the samples can be read in any order with seek(), the labels and the number of non zero values
+ * are known without reading the records. The index of the older files is built by a scan, the first time it is needed.
+ */
 class TensorReader : public Input {
 
 public:
@@ -21,22 +27,49 @@ public:
 
 	virtual bool has_next() const;
 	virtual std::pair<std::string, Tensor<InputType>> next();
+	std::pair<std::string, SparseTensor<float>> next_sparse();
+
+	/**
+	 * @brief Moves to the sample of the given index, the next call to next() returns it.
+	 */
+	void seek(size_t index);
+
+	/**
+	 * @brief Number of samples of the shard, seek(), label() and nnz() take the index of a sample in the whole file.
+	 */
+	size_t size() const;
+	bool sparse() const;
+	const std::string& label(size_t index);
+	size_t nnz(size_t index);
 
 	void close();
 	void reset();
+	virtual void shard(size_t index, size_t number);
 
 	virtual std::string to_string() const;
 
+	/**
+	 * @brief Shape of the first sample of the file.
+	 */
 	virtual const Shape& shape() const;
 
 private:
 	void _read_header();
+	void _read_index();
+	void _build_index();
+	std::string _read_record_header(Shape& shape);
 
 	std::string _name;
 	std::ifstream _file;
 	size_t _tensor_counter;
 	size_t _cursor;
+	size_t _begin;
+	size_t _end;
 	bool _sparse;
+	bool _indexed;
+	std::streampos _data_position;
+	Shape _shape;
+	std::vector<TensorFileIndexEntry> _index;
 
 };
 
@@ -2,9 +2,35 @@
 #define _TENSOR_WRITER_H
 
 #include <fstream>
+#include <vector>
 
 #include "Tensor.h"
+#include "SparseTensor.h"
+
+#define TENSOR_FILE_MAGIC 0x234264FF
+#define TENSOR_FILE_SPARSE 0x1
+#define TENSOR_FILE_INDEXED 0x2
+#define TENSOR_FILE_INDEX_MAGIC 0x58444E49
+
+/**
+ * @brief Entry of the index of a tensor file: position of the record, number of non zero values and label.
+ */
+struct TensorFileIndexEntry {
+	uint64_t offset;
+	uint32_t nnz;
+	std::string label;
+};
 
+/**
+ * @brief Writes labeled tensors in a binary file, read by TensorReader.
+ *
+ * Layout (v1): magic, flags (uint8), tensor number (uint32), then the records back to back:
+ * label size (uint8), label, dimension number (uint8), dimensions (uint16), then either the values (float)
+ * or, with the sparse flag, (index (uint32), value (float)) pairs ended by 0xFFFFFFFF.
+ *
+ * close() appends an index block, with for each record its offset (uint64), number of non zero values (uint32) and label,
+ * followed by the offset of the index (uint64) and TENSOR_FILE_INDEX_MAGIC. The records are unchanged, so the files stay readable sequentially.
+ */
 class TensorWriter {
 
 public:
@@ -14,12 +40,16 @@ public:
 
 	void open(const std::string& filename, bool sparse = false);
 	void write(const std::string& label, const Tensor<float>& t);
+	void write(const std::string& label, const SparseTensor<float>& t);
 	void close();
 
 private:
+	void _write_header(const std::string& label, const Shape& shape);
+
 	std::ofstream _file;
 	size_t _tensor_counter;
 	bool _sparse;
+	std::vector<TensorFileIndexEntry> _index;
 
 };
 
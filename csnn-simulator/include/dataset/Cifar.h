@@ -6,6 +6,7 @@
 #include <fstream>
 #include <limits>
 #include <tuple>
+#include <filesystem>
 
 #include "Tensor.h"
 #include "Input.h"
@@ -13,6 +14,8 @@
 #define CIFAR_WIDTH 32
 #define CIFAR_HEIGHT 32
 #define CIFAR_DEPTH 3
+// label byte followed by the pixels
+#define CIFAR_RECORD_SIZE (1+CIFAR_WIDTH*CIFAR_HEIGHT*CIFAR_DEPTH)
 
 namespace dataset {
 
@@ -25,6 +28,7 @@ namespace dataset {
 		virtual std::pair<std::string, Tensor<InputType>> next();
 		virtual void reset();
 		virtual void close();
+		virtual void shard(size_t index, size_t number);
 
 		size_t size() const;
 		virtual std::string to_string() const;
@@ -33,6 +37,7 @@ namespace dataset {
 
 	private:
 		void check_next();
+		size_t record_count() const;
 
 		std::vector<std::string> _files;
 
@@ -43,6 +48,11 @@ namespace dataset {
 		Shape _shape;
 
 		uint8_t _next_label;
+
+		// Global index of the next sample and end of the shard.
+		size_t _current;
+		size_t _begin;
+		size_t _end;
 	};
 }
 
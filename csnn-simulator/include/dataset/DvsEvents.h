@@ -0,0 +1,121 @@
+#ifndef _DATASET_DVSEVENTS_H
+#define _DATASET_DVSEVENTS_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <tuple>
+
+#include "Tensor.h"
+#include "Input.h"
+#include "dataset/SpikingVideo.h"
+
+#define DVS_POLARITY_EVENT 1
+#define DVS_PACKET_HEADER_SIZE 28
+
+/**
+ * @brief How the events of a sample are accumulated in frames, the three variants of script_generate_dataset.py.
+ */
+enum DvsBinning {
+	DVS_BINNING_FRAME_COUNT,	// same number of events in each frame
+	DVS_BINNING_TIME_WINDOW,	// the duration of the sample is split in frame_number windows
+	DVS_BINNING_FIXED_DURATION	// one frame per duration microseconds, padded with empty frames or truncated to frame_number
+};
+
+namespace dataset {
+
+	/**
+	 * @brief Polarity events in structure of arrays, timestamps in microseconds.
+	 */
+	struct DvsEventBuffer {
+		std::vector<uint64_t> t;
+		std::vector<uint16_t> x;
+		std::vector<uint16_t> y;
+		std::vector<uint8_t> p;
+
+		size_t size() const;
+		void clear();
+		void resize(size_t size);
+	};
+
+	/**
+	 * @brief Events [begin, end) of a frame and the time interval [t_begin, t_end] it covers.
+	 */
+	struct DvsFrame {
+		size_t begin;
+		size_t end;
+		uint64_t t_begin;
+		uint64_t t_end;
+	};
+
+	/**
+	 * @brief DVS128 Gesture input read from the raw AEDAT 3.1 recordings instead of the frame npy files.
+	 * The trials of the list file are read one at a time, each one is split in samples with its _labels.csv file,
+	 * and the events of a sample are binned in a (FRAME_HEIGHT, FRAME_WIDTH, VIDEO_DEPTH, frame_number) tensor of event counts,
+	 * the same tensor as dataset::SpikingVideo.
+	 *
+	 * @param dataset_path the folder of the DvsGesture dataset.
+	 * @param trial_filename the list of the trials, relative to dataset_path (trials_to_train.txt or trials_to_test.txt).
+	 * @param binning how the events are accumulated in frames.
+	 * @param frame_number the number of frames of a sample.
+	 * @param duration the duration of a frame in microseconds, only used with DVS_BINNING_FIXED_DURATION.
+	 */
+	class DvsEvents : public Input {
+
+	public:
+		DvsEvents(const std::string& dataset_path, const std::string& trial_filename, DvsBinning binning = DVS_BINNING_FRAME_COUNT,
+				  size_t frame_number = FRAME_NUMBER, uint64_t duration = 500000);
+
+		virtual bool has_next() const;
+		virtual std::pair<std::string, Tensor<InputType>> next();
+		virtual void reset();
+		virtual void close();
+
+		size_t size() const;
+		virtual std::string to_string() const;
+
+		virtual const Shape& shape() const;
+
+		/**
+		 * @brief Appends the polarity events of an AEDAT 3.1 file to events, the other packet types are skipped.
+		 */
+		static void load_aedat(const std::string& filename, DvsEventBuffer& events);
+
+	protected:
+		/**
+		 * @brief Copies the events of the next sample in events and returns its label.
+		 */
+		std::string _next_events(DvsEventBuffer& events);
+		/**
+		 * @brief Sorts the events of a trial by timestamp, so that the events of a sample can be found by binary search.
+		 */
+		static void _sort(DvsEventBuffer& events);
+
+		/**
+		 * @brief Splits the events of a sample in frames according to the binning, the frames past the last event are empty.
+		 */
+		std::vector<DvsFrame> _split(const DvsEventBuffer& events) const;
+
+		DvsBinning _binning;
+		size_t _frame_number;
+		uint64_t _duration;
+
+	private:
+		std::string _dataset_path;
+		std::string _trial_filename;
+
+		// (trial, label, start, end) of every sample, the times are in microseconds.
+		std::vector<std::tuple<std::string, size_t, uint64_t, uint64_t>> _samples;
+		size_t _cursor;
+
+		// Events of the trial of the current sample.
+		std::string _trial;
+		DvsEventBuffer _events;
+
+	protected:
+		Shape _shape;
+	};
+
+}
+
+#endif
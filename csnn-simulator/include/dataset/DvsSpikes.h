@@ -0,0 +1,42 @@
+#ifndef _DATASET_DVSSPIKES_H
+#define _DATASET_DVSSPIKES_H
+
+#include "Spike.h"
+#include "dataset/DvsEvents.h"
+
+namespace dataset {
+
+	/**
+	 * @brief DVS128 Gesture input where each event is directly a spike, without accumulating the events in frames.
+	 * The sample is still split in frame_number slices (the k index of the spikes) with the binning of dataset::DvsEvents,
+	 * and the timestamp of an event is normalized into the [0, 1] time domain of its slice. Only the first event of each pixel and polarity
+	 * in a slice is a spike, as a sample holds one timestamp per neuron.
+	 * The pixels that have no event keep INFINITE_TIME, so no scaling or coding process is needed before Convolution3D.
+	 * With the sparse executions, the samples are loaded with next_sparse() and Convolution3D reads their spikes directly,
+	 * so the dense 128x128x2xframe_number tensor is never built.
+	 */
+	class DvsSpikes : public DvsEvents {
+
+	public:
+		DvsSpikes(const std::string& dataset_path, const std::string& trial_filename, DvsBinning binning = DVS_BINNING_FRAME_COUNT,
+				  size_t frame_number = FRAME_NUMBER, uint64_t duration = 500000);
+
+		virtual std::pair<std::string, Tensor<InputType>> next();
+		/**
+		 * @brief The sample as stored by the sparse executions, built from the spikes without the dense tensor of next().
+		 */
+		virtual std::pair<std::string, SparseTensor<InputType>> next_sparse();
+		virtual std::string to_string() const;
+
+		/**
+		 * @brief Spikes of the next sample, in the order of the events.
+		 */
+		std::string next_spikes(std::vector<Spike>& spikes);
+
+	private:
+		Tensor<bool> _spiked;
+	};
+
+}
+
+#endif
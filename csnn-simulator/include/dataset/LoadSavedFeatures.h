@@ -5,6 +5,7 @@
 #include <cassert>
 #include <limits>
 #include <tuple>
+#include <memory>
 
 #include "Input.h"
 #include "tool/Operations.h"
@@ -15,6 +16,7 @@ namespace dataset
 	/**
 	 * @brief This class monitors introducing the dataset into the program, 
 	 * It is responsible for loading and counting the number of samples.
+	 * The samples of the first file of the folder are read one at a time, from a feature store or a JSON file.
 	 * 
 	 * @param folder_path the path to the saved featuremaps
 	 */
@@ -39,8 +41,8 @@ namespace dataset
 
 		std::string _folder_path;
 
-		std::vector<std::pair<std::string, Tensor<float>>> _features;
-		
+		std::unique_ptr<Input> _reader;
+
 		std::vector<std::string> _data_list;
 
 		uint32_t _size;
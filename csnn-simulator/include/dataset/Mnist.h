@@ -25,6 +25,7 @@ namespace dataset {
 		virtual std::pair<std::string, Tensor<InputType>> next();
 		virtual void reset();
 		virtual void close();
+		virtual void shard(size_t index, size_t number);
 
 		size_t size() const;
 		virtual std::string to_string() const;
@@ -43,6 +44,8 @@ namespace dataset {
 
 		uint32_t _size;
 		uint32_t _cursor;
+		uint32_t _begin;
+		uint32_t _end;
 
 		Shape _shape;
 
@@ -13,6 +13,7 @@
 #include "Input.h"
 
 
+// Geometry of the DVS128 sensor, used by the event readers. SpikingVideo takes its geometry from the npy header.
 #define FRAME_WIDTH 128
 #define FRAME_HEIGHT 128
 #define FRAME_NUMBER 20
@@ -21,37 +22,74 @@
 
 namespace dataset {
 
+	/**
+	 * @brief Spiking videos stored in a float32 npy file of shape (samples, frames, depth, height, width),
+	 * with the labels in a second npy file. The geometry is read from the npy header.
+	 * The frames file is memory mapped: the header is validated once in the constructor and a sample is only read from the disk
+	 * when next() reaches it. The kernel is asked to read ahead the next sample and to drop the pages of the previous one,
+	 * so the resident memory stays around one sample whatever the size of the file.
+	 *
+	 * The samples can be reduced while they are read, without regenerating the dataset:
+	 * each spatial_factor x spatial_factor block of pixels and each group of temporal_factor frames are summed into one value,
+	 * which keeps the event counts of the frames. The pixels and frames left over when a dimension is not a multiple of its factor are dropped.
+	 * The output shape is (height/spatial_factor, width/spatial_factor, depth, frames/temporal_factor).
+	 */
 	class SpikingVideo : public Input {
 
 	public:
-		SpikingVideo(const std::string& videos_npy_filename, const std::string& label_npy_filename);
+		SpikingVideo(const std::string& videos_npy_filename, const std::string& label_npy_filename, size_t spatial_factor = 1, size_t temporal_factor = 1);
+		~SpikingVideo();
+
+		SpikingVideo(const SpikingVideo& that) = delete;
+		SpikingVideo& operator=(const SpikingVideo& that) = delete;
 
 		virtual bool has_next() const;
 		virtual std::pair<std::string, Tensor<InputType>> next();
 		virtual void reset();
 		virtual void close();
+		virtual void shard(size_t index, size_t number);
 
 		size_t size() const;
 		virtual std::string to_string() const;
 
 		virtual const Shape& shape() const;
 
+		/**
+		 * @brief Zero-copy view on the frames of a sample, in the npy layout (frames, depth, height, width), before any reduction.
+		 * The pointer is valid until close() is called.
+		 */
+		const float* sample_data(size_t index) const;
+
 	private:
+		void _copy(const float* sample, InputType* out) const;
+		void _reduce(const float* sample, InputType* out) const;
+		void _advise(size_t index, int advice) const;
 
 		std::string _videos_npy_filename;
 		std::string _label_npy_filename;
 
 		uint32_t _size;
 		uint32_t _cursor;
-		uint32_t _label_cursor;
+		uint32_t _begin;
+		uint32_t _end;
+		size_t _frame_number;
+		size_t _depth;
+		size_t _height;
+		size_t _width;
+		size_t _spatial_factor;
+		size_t _temporal_factor;
 		Shape _shape;
-		std::vector<float> _data;
 		std::vector<float> _label;
-		std::vector<unsigned long> _data_shape;
 		std::vector<unsigned long> _label_shape;
 		bool _is_fortran{false};
+
+		int _fd;
+		char* _map;
+		size_t _map_size;
+		const float* _data;
+		size_t _sample_size;
 	};
 
 }
 
-#endif
\ No newline at end of file
+#endif
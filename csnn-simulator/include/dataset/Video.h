@@ -8,6 +8,11 @@
 #include <limits>
 #include <tuple>
 #include <math.h>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 #include "Tensor.h"
 #include "Input.h"
@@ -26,6 +31,12 @@
 #define VIDEO_DEPTH 1
 #define CONV_DEPTH 1
 
+/**
+ * @brief Default folder (relative to the build folder) and size limit in bytes of the decoded sample cache, one file per sample.
+ */
+#define VIDEO_CACHE_FOLDER "VideoCache"
+#define VIDEO_CACHE_SIZE (static_cast<size_t>(4) << 30)
+
 namespace dataset
 {
 
@@ -41,6 +52,11 @@ namespace dataset
 	 * @param draw A flag that allows drawing the input samples as frames in the Input_frames folder in the build folder.
 	 * @param frame_size_width video frame width size that is set to zero takes the default size.
 	 * @param frame_size_height video frame height size that is set to zero takes the default size.
+	 *
+	 * The videos are decoded, resized and converted by a pool of worker threads, that fill a bounded prefetch queue read by next().
+	 * The samples are returned in the same order as a sequential decoding.
+	 * With set_cache(), each decoded sample is also saved in the cache folder, under a key made of the video path, modification time and size,
+	 * the starting shift, the frame gap, the threshold, the colour mode and the frame size, so the next runs do not decode the videos again.
 	 */
 	class Video : public Input
 	{
@@ -49,6 +65,23 @@ namespace dataset
 		Video(const std::string &video_folder_name, const size_t &frame_per_video, const size_t &frame_gap = 0, const size_t &threshold = 0,
 			  const size_t &sample_per_video = 0, const size_t &grey_video = 0,
 			  std::string exp_name = "", const size_t &draw = 0, const size_t &frame_size_width = 0, const size_t &frame_size_height = 0, size_t max_read = std::numeric_limits<size_t>::max());
+		virtual ~Video();
+
+		Video(const Video &that) = delete;
+		Video &operator=(const Video &that) = delete;
+
+		/**
+		 * @brief Sets the number of decoding threads and the number of samples decoded in advance, before the first call to next().
+		 * @param thread_number the number of worker threads, 0 uses the number of cores.
+		 * @param prefetch_size the maximum number of decoded samples waiting to be read, 0 uses twice the number of threads.
+		 */
+		void set_prefetch(size_t thread_number, size_t prefetch_size = 0);
+
+		/**
+		 * @brief Enables or disables the decoded sample cache (disabled by default), before the first call to next().
+		 * No sample is added once the files of the folder reach size bytes.
+		 */
+		void set_cache(bool cache, const std::string &directory = VIDEO_CACHE_FOLDER, size_t size = VIDEO_CACHE_SIZE);
 		/**
 		 * @brief A function that is called to fetch the next sample if the size is not reached.
 		 * This function can be seen in the OptimizedLayerByLayer class in the load function.
@@ -87,6 +120,7 @@ namespace dataset
 
 		virtual void reset();
 		virtual void close();
+		virtual void shard(size_t index, size_t number);
 
 		size_t size() const;
 		virtual std::string to_string() const;
@@ -94,7 +128,24 @@ namespace dataset
 		virtual const Shape &shape() const;
 
 	private:
+		// A decoded sample, moving is false if no frame was taken.
+		struct DecodedSample
+		{
+			Tensor<InputType> tensor;
+			bool moving = false;
+			std::exception_ptr error;
+		};
+
 		uint32_t swap(uint32_t v);
+
+		void _decode(const std::string &video_name, size_t shift, DecodedSample &sample);
+		std::string _cache_key(const std::string &video_name, size_t shift) const;
+		bool _load_cache(const std::string &key, DecodedSample &sample) const;
+		void _save_cache(const std::string &key, const DecodedSample &sample) const;
+
+		void _start_workers();
+		void _stop_workers();
+		void _run_worker();
 		// The path of the folder that contains the videos.
 		std::string _video_folder_path;
 		uint32_t _frame_size_width;
@@ -136,6 +187,25 @@ namespace dataset
 		int _threshold;
 
 		uint32_t _max_read;
+
+		// (video index, starting shift) of every sample, in the order of next().
+		std::vector<std::pair<uint32_t, uint32_t>> _schedule;
+		size_t _begin; // range of _schedule read by this shard
+		size_t _end;
+		size_t _thread_number;
+		size_t _prefetch_size;
+		// Empty when the cache is disabled.
+		std::string _cache_directory;
+		size_t _cache_size;
+
+		std::vector<std::thread> _workers;
+		std::mutex _mutex;
+		std::condition_variable _ready;
+		std::condition_variable _space;
+		std::map<size_t, DecodedSample> _prefetched;
+		size_t _next_task;
+		size_t _consumed;
+		bool _stop;
 	};
 
 }
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <iostream>
 #include "tool/Operations.h"
+#include "tool/SnapshotWriter.h"
 #include "plot/Threshold.h"
 #include "plot/Evolution.h"
 #include <thread> // std::this_thread::sleep_for
@@ -33,12 +34,11 @@ namespace layer
 
 			void resize();
 			void train(const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike);
-			void train(const std::string &label, const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike);
 			void test(const std::vector<Spike> &input_spike, const Tensor<Time> &, std::vector<Spike> &output_spike);
+			void flush_depression();
 
 		private:
 			Convolution3D &_model;
-			std::string _label; // the label of the cuttent sample
 			Tensor<float> _a;
 			Tensor<float> _inh;
 			Tensor<bool> _wta;
@@ -54,15 +54,37 @@ namespace layer
 
 			void resize();
 			void train(const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike);
-			void train(const std::string &label, const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike);
 			void test(const std::vector<Spike> &input_spike, const Tensor<Time> &, std::vector<Spike> &output_spike);
+			void flush_depression();
 
 		private:
+			float &_synchronized_weight(size_t x, size_t y, size_t zi, size_t z, size_t k);
+
+			void _test_float(const std::vector<Spike> &input_spike, std::vector<Spike> &output_spike);
+			template <typename W, typename P>
+			void _quantize(Tensor<W> &w, Tensor<P> &th, Tensor<P> &a, Tensor<P> &inh, size_t bits);
+			template <typename W, typename P>
+			void _test_quantized(const Tensor<W> &w, const Tensor<P> &th, Tensor<P> &a, Tensor<P> &inh, const std::vector<Spike> &input_spike, std::vector<Spike> &output_spike);
+
 			Convolution3D &_model;
-			std::string _label; // the label of the cuttent sample
 			Tensor<float> _a;	// Activations. A tensor of the activations of all the neurons in the layer.
 			Tensor<bool> _inh;	// Inhibitions. A tensor of the inhibition values of all the neurons in the layer.
 			Tensor<bool> _wta;	// Winner takes all.
+			Tensor<uint32_t> _update_count; // Number of STDP updates of each filter since the last flush.
+			Tensor<uint32_t> _synced_count; // Value of _update_count up to which each synapse has been updated, the rest is pending depression.
+
+			// Fixed point copies of the weights, thresholds and potentials used for inference when quantization is enabled.
+			// The filter index is the last dimension so that all the filters of a synapse are contiguous.
+			// The inhibition masks are -1 for the neurons that already fired, with the width of the potentials so that they are applied in the same vector.
+			bool _quantized;
+			Tensor<int8_t> _w8;
+			Tensor<int16_t> _th16;
+			Tensor<int16_t> _a16;
+			Tensor<int16_t> _inh16;
+			Tensor<int16_t> _w16;
+			Tensor<int32_t> _th32;
+			Tensor<int32_t> _a32;
+			Tensor<int32_t> _inh32;
 			uint32_t epoch_number;
 		};
 #endif
@@ -84,8 +106,11 @@ namespace layer
 	 * @param padding_x added padding to the filter in the x direction
 	 * @param padding_y added padding to the filter in the y direction
 	 * @param padding_k added padding to the filter in the z direction
+	 *
+	 * The quantization parameter (0, 8 or 16) enables a fixed point inference once training is done: weights are converted to int8 (resp. int16)
+	 * with a per-layer scale and the potentials are accumulated in int16 (resp. int32) with saturation. It is not available in the SMID_AVX256 implementation.
 	 */
-	class Convolution3D : public Layer4D
+	class Convolution3D : public Layer4D, public SparseSpikeProcess
 	{
 
 		friend class _priv::Convolution3DImpl;
@@ -112,9 +137,12 @@ namespace layer
 		virtual size_t train_pass_number() const;
 		virtual void process_train_sample(const std::string &label, Tensor<float> &sample, size_t current_pass, size_t current_index, size_t number);
 		virtual void process_test_sample(const std::string &label, Tensor<float> &sample, size_t current_index, size_t number);
+		virtual void process_train_sparse_sample(const std::string &label, SparseTensor<float> &sample, size_t current_pass, size_t current_index, size_t number);
+		virtual void process_test_sparse_sample(const std::string &label, SparseTensor<float> &sample, size_t current_index, size_t number);
 
 		virtual void train(const std::string &label, const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike); //, size_t layer_index, size_t epoch_index );
 		virtual void test(const std::string &label, const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike);
+		virtual void on_epoch_start();
 		virtual void on_epoch_end();
 
 		virtual Tensor<float> reconstruct(const Tensor<float> &t) const;
@@ -124,6 +152,10 @@ namespace layer
 		void plot_evolution(bool only_in_train);
 
 	private:
+		void _start_train_sample(size_t current_pass, size_t current_index);
+		void _start_test_sample(size_t current_index);
+		void _random_patch(size_t current_pass, size_t current_index, size_t &x, size_t &y, size_t &k);
+
 		uint32_t _epoch_number;
 		uint32_t _current_epoch_number;
 		uint32_t _last_epoch_number;
@@ -150,6 +182,7 @@ namespace layer
 		bool _save_random_start;
 
 		bool _inhibition;
+		uint32_t _quantization; // number of bits of the fixed point weights used in inference, 0 keeps the float weights.
 		std::string _model_path;
 
 		// synaptic weights of of the network
@@ -166,6 +199,15 @@ namespace layer
 		bool _wta_infer;
 
 		_priv::Convolution3DImpl _impl;
+
+		// The weight files are written by a background thread, the paths and the label prefix are computed once at the first epoch.
+		std::string _class_label(const std::string &label) const;
+		tool::SnapshotWriter _snapshot;
+		std::string _snapshot_directory;
+		std::string _snapshot_name;
+		std::string _label_prefix;
+		std::string _snapshot_label; // label of the sample of the first spike of the last epoch
+		size_t _snapshot_neuron;	 // neuron of the first spike of the last epoch
 	};
 
 } // namespace layer
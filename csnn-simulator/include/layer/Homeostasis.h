@@ -0,0 +1,25 @@
+#ifndef _LAYER_HOMEOSTASIS_H
+#define _LAYER_HOMEOSTASIS_H
+
+#include "Tensor.h"
+#include "Spike.h"
+
+namespace layer
+{
+	/**
+	 * @brief Homeostatic threshold adaptation applied to the whole filter bank each time a neuron fires during training.
+	 * Every threshold is moved towards the objective time (th -= lr_th * (time - t_obj)), the winner is then increased by lr_th
+	 * while the other neurons are decreased by lr_th / (depth - 1), and the result is clamped to min_th.
+	 * The update is done as one broadcast subtraction, one masked add and a clamp, so it is shared by Convolution and Convolution3D.
+	 *
+	 * @param th the thresholds of the neurons, one per filter.
+	 * @param winner the index of the neuron that fired.
+	 * @param spike_time the timestamp of the spike that made the neuron fire.
+	 * @param t_obj the objective time.
+	 * @param lr_th the threshold learning rate.
+	 * @param min_th the minimum threshold.
+	 */
+	void adapt_threshold(Tensor<float> &th, size_t winner, Time spike_time, float t_obj, float lr_th, float min_th);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _LAYER_QUANTIZATION_H
+#define _LAYER_QUANTIZATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "Tensor.h"
+
+namespace layer
+{
+	/**
+	 * @brief Per-layer scale used to map float weights to fixed point values on a given number of bits (8 or 16).
+	 * The largest weight is mapped to the largest positive integer, weights are in [0, 1] so the sign bit is never used.
+	 *
+	 * @param w the synaptic weights.
+	 * @param bits the number of bits of the fixed point representation.
+	 */
+	float quantization_scale(const Tensor<float> &w, size_t bits);
+
+	/**
+	 * @brief Rounds v * scale to the nearest value that fits in Q.
+	 */
+	template <typename Q>
+	Q quantize_value(float v, float scale)
+	{
+		float q = std::round(v * scale);
+		q = std::max<float>(static_cast<float>(std::numeric_limits<Q>::lowest()), std::min<float>(static_cast<float>(std::numeric_limits<Q>::max()), q));
+		return static_cast<Q>(q);
+	}
+
+	/**
+	 * @brief Integrates the fixed point weights of n filters in their potentials (a += w), the sums saturate instead of wrapping around.
+	 * inh is -1 for the inhibited neurons and 0 for the others.
+	 *
+	 * @return true if at least one potential of a neuron that is not inhibited reached its threshold.
+	 */
+	bool integrate(int16_t *a, const int8_t *w, const int16_t *th, const int16_t *inh, size_t n);
+	bool integrate(int32_t *a, const int16_t *w, const int32_t *th, const int32_t *inh, size_t n);
+}
+
+#endif
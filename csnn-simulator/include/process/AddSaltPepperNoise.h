@@ -5,6 +5,7 @@
 #include <iostream>
 #include "Process.h"
 #include "NumpyReader.h"
+#include "Philox.h"
 
 namespace process
 {
@@ -23,11 +24,14 @@ namespace process
 		AddSaltPepperNoise(std::string expName, size_t salt_scalar = 0, size_t pepper_scalar = 0, size_t draw = 0);
 
 		virtual Shape compute_shape(const Shape &shape);
+		virtual void process_train_sample(const std::string &label, Tensor<float> &sample, size_t current_pass, size_t current_index, size_t number);
+		virtual void process_test_sample(const std::string &label, Tensor<float> &sample, size_t current_index, size_t number);
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
 
 	private:
-		void _process(const std::string &label, Tensor<float> &in) const;
+		// The noise of a sample comes from its own stream, so it does not depend on the samples processed before.
+		void _process(const std::string &label, Tensor<float> &in, Philox &random_generator) const;
 
 		size_t _draw;
 		std::string _expName;
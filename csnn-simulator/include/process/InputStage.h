@@ -0,0 +1,53 @@
+#ifndef _PROCESS_INPUT_STAGE_H
+#define _PROCESS_INPUT_STAGE_H
+
+#include "Process.h"
+#include "Spike.h"
+
+#define INPUT_STAGE_SCALING 0
+#define INPUT_STAGE_LATENCY_CODING 1
+#define INPUT_STAGE_RANK_ORDER_CODING 2
+
+namespace process
+{
+
+	/**
+	 * @brief Scaling, thresholding and input coding of the raw frames in a single in-place pass, instead of MaxScaling followed by LatencyCoding or RankOrderCoding,
+	 * which each read the whole sample and allocate a new tensor. The coded sample holds the spike timestamps that the first layer converts to spikes,
+	 * INFINITE_TIME where there is no spike.
+	 *
+	 * With INPUT_STAGE_SCALING the values are only divided by max_value, like MaxScaling.
+	 * With INPUT_STAGE_LATENCY_CODING a scaled value v spikes at max(0, 1 - v), like LatencyCoding. With INPUT_STAGE_RANK_ORDER_CODING the values spike in decreasing order, like RankOrderCoding.
+	 * The scaled values below the threshold do not spike; the default threshold of 0 only drops negative values, so that the result is the same as the separate processes for frames.
+	 *
+	 * @param coding INPUT_STAGE_SCALING, INPUT_STAGE_LATENCY_CODING or INPUT_STAGE_RANK_ORDER_CODING.
+	 * @param max_value The raw value that is scaled to 1.
+	 * @param threshold The minimum scaled value that spikes.
+	 * @param max_timestamp With latency coding, the timestamps after it are dropped, 0 keeps them all.
+	 */
+	class InputStage : public UniquePassProcess
+	{
+
+	public:
+		InputStage();
+		InputStage(size_t coding, float max_value = 255.0f, float threshold = 0.0f, float max_timestamp = 0.0f);
+
+		virtual Shape compute_shape(const Shape &shape);
+		virtual void process_train(const std::string &label, Tensor<float> &sample);
+		virtual void process_test(const std::string &label, Tensor<float> &sample);
+
+	private:
+		void _process(Tensor<float> &in) const;
+		void _scale(float *data, size_t size) const;
+		void _latency_coding(float *data, size_t size) const;
+		void _rank_order_coding(float *data, size_t size) const;
+
+		size_t _coding;
+		float _max_value;
+		float _threshold;
+		float _max_timestamp;
+	};
+
+}
+
+#endif
@@ -4,7 +4,14 @@
 #include <filesystem>
 #include <iostream>
 #include "Process.h"
+#include "Parallel.h"
 #include "NumpyReader.h"
+
+/**
+ * @brief Default folder (relative to the build folder) and size limit in bytes of the optical flow cache, one file per frame pair.
+ */
+#define MOTION_GRID_CACHE_FOLDER "MotionGridCache"
+#define MOTION_GRID_CACHE_SIZE (static_cast<size_t>(4) << 30)
 /**
  * 	MotionGrid - GO CHECK PYTHON CODE IN /src/process/OpticalFlowProcess IN ORDER TO GENERATE MG
 */
@@ -18,6 +25,42 @@ namespace process
 
 		public:
 			MotionGridHelper() = delete;
+
+			/**
+			 * @brief Copies the frames of a (height, width, depth, frame) tensor, only the first depth is kept, see Tensor::tensor_to_matrices.
+			 */
+			static void tensor_to_frames(const Tensor<float> &in, std::vector<cv::Mat> &frames);
+
+			/**
+			 * @brief Farneback optical flow (CV_32FC2) from previous to next, flow is reused if it already has the right size.
+			 * If cache_directory is not empty, the flow is read from or saved in it, under a key made of the frame size and the hash of both frames,
+			 * so a frame pair of a video is computed once for all the runs and all the motion grids that use it.
+			 * No flow is added once the files of the folder reach cache_size bytes.
+			 */
+			static void optical_flow(const cv::Mat &previous, const cv::Mat &next, cv::Mat &flow, const std::string &cache_directory, size_t cache_size);
+
+			/**
+			 * @brief Splits a row of velocities: a = gain * v, clamped to [-255, 255], goes truncated in positive if a >= threshold, otherwise |a| goes truncated in negative.
+			 */
+			static void split_velocity(const float *v, float *negative, float *positive, size_t size, float gain, float threshold);
+
+			/**
+			 * @brief Splits a row of velocities: scaler * (|v| - v) / 2 goes in negative and scaler * (|v| + v) / 2 in positive, both clamped to 255 and truncated.
+			 */
+			static void split_direction(const float *v, float *negative, float *positive, size_t size, float scaler);
+
+			/**
+			 * @brief Row y of the frame placed at the cell (row, column) of a grid of height x width frames.
+			 */
+			static float *grid_row(cv::Mat &grid, size_t row, size_t column, size_t y, size_t height, size_t width)
+			{
+				return grid.ptr<float>(row * height + y) + column * width;
+			}
+
+			/**
+			 * @brief Converts the grid to a (height, width, 1, 1) tensor, resized to size first if size is not empty.
+			 */
+			static void grid_to_tensor(const cv::Mat &grid, const cv::Size &size, Tensor<float> &out);
 		};
 	}
 
@@ -32,7 +75,8 @@ namespace process
  * @param frames_total Number of frames that are used to create a grid.
  * @param mg_vertical_frames Number of vertical frames.
  * @param mg_horizontal_frames Number of horizontal frames.
- * 
+ *
+ * The frame pairs are processed in parallel, each one fills its own cell of the grid. Their optical flows can be cached on the disk with set_cache().
  */
 	class MotionGrid : public UniquePassProcess
 	{	
@@ -44,6 +88,11 @@ namespace process
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
 
+		/**
+		 * @brief Enables or disables the optical flow cache (disabled by default), see MotionGridHelper::optical_flow.
+		 */
+		void set_cache(bool cache, const std::string &directory = MOTION_GRID_CACHE_FOLDER, size_t size = MOTION_GRID_CACHE_SIZE);
+
 	private:
 		void _process(const std::string &label, Tensor<float> &in) const;
 
@@ -63,6 +112,10 @@ namespace process
 		size_t _height;
 		size_t _depth;
 		size_t _conv_depth;
+
+		// Empty when the cache is disabled.
+		std::string _cache_directory;
+		size_t _cache_size;
 	};
 
 }
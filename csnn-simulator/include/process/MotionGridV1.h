@@ -5,6 +5,7 @@
 #include <iostream>
 #include "Process.h"
 #include "NumpyReader.h"
+#include "process/MotionGrid.h"
 /**
  * 	MotionGridV1 - GO CHECK PYTHON CODE IN /src/process/OpticalFlowProcess IN ORDER TO GENERATE MG
  */
@@ -35,6 +36,11 @@ namespace process
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
 
+		/**
+		 * @brief Enables or disables the optical flow cache (disabled by default), see MotionGridHelper::optical_flow.
+		 */
+		void set_cache(bool cache, const std::string &directory = MOTION_GRID_CACHE_FOLDER, size_t size = MOTION_GRID_CACHE_SIZE);
+
 	private:
 		void _process(const std::string &label, Tensor<float> &in) const;
 
@@ -54,6 +60,10 @@ namespace process
 		size_t _height;
 		size_t _depth;
 		size_t _conv_depth;
+
+		// Empty when the cache is disabled.
+		std::string _cache_directory;
+		size_t _cache_size;
 	};
 
 }
@@ -15,6 +15,25 @@ namespace process {
 
 			static Tensor<float> generate_filter(size_t filter_size, float center_dev, float surround_dev);
 
+			/**
+			 * @brief Normalized 1D gaussian kernel. The 2D filter of generate_filter is the outer product of the center kernels minus
+			 * the outer product of the surround kernels, which allows to filter the rows and then the columns.
+			 */
+			static Tensor<float> generate_gaussian(size_t filter_size, float dev);
+
+			/**
+			 * @brief Filters each (z, k) plane of a (height, width, depth, conv_depth) tensor with the difference of the separable center and surround kernels,
+			 * the borders are replicated. The positive part goes in the channel z * 2 and the negative part in the channel z * 2 + 1 of out.
+			 * The rows are split between threads, each one filters the rows it needs horizontally then produces its output rows vertically.
+			 */
+			static void apply_separable_filter(const Tensor<float> &in, Tensor<float> &out, size_t height, size_t width, size_t depth, size_t conv_depth,
+											   const Tensor<float> &center, const Tensor<float> &surround);
+
+			/**
+			 * @brief Filters a (height, width, depth, conv_depth) tensor along conv_depth, the borders are replicated. The output channels are the same as apply_separable_filter.
+			 */
+			static void apply_temporal_filter(const Tensor<float> &in, Tensor<float> &out, size_t height, size_t width, size_t depth, size_t conv_depth,
+											  const Tensor<float> &filter);
 		};
 	}
 
@@ -48,7 +67,8 @@ namespace process {
 		size_t _height;
 		size_t _depth;
 		size_t _conv_depth;
-		Tensor<float> _filter;
+		Tensor<float> _center_filter;
+		Tensor<float> _surround_filter;
 	};
 
 	/**
@@ -11,11 +11,12 @@ namespace process
 
 	/**
 	 * @brief A type of pooling that reduces the size of the input sample by averaging the values of the each set of pixels in the pooling filter.
+	 * The sparse samples are pooled by adding each of their non-zero values to its pooled cell.
 	 * @param target_width The desired output width after pooling
 	 * @param target_height The desired output height after pooling
 	 * @param target_conv_depth The desired output depth after pooling
 	 */
-	class SumPooling : public UniquePassProcess
+	class SumPooling : public UniquePassProcess, public SparseProcess
 	{
 
 	public:
@@ -25,9 +26,12 @@ namespace process
 		virtual Shape compute_shape(const Shape &shape);
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
+		virtual void process_train_sparse(const std::string &label, SparseTensor<float> &sample);
+		virtual void process_test_sparse(const std::string &label, SparseTensor<float> &sample);
 
 	private:
 		void _process(Tensor<float> &sample) const;
+		void _process_sparse(SparseTensor<float> &sample);
 
 		size_t _target_width;
 		size_t _target_height;
@@ -37,15 +41,18 @@ namespace process
 		size_t _height;
 		size_t _depth;
 		size_t _conv_depth;
+
+		Tensor<float> _buffer;
 	};
 
 	/**
 	 * @brief A type of pooling that reduces the size of the input sample by selecting the maximum values of the each set of pixels in the pooling filter scope.
+	 * The sparse samples are pooled by comparing each of their non-zero values to its pooled cell.
 	 * @param target_width The desired output width after pooling
 	 * @param target_height The desired output height after pooling
 	 * @param target_depth The desired output depth after pooling
 	 */
-	class MaxPooling : public UniquePassProcess
+	class MaxPooling : public UniquePassProcess, public SparseProcess
 	{
 
 	public:
@@ -56,9 +63,12 @@ namespace process
 		virtual Shape compute_shape(const Shape &shape);
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
+		virtual void process_train_sparse(const std::string &label, SparseTensor<float> &sample);
+		virtual void process_test_sparse(const std::string &label, SparseTensor<float> &sample);
 
 	private:
 		void _process(Tensor<float> &sample) const;
+		void _process_sparse(SparseTensor<float> &sample);
 
 		size_t _target_width;
 		size_t _target_height;
@@ -68,6 +78,8 @@ namespace process
 		size_t _height;
 		size_t _depth;
 		size_t _conv_depth;
+
+		Tensor<float> _buffer;
 	};
 
 	/**
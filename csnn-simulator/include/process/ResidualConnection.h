@@ -33,8 +33,9 @@ namespace process
 
 		std::vector<std::string> _data_list;
 
-		std::vector<std::pair<std::string, Tensor<float>>> _train_set;
-		std::vector<std::pair<std::string, Tensor<float>>> _test_set;
+		// the original inputs are read one sample at a time, in the order of the samples.
+		std::unique_ptr<Input> _train_reader;
+		std::unique_ptr<Input> _test_reader;
 
 		size_t _width;
 		size_t _height;
@@ -5,17 +5,22 @@
 #include "Process.h"
 #include "tool/Operations.h"
 
+// Number of samples whose statistics are reduced together by the threads
+#define SCALING_BATCH_SIZE 64
+
 namespace process
 {
 	/**
 	 * @brief This function makes sure all the intensity values are avareged. So this value can be a decimal between 0 & 1.
 	 * This is needed before coding the intensities into spikes. Because the neural coding equation needs values between 0 & 1.
 	 *
+	 * FeatureScaling and ChannelScaling keep the samples of the first pass by batches of SCALING_BATCH_SIZE, whose min and max are reduced by several threads.
+	 * The sparse samples whose default value is 0 are reduced and scaled on their stored values, as long as the scaling keeps 0 at 0.
 	 */
 	 // counters for the progress bar
 	static int _train_scale_sample_count = 0;
 	static int _test_scale_sample_count = 0;
-	class FeatureScaling : public TwoPassProcess
+	class FeatureScaling : public TwoPassProcess, public SparseTwoPassProcess
 	{
 
 	public:
@@ -26,13 +31,30 @@ namespace process
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
 
+		virtual void compute_sparse(const std::string &label, const SparseTensor<float> &sample);
+		virtual void process_train_sparse(const std::string &label, SparseTensor<float> &sample);
+		virtual void process_test_sparse(const std::string &label, SparseTensor<float> &sample);
+
 	private:
+		void _reduce_batch();
+		void _update();
+		void _process(Tensor<float> &sample);
+		void _process_sparse(SparseTensor<float> &sample);
+
 		size_t _size;
 		Tensor<float> _min;
 		Tensor<float> _max;
+		Tensor<float> _range;
+		Tensor<float> _batch;
+		size_t _batch_count;
+		// Number of sparse samples that store each feature, the others hold 0
+		std::vector<uint32_t> _sparse_count;
+		size_t _sparse_sample_count;
+		bool _keep_zero;
+		bool _ready;
 	};
 
-	class ChannelScaling : public TwoPassProcess
+	class ChannelScaling : public TwoPassProcess, public SparseTwoPassProcess
 	{
 
 	public:
@@ -43,13 +65,32 @@ namespace process
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
 
+		virtual void compute_sparse(const std::string &label, const SparseTensor<float> &sample);
+		virtual void process_train_sparse(const std::string &label, SparseTensor<float> &sample);
+		virtual void process_test_sparse(const std::string &label, SparseTensor<float> &sample);
+
 	private:
+		void _reduce_batch();
+		void _update();
+		void _process(Tensor<float> &sample);
+		void _process_sparse(SparseTensor<float> &sample);
+
 		size_t _width;
 		size_t _height;
 		size_t _depth;
 		size_t _conv_depth;
 		Tensor<float> _min;
 		Tensor<float> _max;
+		// min, max and max-min of the channels repeated over the conv depth, in the order of the values of a pixel
+		Tensor<float> _pixel_min;
+		Tensor<float> _pixel_max;
+		Tensor<float> _pixel_range;
+		Tensor<float> _batch;
+		size_t _batch_count;
+		// Whether a sparse sample left a value of the channel at 0
+		std::vector<bool> _sparse_zero;
+		bool _keep_zero;
+		bool _ready;
 	};
 
 	class SampleScaling : public TwoPassProcess
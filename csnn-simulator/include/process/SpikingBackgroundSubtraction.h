@@ -22,24 +22,81 @@ namespace process
 		};
 	}
 
+	/**
+	 * @brief Streaming background model of spike events, frame by frame, for the frames of a sample or of a live stream such as dataset::DvsSpikes.
+	 * Each pixel (x, y, z) of shape keeps a background timestamp, the exponential moving average of its spike times: background += decay * (time - background),
+	 * a decay of 1 keeps only the last spike time. The background of a pixel is forgotten after lifetime frames without spike.
+	 *
+	 * A spike is a change when its timestamp differs from the background by more than threshold. The first spike of a pixel, or the first one after its background
+	 * was forgotten, only sets the background. Only the first spike of a pixel in a frame is used.
+	 * The state of the silent pixels is never visited, the cost of a frame is linear in its number of spikes, and reset() is constant time.
+	 */
+	class SpikingBackgroundModel
+	{
+	public:
+		SpikingBackgroundModel();
+		SpikingBackgroundModel(const Shape &shape, Time decay = 1.0f, Time threshold = 0.0f, size_t lifetime = 1);
+
+		/**
+		 * @brief Forgets the background of all the pixels.
+		 */
+		void reset();
+
+		/**
+		 * @brief Updates the background of the pixel of flat index shape().to_index(x, y, z) with a spike of the current frame.
+		 * Returns true if the spike is a change, difference is then the spike time minus the background.
+		 */
+		bool update(size_t pixel, Time time, Time &difference);
+
+		/**
+		 * @brief Starts the next frame.
+		 */
+		void next_frame();
+
+		/**
+		 * @brief Processes the spikes of one frame, such as one slice k of dataset::DvsSpikes::next_spikes, and starts the next one.
+		 * The changes are appended to out with the absolute difference as time,
+		 * with split at k = 2 * spike.k for a later spike than the background and 2 * spike.k + 1 for an earlier one, at k = spike.k otherwise.
+		 */
+		void process_frame(const std::vector<Spike> &in, std::vector<Spike> &out, bool split = true);
+
+		const Shape &shape() const;
+
+	private:
+		Shape _shape;
+		Time _decay;
+		Time _threshold;
+		uint64_t _lifetime;
+
+		uint64_t _frame;
+		std::vector<Time> _background;
+		// Frame of the last spike of each pixel, the background is valid if it is at most _lifetime frames old
+		std::vector<uint64_t> _last_frame;
+	};
+
 	/**
 	 * @brief SpikingBackgroundSubtraction applies background subtraction on the level of spiking timesptamps.
 	 * 
 	 * @param expName the name of the expirement
 	 * @param method 0 for seperating the information into two channels, 1 for keeping the information in the same channel with the _ve vales as abd value
+	 * @param threshold the minimum time difference of a change
+	 * @param decay the weight of a new spike in the background of a pixel, 1 compares each frame to the previous one
+	 * @param lifetime the number of frames without spike after which the background of a pixel is forgotten
+	 *
+	 * The frames of a sample go through a SpikingBackgroundModel, the first frame is compared again after the last one.
 	 */
 	class SpikingBackgroundSubtraction : public UniquePassProcess
 	{
 	public:
 		SpikingBackgroundSubtraction();
-		SpikingBackgroundSubtraction(std::string expName, size_t method = 0, size_t threshold = 0);
+		SpikingBackgroundSubtraction(std::string expName, size_t method = 0, size_t threshold = 0, float decay = 1.0f, size_t lifetime = 1);
 
 		virtual Shape compute_shape(const Shape &shape);
 		virtual void process_train(const std::string &label, Tensor<float> &sample);
 		virtual void process_test(const std::string &label, Tensor<float> &sample);
 
 	private:
-		void _process(const std::string &label, Tensor<float> &in) const;
+		void _process(const std::string &label, Tensor<float> &in);
 
 		std::string _expName;
 		size_t _method;
@@ -49,6 +106,12 @@ namespace process
 		size_t _depth;
 		size_t _conv_depth;
 		size_t _threshold;
+		float _decay;
+		size_t _lifetime;
+
+		SpikingBackgroundModel _model;
+		// Flat pixel index and time of the spikes of each frame
+		std::vector<std::vector<std::pair<size_t, Time>>> _frame_spikes;
 	};
 
 }
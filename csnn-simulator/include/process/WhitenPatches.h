@@ -8,13 +8,25 @@
 #include "Process.h"
 #include "Math.h"
 
+// Number of patches of a rank-k update of the covariance.
+#define WHITEN_PATCHES_BATCH_SIZE 256
+
 namespace process {
 
+	/**
+	 * @brief ZCA whitening filters learned on the patches of the training samples.
+	 *
+	 * The covariance of the patches is accumulated while they are extracted, by rank-k updates of WHITEN_PATCHES_BATCH_SIZE patches,
+	 * so the memory does not depend on max_sample. The patches are shifted by the first one, which keeps the accumulated values close to the centered ones.
+	 * The whitening matrix comes from the eigen decomposition of the covariance, only the pca_compress fraction of the largest eigenvalues is kept.
+	 *
+	 * If filename is set, the filters and the whitening matrix are saved in it once they are computed, WhitenPatchesLoader(filename) reloads them.
+	 */
 	class WhiteningPatches : public TwoPassProcess {
 
 	public:
 		WhiteningPatches();
-		WhiteningPatches(size_t patch_size, float eps, float pca_compress = 1.0, size_t stride = 1, size_t max_sample = std::numeric_limits<size_t>::max());
+		WhiteningPatches(size_t patch_size, float eps, float pca_compress = 1.0, size_t stride = 1, size_t max_sample = std::numeric_limits<size_t>::max(), const std::string& filename = "");
 
 		virtual Shape compute_shape(const Shape& shape);
 		virtual void compute(const std::string& label, const Tensor<float>& sample);
@@ -23,7 +35,11 @@ namespace process {
 
 		void save(const std::string& filename) const;
 
+		const Tensor<float>& whitening() const;
+
 	private:
+		void _update();
+		void _compute_filters(size_t depth);
 		void _apply(Tensor<float>& sample) const;
 
 		float _eps;
@@ -32,8 +48,18 @@ namespace process {
 		size_t _patch_size;
 		size_t _stride;
 		size_t _max_sample;
+		std::string _filename;
+
+		// Number of patches accumulated
+		size_t _count;
+		std::vector<float> _shift;
+		std::vector<double> _sum;
+		// Upper triangle of the sum of the outer products of the shifted patches
+		Tensor<float> _gram;
+		// Shifted patches waiting for the next update, one per row
+		std::vector<float> _batch;
 
-		std::vector<Tensor<float>> _list;
+		Tensor<float> _whitening;
 		std::vector<Tensor<float>> _filter;
 	};
 
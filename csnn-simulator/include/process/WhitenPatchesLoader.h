@@ -10,6 +10,10 @@
 
 namespace process {
 
+	/**
+	 * @brief Applies the whitening filters saved by WhiteningPatches, without computing them again.
+	 * The whitening matrix is also reloaded if the file has one.
+	 */
 	class WhitenPatchesLoader : public UniquePassProcess {
 
 	public:
@@ -20,6 +24,8 @@ namespace process {
 		virtual void process_train(const std::string& label, Tensor<float>& sample);
 		virtual void process_test(const std::string& label, Tensor<float>& sample);
 
+		const Tensor<float>& whitening() const;
+
 	private:
 		void _apply(Tensor<float>& sample) const;
 
@@ -30,6 +36,7 @@ namespace process {
 		size_t _stride;
 		size_t _max_sample;
 
+		Tensor<float> _whitening;
 		std::vector<Tensor<float>> _filter;
 	};
 
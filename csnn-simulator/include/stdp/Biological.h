@@ -20,6 +20,7 @@ namespace stdp
 		Biological(float alpha, Time tau);
 
 		virtual float process(float w, const Time pre, Time post);
+		virtual float process_silent(float w, uint32_t count);
 		virtual void adapt_parameters(float factor);
 
 	private:
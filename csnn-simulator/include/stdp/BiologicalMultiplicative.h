@@ -12,6 +12,7 @@ namespace stdp {
 		BiologicalMultiplicative(float alpha, float beta, Time tau);
 
 		virtual float process(float w, const Time pre, Time post);
+		virtual float process_silent(float w, uint32_t count);
 		virtual void adapt_parameters(float factor);
 	private:
 		float _alpha;
@@ -12,6 +12,7 @@ namespace stdp {
 		Linear(float alpha_p, float alpha_m);
 
 		virtual float process(float w, const Time pre, Time post);
+		virtual float process_silent(float w, uint32_t count);
 		virtual void adapt_parameters(float factor);
 	private:
 		float _alpha_p;
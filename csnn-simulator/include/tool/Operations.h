@@ -7,6 +7,9 @@
 #include <chrono>
 #include <thread>
 #include "SparseTensor.h"
+#include "FeatureStore.h"
+#include "JsonFeatureReader.h"
+#include <memory>
 
 /**
  * @brief This function re-loads the descriptors that are previously saved using the SavePairVector.
@@ -19,6 +22,14 @@
  */
 void LoadPairVector(std::string fileName, std::vector<std::pair<std::string, Tensor<float>>> &output);
 
+/**
+ * @brief Opens a saved feature file as an Input that yields one sample at a time, a FeatureStoreReader for the binary feature stores
+ * and a JsonFeatureReader for the legacy JSON files. Use it instead of LoadPairVector when the samples are consumed in order.
+ *
+ * @param fileName The location of the feature file.
+ */
+std::unique_ptr<Input> OpenFeatureReader(const std::string &fileName);
+
 /**
  * @brief Loads the labels from a JSON file.
  *
@@ -76,12 +87,14 @@ void SaveString(std::string fileName, std::string stringToSave);
 
 /**
  * @brief Saves pairs of (label and tensor) that represent the extracted features normalized between 0 & 1 that go directly into the SVM.
+ * The file is a feature store (see FeatureStore.h).
  *
  */
 void SaveInputPairVector(std::string fileName, std::vector<std::pair<std::string, SparseTensor<float>>> output);
 
 /**
  * @brief Saves pairs of (label and tensor) that represent the extracted features that go directly into the SVM.
+ * The file is a feature store (see FeatureStore.h).
  *
  * @param fileName
  * @param output
@@ -89,7 +102,7 @@ void SaveInputPairVector(std::string fileName, std::vector<std::pair<std::string
 void SavePairVector(std::string fileName, std::vector<std::pair<std::string, SparseTensor<float>>> output);
 
 /**
- * @brief Saves a tensor of time.
+ * @brief Appends a tensor of time to a feature store, the file is created by the first call.
  *
  * @param fileName
  * @param output
@@ -97,7 +110,7 @@ void SavePairVector(std::string fileName, std::vector<std::pair<std::string, Spa
 void SaveTimeTensor(std::string fileName, Tensor<Time> output);
 
 /**
- * @brief Saves a Feature.
+ * @brief Saves a Feature in a feature store, the file is created at the first sample (sample_index == 1) and closed at the last one.
  *
  * @param fileName
  * @param output
@@ -0,0 +1,20 @@
+#ifndef _TOOL_SHARD_MERGE_H
+#define _TOOL_SHARD_MERGE_H
+
+#include <string>
+#include <vector>
+
+namespace tool
+{
+	/**
+	 * @brief Reassembles the features extracted by the shards of an experiment (see Input::shard) in a single file.
+	 * The shards are contiguous ranges of samples, so the files are concatenated in the given order, which has to be the shard order.
+	 * Feature stores (FeatureStore.h) and tensor files (TensorWriter.h) are supported, all the shards have to be in the same format.
+	 *
+	 * @param shard_files the feature files of the shards 0 to n-1.
+	 * @param output_file the merged file, in the format of the shards.
+	 */
+	void merge_shards(const std::vector<std::string> &shard_files, const std::string &output_file);
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _TOOL_SNAPSHOT_WRITER_H
+#define _TOOL_SNAPSHOT_WRITER_H
+
+#include <string>
+#include <deque>
+#include <set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Tensor.h"
+
+namespace tool
+{
+
+	/**
+	 * @brief Writes the weight snapshots, weight drawings and spiking neuron logs of a layer in a background thread.
+	 * Each request holds its own copy of the data, so training can continue while the files are written.
+	 * Directories are created once, the first time they are used.
+	 */
+	class SnapshotWriter
+	{
+
+	public:
+		SnapshotWriter();
+		~SnapshotWriter();
+
+		SnapshotWriter(const SnapshotWriter &that) = delete;
+		SnapshotWriter &operator=(const SnapshotWriter &that) = delete;
+
+		void save_weights(const std::string &directory, const std::string &file_name, const std::string &label, const Tensor<float> &w);
+		void draw_weights(const std::string &directory, const std::string &file_name, const Tensor<float> &w);
+		void log_spiking_neuron(const std::string &directory, const std::string &file_name, const std::string &label, size_t neuron);
+
+		/**
+		 * @brief Blocks until all the pending requests are written.
+		 */
+		void wait();
+
+	private:
+		void _push(const std::string &directory, std::function<void()> job);
+		void _run();
+
+		std::thread _thread;
+		std::mutex _mutex;
+		std::condition_variable _pending;
+		std::condition_variable _done;
+		std::deque<std::pair<std::string, std::function<void()>>> _jobs;
+		std::set<std::string> _directories;
+		bool _busy;
+		bool _stop;
+	};
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#include "DiskCache.h"
+#include <filesystem>
+#include <map>
+#include <mutex>
+
+bool reserve_disk_cache(const std::string &directory, size_t size, size_t limit)
+{
+	// Bytes used by each cache folder
+	static std::map<std::string, size_t> used;
+	static std::mutex mutex;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = used.find(directory);
+	if (it == std::end(used))
+	{
+		size_t total = 0;
+		std::error_code error;
+		for (std::filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error))
+		{
+			if (entry->is_regular_file(error))
+				total += entry->file_size(error);
+		}
+		it = used.emplace(directory, total).first;
+	}
+
+	if (it->second + size > limit)
+		return false;
+
+	it->second += size;
+	return true;
+}
@@ -17,7 +17,7 @@ AbstractExperiment::AbstractExperiment(const std::string& name) :
 #ifdef ENABLE_QT
 	_app(nullptr),
 #endif
-	_logger(), _log(_logger.create()), _print(_logger.create()), _name(name), _random_generator(),
+	_logger(), _log(_logger.create()), _print(_logger.create()), _name(name), _random_generator(), _seed(0),
 	_input_shape(nullptr), _time_limit(1.0), _train_data(), _test_data(), _process_list(),
 #ifdef ENABLE_QT
 	_plots(),
@@ -44,6 +44,7 @@ AbstractExperiment::AbstractExperiment(const std::string& name) :
 
 	std::seed_seq seed(std::begin(_name), std::end(_name));
 	_random_generator.seed(seed);
+	_seed = Philox::seed_from(_name);
 
 
 
@@ -140,18 +141,20 @@ void AbstractExperiment::initialize(const Shape& input_shape) {
 	_input_layer->converter()._initialize(_random_generator);*/
 	for(size_t i=0; i<_process_list.size(); i++) {
 		_process_list[i]->resize(i == 0 ? *_input_shape : _process_list[i-1]->shape());
-		_process_list[i]->_initialize(_random_generator);
+		std::default_random_engine random_generator = _stream_generator(i);
+		_process_list[i]->_initialize(random_generator);
 	}
 
 	for(size_t i=0; i<_outputs.size(); i++) {
-		_outputs[i]->converter()._initialize(_random_generator);
+		std::default_random_engine random_generator = _stream_generator(_process_list.size()+i);
+		_outputs[i]->converter()._initialize(random_generator);
 
 		for(size_t j=0; j<_outputs[i]->postprocessing().size(); j++) {
-			_outputs[i]->postprocessing()[j]->_initialize(_random_generator);
+			_outputs[i]->postprocessing()[j]->_initialize(random_generator);
 		}
 
 		for(size_t j=0; j<_outputs[i]->analysis().size(); j++) {
-			_outputs[i]->analysis()[j]->_initialize(_random_generator);
+			_outputs[i]->analysis()[j]->_initialize(random_generator);
 		}
 	}
 }
@@ -185,7 +188,8 @@ void AbstractExperiment::run(size_t refresh_interval) {
 
 	for(size_t i=0; i<_process_list.size(); i++) {
 		current_shape = _process_list[i]->resize(current_shape);
-		_process_list[i]->_initialize(_random_generator);
+		std::default_random_engine random_generator = _stream_generator(i);
+		_process_list[i]->_initialize(random_generator);
 
 		_log << _process_list[i]->class_name() << " " << (i+1) << ": " << _process_list[i]->name() << " " << current_shape.to_string() << std::endl;
 		_process_list[i]->print_parameters(_log);
@@ -199,14 +203,15 @@ void AbstractExperiment::run(size_t refresh_interval) {
 		size_t output_index = _outputs[i]->index();
 		Shape current_output_shape = _process_list[output_index]->shape();
 		_log << "Output " << (i+1) << " of " << _process_list[output_index]->name() << " " << current_output_shape.to_string() << ": " << _outputs[i]->name()  << std::endl;
-		_outputs[i]->converter()._initialize(_random_generator);
+		std::default_random_engine random_generator = _stream_generator(_process_list.size()+i);
+		_outputs[i]->converter()._initialize(random_generator);
 		_outputs[i]->converter().print_parameters(_log);
 		_log << std::endl;
 		_log << std::endl;
 
 
 		for(size_t j=0; j<_outputs[i]->postprocessing().size(); j++) {
-			_outputs[i]->postprocessing()[j]->_initialize(_random_generator);
+			_outputs[i]->postprocessing()[j]->_initialize(random_generator);
 			_outputs[i]->postprocessing()[j]->resize(current_output_shape);
 			current_output_shape = _outputs[i]->postprocessing()[j]->shape();
 			_log << "Output " << (i+1) << ", Postprocess " << (j+1) << " " << current_output_shape.to_string() << ":" << std::endl;
@@ -217,7 +222,7 @@ void AbstractExperiment::run(size_t refresh_interval) {
 
 		for(size_t j=0; j<_outputs[i]->analysis().size(); j++) {
 			_log << "Output " << (i+1) << ", Analysis: " << (j+1) << std::endl;
-			_outputs[i]->analysis()[j]->_initialize(_random_generator);
+			_outputs[i]->analysis()[j]->_initialize(random_generator);
 			_outputs[i]->analysis()[j]->resize(current_output_shape);
 			_outputs[i]->analysis()[j]->print_parameters(_log);
 			_log << std::endl;
@@ -310,6 +315,18 @@ OutputStream& AbstractExperiment::print() const {
 std::default_random_engine& AbstractExperiment::random_generator() {
 	return _random_generator;
 }
+
+Philox AbstractExperiment::random_stream(size_t stream, size_t epoch, size_t sample) const {
+	return Philox(_seed, stream, epoch, sample);
+}
+
+// Engine used to initialize the parameters of one process (or output), independent of the other ones.
+// It uses the reserved initialization epoch so that it does not share its counter with the first training sample of the process.
+std::default_random_engine AbstractExperiment::_stream_generator(size_t stream) const {
+	Philox philox = random_stream(stream, PHILOX_INITIALIZATION_EPOCH);
+	std::seed_seq seed{philox(), philox(), philox(), philox()};
+	return std::default_random_engine(seed);
+}
 /*
 InputLayer& AbstractExperiment::input_layer() {
 	return *_input_layer;
@@ -0,0 +1,425 @@
+#include "FeatureStore.h"
+#include <cstring>
+
+template<typename T>
+static void append_value(std::vector<char>& buffer, T value) {
+	size_t size = buffer.size();
+	buffer.resize(size+sizeof(T));
+	std::memcpy(buffer.data()+size, &value, sizeof(T));
+}
+
+template<typename T>
+static T extract(const std::vector<char>& buffer, size_t& cursor) {
+	if(cursor+sizeof(T) > buffer.size()) {
+		throw std::runtime_error("Feature store: truncated chunk");
+	}
+	T value;
+	std::memcpy(&value, buffer.data()+cursor, sizeof(T));
+	cursor += sizeof(T);
+	return value;
+}
+
+static void append_varint(std::vector<char>& buffer, uint32_t value) {
+	while(value >= 0x80) {
+		buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back(static_cast<char>(value));
+}
+
+static uint32_t extract_varint(const std::vector<char>& buffer, size_t& cursor) {
+	uint32_t value = 0;
+	for(size_t shift = 0; shift < 35; shift += 7) {
+		if(cursor >= buffer.size()) {
+			throw std::runtime_error("Feature store: truncated chunk");
+		}
+		uint8_t byte = static_cast<uint8_t>(buffer[cursor++]);
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if((byte & 0x80) == 0) {
+			break;
+		}
+	}
+	return value;
+}
+
+//
+//	FeatureStoreWriter
+//
+
+FeatureStoreWriter::FeatureStoreWriter() : _file(), _shape(), _varint_indices(true), _sample_count(0), _labels(), _label_table(),
+	_chunk(), _chunk_sample_count(0), _count_position() {
+
+}
+
+FeatureStoreWriter::FeatureStoreWriter(const std::string& filename, const Shape& shape, bool varint_indices) : FeatureStoreWriter() {
+	open(filename, shape, varint_indices);
+}
+
+FeatureStoreWriter::~FeatureStoreWriter() {
+	close();
+}
+
+void FeatureStoreWriter::open(const std::string& filename, const Shape& shape, bool varint_indices) {
+	if(_file.is_open()) {
+		throw std::runtime_error("File already open");
+	}
+
+	// Truncated, a rerun replaces the previous file instead of appending to it.
+	_file.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+	if(!_file.is_open()) {
+		throw std::runtime_error("Unable to open "+filename);
+	}
+
+	_shape = shape;
+	_varint_indices = varint_indices;
+	_sample_count = 0;
+	_labels.clear();
+	_label_table.clear();
+	_chunk.clear();
+	_chunk.reserve(FEATURE_STORE_CHUNK_SIZE+4096);
+	_chunk_sample_count = 0;
+
+	std::vector<char> header;
+	append_value<uint32_t>(header, FEATURE_STORE_MAGIC);
+	append_value<uint8_t>(header, FEATURE_STORE_VERSION);
+	append_value<uint8_t>(header, varint_indices ? FEATURE_STORE_VARINT_INDICES : 0);
+	append_value<uint8_t>(header, FEATURE_STORE_FLOAT32);
+	append_value<uint8_t>(header, shape.number());
+	for(size_t i=0; i<shape.number(); i++) {
+		append_value<uint32_t>(header, shape.dim(i));
+	}
+	_file.write(header.data(), header.size());
+
+	_count_position = _file.tellp();
+	uint64_t zero = 0;
+	_file.write(reinterpret_cast<const char*>(&zero), sizeof(uint64_t));
+	_file.write(reinterpret_cast<const char*>(&zero), sizeof(uint64_t));
+}
+
+void FeatureStoreWriter::append(const std::string& filename, const Shape& shape, bool varint_indices) {
+	if(_file.is_open()) {
+		throw std::runtime_error("File already open");
+	}
+
+	if(!std::ifstream(filename).good()) {
+		open(filename, shape, varint_indices);
+		return;
+	}
+
+	std::vector<std::string> label_table;
+	uint64_t sample_count = 0;
+	{
+		FeatureStoreReader reader(filename);
+		if(reader.shape() != shape) {
+			throw std::runtime_error(filename+": unexpected shape "+shape.to_string()+", the store has "+reader.shape().to_string());
+		}
+		label_table = reader.labels();
+		sample_count = reader.size();
+		_varint_indices = reader.varint_indices();
+	}
+
+	_file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+	if(!_file.is_open()) {
+		throw std::runtime_error("Unable to open "+filename);
+	}
+
+	// The header is fixed size: magic, version, flags, dtype, dimension number, dimensions, then the sample count and the label table offset.
+	_count_position = sizeof(uint32_t)+4*sizeof(uint8_t)+shape.number()*sizeof(uint32_t);
+	uint64_t label_table_offset = 0;
+	_file.seekg(static_cast<std::streamoff>(_count_position)+sizeof(uint64_t));
+	_file.read(reinterpret_cast<char*>(&label_table_offset), sizeof(uint64_t));
+
+	// The new chunks replace the label table, close() writes it again after them.
+	_file.seekp(label_table_offset);
+
+	_shape = shape;
+	_sample_count = sample_count;
+	_labels.clear();
+	_label_table = label_table;
+	for(size_t i=0; i<_label_table.size(); i++) {
+		_labels.emplace(_label_table[i], i);
+	}
+	_chunk.clear();
+	_chunk.reserve(FEATURE_STORE_CHUNK_SIZE+4096);
+	_chunk_sample_count = 0;
+}
+
+void FeatureStoreWriter::write(const std::string& label, const SparseTensor<float>& t) {
+	if(!_file.is_open()) {
+		throw std::runtime_error("No open file");
+	}
+
+	if(t.shape() != _shape) {
+		throw std::runtime_error("Feature store: unexpected shape "+t.shape().to_string()+", expected "+_shape.to_string());
+	}
+
+	auto it = _labels.find(label);
+	if(it == std::end(_labels)) {
+		it = _labels.emplace(label, _label_table.size()).first;
+		_label_table.push_back(label);
+	}
+
+	const std::vector<std::pair<uint32_t, float>>& values = t.values();
+	append_value<uint32_t>(_chunk, it->second);
+	append_value<float>(_chunk, t.default_value());
+	append_value<uint32_t>(_chunk, values.size());
+
+	uint32_t previous = 0;
+	for(const std::pair<uint32_t, float>& value : values) {
+		if(_varint_indices) {
+			append_varint(_chunk, value.first-previous);
+			previous = value.first;
+		}
+		else {
+			append_value<uint32_t>(_chunk, value.first);
+		}
+	}
+	for(const std::pair<uint32_t, float>& value : values) {
+		append_value<float>(_chunk, value.second);
+	}
+
+	_chunk_sample_count++;
+	_sample_count++;
+
+	if(_chunk.size() >= FEATURE_STORE_CHUNK_SIZE) {
+		_flush_chunk();
+	}
+}
+
+void FeatureStoreWriter::write(const std::string& label, const Tensor<float>& t) {
+	write(label, to_sparse_tensor(t));
+}
+
+void FeatureStoreWriter::close() {
+	if(!_file.is_open()) {
+		return;
+	}
+
+	_flush_chunk();
+
+	uint64_t label_table_offset = _file.tellp();
+	std::vector<char> table;
+	append_value<uint32_t>(table, _label_table.size());
+	for(const std::string& label : _label_table) {
+		append_value<uint16_t>(table, label.size());
+		table.insert(std::end(table), std::begin(label), std::end(label));
+	}
+	_file.write(table.data(), table.size());
+
+	_file.seekp(_count_position);
+	_file.write(reinterpret_cast<const char*>(&_sample_count), sizeof(uint64_t));
+	_file.write(reinterpret_cast<const char*>(&label_table_offset), sizeof(uint64_t));
+	_file.close();
+}
+
+bool FeatureStoreWriter::is_open() const {
+	return _file.is_open();
+}
+
+void FeatureStoreWriter::_flush_chunk() {
+	if(_chunk_sample_count == 0) {
+		return;
+	}
+
+	uint32_t size = _chunk.size();
+	_file.write(reinterpret_cast<const char*>(&_chunk_sample_count), sizeof(uint32_t));
+	_file.write(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+	_file.write(_chunk.data(), _chunk.size());
+
+	_chunk.clear();
+	_chunk_sample_count = 0;
+}
+
+//
+//	FeatureStoreReader
+//
+
+FeatureStoreReader::FeatureStoreReader() : _name(), _file(), _shape(), _varint_indices(false), _sample_count(0), _cursor(0), _label_table(),
+	_data_position(), _chunk(), _chunk_cursor(0), _chunk_remaining(0) {
+
+}
+
+FeatureStoreReader::FeatureStoreReader(const std::string& filename) : FeatureStoreReader() {
+	open(filename);
+}
+
+FeatureStoreReader::~FeatureStoreReader() {
+	close();
+}
+
+bool FeatureStoreReader::is_feature_store(const std::string& filename) {
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	uint32_t magic = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
+	return file.good() && magic == FEATURE_STORE_MAGIC;
+}
+
+void FeatureStoreReader::open(const std::string& filename) {
+	if(_file.is_open()) {
+		throw std::runtime_error("File already open");
+	}
+
+	_name = filename;
+	_file.open(filename, std::ios::in | std::ios::binary);
+	if(!_file.is_open()) {
+		throw std::runtime_error("Unable to open "+filename);
+	}
+
+	uint32_t magic = 0;
+	uint8_t version = 0, flags = 0, dtype = 0, dim_number = 0;
+	_file.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
+	_file.read(reinterpret_cast<char*>(&version), sizeof(uint8_t));
+	_file.read(reinterpret_cast<char*>(&flags), sizeof(uint8_t));
+	_file.read(reinterpret_cast<char*>(&dtype), sizeof(uint8_t));
+	_file.read(reinterpret_cast<char*>(&dim_number), sizeof(uint8_t));
+
+	if(magic != FEATURE_STORE_MAGIC || version != FEATURE_STORE_VERSION || dtype != FEATURE_STORE_FLOAT32) {
+		throw std::runtime_error(filename+": not a feature store file");
+	}
+	_varint_indices = (flags & FEATURE_STORE_VARINT_INDICES) != 0;
+
+	std::vector<size_t> dims;
+	for(size_t i=0; i<dim_number; i++) {
+		uint32_t dim = 0;
+		_file.read(reinterpret_cast<char*>(&dim), sizeof(uint32_t));
+		dims.push_back(dim);
+	}
+	_shape = Shape(dims);
+
+	uint64_t label_table_offset = 0;
+	_file.read(reinterpret_cast<char*>(&_sample_count), sizeof(uint64_t));
+	_file.read(reinterpret_cast<char*>(&label_table_offset), sizeof(uint64_t));
+	_data_position = _file.tellg();
+
+	if(!_file.good() || label_table_offset == 0) {
+		throw std::runtime_error(filename+": incomplete feature store (not closed)");
+	}
+
+	_file.seekg(label_table_offset);
+	uint32_t label_number = 0;
+	_file.read(reinterpret_cast<char*>(&label_number), sizeof(uint32_t));
+	_label_table.clear();
+	for(size_t i=0; i<label_number; i++) {
+		uint16_t length = 0;
+		_file.read(reinterpret_cast<char*>(&length), sizeof(uint16_t));
+		std::string label(length, '\0');
+		_file.read(&label[0], length);
+		_label_table.push_back(label);
+	}
+
+	if(!_file.good()) {
+		throw std::runtime_error(filename+": corrupted label table");
+	}
+
+	reset();
+}
+
+bool FeatureStoreReader::has_next() const {
+	return _cursor < _sample_count;
+}
+
+std::pair<std::string, SparseTensor<float>> FeatureStoreReader::next_sparse() {
+	if(_chunk_remaining == 0) {
+		_read_chunk();
+	}
+
+	uint32_t label_id = extract<uint32_t>(_chunk, _chunk_cursor);
+	float default_value = extract<float>(_chunk, _chunk_cursor);
+	uint32_t count = extract<uint32_t>(_chunk, _chunk_cursor);
+
+	if(label_id >= _label_table.size()) {
+		throw std::runtime_error(_name+": unknown label id");
+	}
+
+	std::pair<std::string, SparseTensor<float>> out(_label_table[label_id], SparseTensor<float>(_shape, default_value));
+
+	std::vector<uint32_t> indices(count);
+	uint32_t previous = 0;
+	for(size_t i=0; i<count; i++) {
+		if(_varint_indices) {
+			previous += extract_varint(_chunk, _chunk_cursor);
+			indices[i] = previous;
+		}
+		else {
+			indices[i] = extract<uint32_t>(_chunk, _chunk_cursor);
+		}
+	}
+	for(size_t i=0; i<count; i++) {
+		out.second.add_index(indices[i], extract<float>(_chunk, _chunk_cursor));
+	}
+
+	_chunk_remaining--;
+	_cursor++;
+	return out;
+}
+
+std::pair<std::string, Tensor<InputType>> FeatureStoreReader::next() {
+	std::pair<std::string, SparseTensor<float>> sparse = next_sparse();
+	std::pair<std::string, Tensor<InputType>> out(sparse.first, _shape);
+	from_sparse_tensor(sparse.second, out.second);
+	return out;
+}
+
+void FeatureStoreReader::reset() {
+	_file.clear();
+	_file.seekg(_data_position);
+	_cursor = 0;
+	_chunk.clear();
+	_chunk_cursor = 0;
+	_chunk_remaining = 0;
+}
+
+void FeatureStoreReader::close() {
+	if(_file.is_open()) {
+		_file.close();
+	}
+}
+
+size_t FeatureStoreReader::size() const {
+	return _sample_count;
+}
+
+std::string FeatureStoreReader::to_string() const {
+	return "FeatureStoreReader("+_name+")["+std::to_string(_sample_count)+"]";
+}
+
+const Shape& FeatureStoreReader::shape() const {
+	return _shape;
+}
+
+const std::vector<std::string>& FeatureStoreReader::labels() const {
+	return _label_table;
+}
+
+bool FeatureStoreReader::varint_indices() const {
+	return _varint_indices;
+}
+
+void FeatureStoreReader::_read_chunk() {
+	uint32_t size = 0;
+	_file.read(reinterpret_cast<char*>(&_chunk_remaining), sizeof(uint32_t));
+	_file.read(reinterpret_cast<char*>(&size), sizeof(uint32_t));
+	_chunk.resize(size);
+	_file.read(_chunk.data(), size);
+	_chunk_cursor = 0;
+
+	if(!_file.good() || _chunk_remaining == 0) {
+		throw std::runtime_error(_name+": truncated feature store");
+	}
+}
+
+void SaveFeatureStore(const std::string& filename, const std::vector<std::pair<std::string, SparseTensor<float>>>& data, bool varint_indices) {
+	FeatureStoreWriter writer(filename, data.empty() ? Shape() : data[0].second.shape(), varint_indices);
+	for(const std::pair<std::string, SparseTensor<float>>& entry : data) {
+		writer.write(entry.first, entry.second);
+	}
+	writer.close();
+}
+
+void LoadFeatureStore(const std::string& filename, std::vector<std::pair<std::string, Tensor<float>>>& output) {
+	FeatureStoreReader reader(filename);
+	output.reserve(output.size()+reader.size());
+	while(reader.has_next()) {
+		output.emplace_back(reader.next());
+	}
+}
@@ -0,0 +1,345 @@
+#include "Inflate.h"
+#include <cstring>
+#include <stdexcept>
+
+#define INFLATE_MAX_BITS 15
+#define INFLATE_FAST_BITS 10
+
+namespace {
+
+	struct Huffman {
+		uint16_t count[INFLATE_MAX_BITS+1]; // number of codes of each length
+		uint16_t symbol[288]; // symbols ordered by code
+		uint16_t fast[1 << INFLATE_FAST_BITS]; // (symbol << 4) | length for the codes of at most INFLATE_FAST_BITS bits, 0 otherwise
+	};
+
+	const uint16_t length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	const uint16_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	const uint16_t distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+	const uint16_t distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+	const uint8_t code_length_order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	class InflateStream {
+
+	public:
+		InflateStream(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size) :
+			_in(in), _in_size(in_size), _in_cursor(0), _bit_buffer(0), _bit_count(0), _out(out), _out_size(out_size), _out_cursor(0) {
+
+		}
+
+		void run() {
+			bool last = false;
+			while(!last) {
+				last = bits(1) == 1;
+				uint32_t type = bits(2);
+
+				if(type == 0) {
+					_stored();
+				}
+				else if(type == 1) {
+					static const std::pair<Huffman, Huffman> fixed = _fixed_codes();
+					_codes(fixed.first, fixed.second);
+				}
+				else if(type == 2) {
+					Huffman length_code, distance_code;
+					_dynamic_codes(length_code, distance_code);
+					_codes(length_code, distance_code);
+				}
+				else {
+					throw std::runtime_error("inflate: invalid block type");
+				}
+			}
+
+			// The bit buffer is padded with zeros past the end of the input, check that none of them were used.
+			if(_in_cursor-_bit_count/8 > _in_size) {
+				throw std::runtime_error("inflate: truncated stream");
+			}
+			if(_out_cursor != _out_size) {
+				throw std::runtime_error("inflate: unexpected decompressed size");
+			}
+		}
+
+	private:
+		// Keeps at least 25 bits in the buffer.
+		void _fill() {
+			while(_bit_count <= 24) {
+				uint32_t byte = _in_cursor < _in_size ? _in[_in_cursor] : 0;
+				_in_cursor++;
+				_bit_buffer |= byte << _bit_count;
+				_bit_count += 8;
+			}
+		}
+
+		uint32_t bits(uint32_t n) {
+			_fill();
+			uint32_t value = _bit_buffer & ((1u << n)-1);
+			_bit_buffer >>= n;
+			_bit_count -= n;
+			return value;
+		}
+
+		uint32_t _decode(const Huffman& h) {
+			_fill();
+			uint16_t entry = h.fast[_bit_buffer & ((1u << INFLATE_FAST_BITS)-1)];
+			if(entry != 0) {
+				uint32_t length = entry & 0xF;
+				_bit_buffer >>= length;
+				_bit_count -= length;
+				return entry >> 4;
+			}
+
+			// Canonical decoding, one bit at a time
+			int code = 0, first = 0, index = 0;
+			for(uint32_t length=1; length<=INFLATE_MAX_BITS; length++) {
+				code |= (_bit_buffer >> (length-1)) & 1;
+				int count = h.count[length];
+				if(code-count < first) {
+					_bit_buffer >>= length;
+					_bit_count -= length;
+					return h.symbol[index+(code-first)];
+				}
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
+			throw std::runtime_error("inflate: invalid code");
+		}
+
+		static void _build(Huffman& h, const uint8_t* lengths, size_t n) {
+			std::memset(h.count, 0, sizeof(h.count));
+			std::memset(h.fast, 0, sizeof(h.fast));
+
+			for(size_t i=0; i<n; i++) {
+				h.count[lengths[i]]++;
+			}
+			h.count[0] = 0;
+
+			int left = 1;
+			for(size_t length=1; length<=INFLATE_MAX_BITS; length++) {
+				left <<= 1;
+				left -= h.count[length];
+				if(left < 0) {
+					throw std::runtime_error("inflate: over-subscribed code");
+				}
+			}
+
+			uint16_t offset[INFLATE_MAX_BITS+1];
+			uint16_t next_code[INFLATE_MAX_BITS+1];
+			offset[1] = 0;
+			next_code[1] = 0;
+			for(size_t length=1; length<INFLATE_MAX_BITS; length++) {
+				offset[length+1] = offset[length]+h.count[length];
+				next_code[length+1] = (next_code[length]+h.count[length]) << 1;
+			}
+
+			for(size_t symbol=0; symbol<n; symbol++) {
+				uint32_t length = lengths[symbol];
+				if(length == 0) {
+					continue;
+				}
+
+				h.symbol[offset[length]++] = symbol;
+
+				uint32_t code = next_code[length]++;
+				if(length <= INFLATE_FAST_BITS) {
+					// The codes are stored from the most significant bit, the stream is read from the least significant one
+					uint32_t reversed = 0;
+					for(uint32_t i=0; i<length; i++) {
+						reversed |= ((code >> i) & 1) << (length-1-i);
+					}
+					for(uint32_t i=reversed; i<(1u << INFLATE_FAST_BITS); i+=(1u << length)) {
+						h.fast[i] = (symbol << 4) | length;
+					}
+				}
+			}
+		}
+
+		static std::pair<Huffman, Huffman> _fixed_codes() {
+			uint8_t lengths[288];
+			size_t i = 0;
+			for(; i<144; i++) lengths[i] = 8;
+			for(; i<256; i++) lengths[i] = 9;
+			for(; i<280; i++) lengths[i] = 7;
+			for(; i<288; i++) lengths[i] = 8;
+
+			std::pair<Huffman, Huffman> codes;
+			_build(codes.first, lengths, 288);
+
+			for(i=0; i<30; i++) lengths[i] = 5;
+			_build(codes.second, lengths, 30);
+			return codes;
+		}
+
+		void _dynamic_codes(Huffman& length_code, Huffman& distance_code) {
+			uint32_t length_number = bits(5)+257;
+			uint32_t distance_number = bits(5)+1;
+			uint32_t code_number = bits(4)+4;
+
+			if(length_number > 286 || distance_number > 30) {
+				throw std::runtime_error("inflate: bad code counts");
+			}
+
+			uint8_t lengths[286+30];
+			std::memset(lengths, 0, 19);
+			for(size_t i=0; i<code_number; i++) {
+				lengths[code_length_order[i]] = bits(3);
+			}
+
+			Huffman length_length_code;
+			_build(length_length_code, lengths, 19);
+
+			size_t i = 0;
+			while(i < length_number+distance_number) {
+				uint32_t symbol = _decode(length_length_code);
+				if(symbol < 16) {
+					lengths[i++] = symbol;
+					continue;
+				}
+
+				uint8_t value = 0;
+				uint32_t repeat;
+				if(symbol == 16) {
+					if(i == 0) {
+						throw std::runtime_error("inflate: repeat with no first length");
+					}
+					value = lengths[i-1];
+					repeat = 3+bits(2);
+				}
+				else if(symbol == 17) {
+					repeat = 3+bits(3);
+				}
+				else {
+					repeat = 11+bits(7);
+				}
+
+				if(i+repeat > length_number+distance_number) {
+					throw std::runtime_error("inflate: too many lengths");
+				}
+				std::memset(lengths+i, value, repeat);
+				i += repeat;
+			}
+
+			if(lengths[256] == 0) {
+				throw std::runtime_error("inflate: no end of block code");
+			}
+
+			_build(length_code, lengths, length_number);
+			_build(distance_code, lengths+length_number, distance_number);
+		}
+
+		void _codes(const Huffman& length_code, const Huffman& distance_code) {
+			while(true) {
+				uint32_t symbol = _decode(length_code);
+				if(symbol < 256) {
+					if(_out_cursor >= _out_size) {
+						throw std::runtime_error("inflate: output overflow");
+					}
+					_out[_out_cursor++] = symbol;
+				}
+				else if(symbol == 256) {
+					return;
+				}
+				else {
+					symbol -= 257;
+					if(symbol >= 29) {
+						throw std::runtime_error("inflate: invalid length symbol");
+					}
+					size_t length = length_base[symbol]+bits(length_extra[symbol]);
+
+					symbol = _decode(distance_code);
+					if(symbol >= 30) {
+						throw std::runtime_error("inflate: invalid distance symbol");
+					}
+					size_t distance = distance_base[symbol]+bits(distance_extra[symbol]);
+
+					if(distance > _out_cursor) {
+						throw std::runtime_error("inflate: distance too far back");
+					}
+					if(_out_cursor+length > _out_size) {
+						throw std::runtime_error("inflate: output overflow");
+					}
+
+					uint8_t* dst = _out+_out_cursor;
+					const uint8_t* src = dst-distance;
+					if(distance >= length) {
+						std::memcpy(dst, src, length);
+					}
+					else {
+						// Overlapping copy, repeats the last distance bytes
+						for(size_t i=0; i<length; i++) {
+							dst[i] = src[i];
+						}
+					}
+					_out_cursor += length;
+				}
+			}
+		}
+
+		void _stored() {
+			// Back to the byte boundary, the bytes already in the bit buffer are given back to the input
+			_bit_buffer >>= _bit_count & 7;
+			_bit_count -= _bit_count & 7;
+			_in_cursor -= _bit_count/8;
+			_bit_buffer = 0;
+			_bit_count = 0;
+
+			if(_in_cursor+4 > _in_size) {
+				throw std::runtime_error("inflate: truncated stream");
+			}
+
+			uint32_t length = _in[_in_cursor] | (_in[_in_cursor+1] << 8);
+			uint32_t complement = _in[_in_cursor+2] | (_in[_in_cursor+3] << 8);
+			_in_cursor += 4;
+
+			if(length != (~complement & 0xFFFF)) {
+				throw std::runtime_error("inflate: stored block length mismatch");
+			}
+			if(_in_cursor+length > _in_size || _out_cursor+length > _out_size) {
+				throw std::runtime_error("inflate: stored block overflow");
+			}
+
+			std::memcpy(_out+_out_cursor, _in+_in_cursor, length);
+			_in_cursor += length;
+			_out_cursor += length;
+		}
+
+		const uint8_t* _in;
+		size_t _in_size;
+		size_t _in_cursor;
+		uint32_t _bit_buffer;
+		uint32_t _bit_count;
+
+		uint8_t* _out;
+		size_t _out_size;
+		size_t _out_cursor;
+	};
+
+}
+
+void inflate_raw(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size) {
+	InflateStream stream(in, in_size, out, out_size);
+	stream.run();
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+	static const struct Table {
+		uint32_t value[256];
+
+		Table() {
+			for(uint32_t i=0; i<256; i++) {
+				uint32_t c = i;
+				for(size_t k=0; k<8; k++) {
+					c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+				}
+				value[i] = c;
+			}
+		}
+	} table;
+
+	crc = ~crc;
+	for(size_t i=0; i<size; i++) {
+		crc = table.value[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
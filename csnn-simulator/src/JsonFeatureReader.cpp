@@ -0,0 +1,388 @@
+#include "JsonFeatureReader.h"
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+JsonFeatureReader::JsonFeatureReader() : _name(), _file(), _shape(), _buffer(JSON_FEATURE_READER_BUFFER_SIZE), _buffer_cursor(0), _buffer_size(0),
+	_has_next(false), _last(true), _label(), _dims(), _values(), _token() {
+
+}
+
+JsonFeatureReader::JsonFeatureReader(const std::string& filename) : JsonFeatureReader() {
+	open(filename);
+}
+
+JsonFeatureReader::~JsonFeatureReader() {
+	close();
+}
+
+void JsonFeatureReader::open(const std::string& filename) {
+	if(_file.is_open()) {
+		throw std::runtime_error("File already open");
+	}
+
+	_name = filename;
+	_file.open(filename, std::ios::in | std::ios::binary);
+	if(!_file.is_open()) {
+		throw std::runtime_error("Unable to open "+filename);
+	}
+
+	_start();
+	if(!_has_next) {
+		throw std::runtime_error(_name+": no sample in file");
+	}
+
+	_shape = Shape(_dims);
+}
+
+bool JsonFeatureReader::has_next() const {
+	return _has_next;
+}
+
+std::pair<std::string, SparseTensor<float>> JsonFeatureReader::next_sparse() {
+	if(!_has_next) {
+		throw std::runtime_error(_name+": no more sample");
+	}
+
+	// Same default value as to_sparse_tensor: 0 or the max value, whichever is the most frequent
+	size_t zero_counter = 0;
+	size_t max_counter = 0;
+	for(float value : _values) {
+		if(value == 0) {
+			zero_counter++;
+		}
+		else if(value == std::numeric_limits<float>::max()) {
+			max_counter++;
+		}
+	}
+
+	float default_value = zero_counter >= max_counter ? 0 : std::numeric_limits<float>::max();
+	std::pair<std::string, SparseTensor<float>> out(_label, SparseTensor<float>(Shape(_dims), default_value));
+	for(size_t i=0; i<_values.size(); i++) {
+		if(_values[i] != default_value) {
+			out.second.add_index(i, _values[i]);
+		}
+	}
+
+	if(_last) {
+		_has_next = false;
+	}
+	else {
+		_parse_sample();
+	}
+
+	return out;
+}
+
+std::pair<std::string, Tensor<InputType>> JsonFeatureReader::next() {
+	if(!_has_next) {
+		throw std::runtime_error(_name+": no more sample");
+	}
+
+	std::pair<std::string, Tensor<InputType>> out(_label, Shape(_dims));
+	std::copy(_values.begin(), _values.end(), out.second.begin());
+
+	if(_last) {
+		_has_next = false;
+	}
+	else {
+		_parse_sample();
+	}
+
+	return out;
+}
+
+void JsonFeatureReader::reset() {
+	_start();
+}
+
+void JsonFeatureReader::close() {
+	if(_file.is_open()) {
+		_file.close();
+	}
+	_has_next = false;
+}
+
+std::string JsonFeatureReader::to_string() const {
+	return "JsonFeatureReader("+_name+")";
+}
+
+const Shape& JsonFeatureReader::shape() const {
+	return _shape;
+}
+
+int JsonFeatureReader::_get() {
+	if(_buffer_cursor >= _buffer_size) {
+		_file.read(_buffer.data(), _buffer.size());
+		_buffer_size = _file.gcount();
+		_buffer_cursor = 0;
+		if(_buffer_size == 0) {
+			return EOF;
+		}
+	}
+	return static_cast<unsigned char>(_buffer[_buffer_cursor++]);
+}
+
+int JsonFeatureReader::_peek() {
+	int c = _get();
+	if(c != EOF) {
+		_buffer_cursor--;
+	}
+	return c;
+}
+
+int JsonFeatureReader::_skip_whitespace() {
+	int c = _peek();
+	while(c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+		_get();
+		c = _peek();
+	}
+	return c;
+}
+
+void JsonFeatureReader::_expect(char c) {
+	_skip_whitespace();
+	int v = _get();
+	if(v != c) {
+		throw std::runtime_error(_name+": expected '"+std::string(1, c)+"' in JSON feature file");
+	}
+}
+
+void JsonFeatureReader::_start() {
+	_file.clear();
+	_file.seekg(0);
+	_buffer_cursor = 0;
+	_buffer_size = 0;
+
+	_expect('[');
+	if(_skip_whitespace() == ']') {
+		_has_next = false;
+		_last = true;
+	}
+	else {
+		_parse_sample();
+	}
+}
+
+void JsonFeatureReader::_parse_sample() {
+	_label.clear();
+	_dims.clear();
+	_values.clear();
+
+	_expect('{');
+	bool first = true;
+	while(true) {
+		int c = _skip_whitespace();
+		if(c == '}') {
+			_get();
+			break;
+		}
+		if(!first) {
+			_expect(',');
+			_skip_whitespace();
+		}
+		first = false;
+
+		std::string key;
+		_parse_string(key);
+		_expect(':');
+		c = _skip_whitespace();
+
+		if(key == "label") {
+			if(c == '"') {
+				_parse_string(_label);
+			}
+			else {
+				float value;
+				_parse_number(value);
+				_label = _token;
+			}
+		}
+		else if(key.compare(0, 4, "dim_") == 0) {
+			size_t dim = std::stoul(key.substr(4));
+			float value;
+			_parse_number(value);
+			if(dim >= _dims.size()) {
+				_dims.resize(dim+1, 0);
+			}
+			_dims[dim] = static_cast<size_t>(value);
+		}
+		else if(key == "data") {
+			if(c == '"') {
+				_parse_data_string();
+			}
+			else {
+				_parse_data_array();
+			}
+		}
+		else {
+			_skip_value();
+		}
+	}
+
+	if(_dims.empty()) {
+		_dims.push_back(_values.size());
+	}
+
+	size_t product = 1;
+	for(size_t dim : _dims) {
+		product *= dim;
+	}
+	if(product != _values.size()) {
+		throw std::runtime_error(_name+": sample "+_label+" has "+std::to_string(_values.size())+" values, expected "+std::to_string(product));
+	}
+
+	int c = _skip_whitespace();
+	_get();
+	if(c == ',') {
+		_last = false;
+	}
+	else if(c == ']') {
+		_last = true;
+	}
+	else {
+		throw std::runtime_error(_name+": unexpected end of JSON feature file");
+	}
+	_has_next = true;
+}
+
+void JsonFeatureReader::_parse_string(std::string& out) {
+	if(_get() != '"') {
+		throw std::runtime_error(_name+": expected string in JSON feature file");
+	}
+
+	out.clear();
+	while(true) {
+		int c = _get();
+		if(c == EOF) {
+			throw std::runtime_error(_name+": unterminated string in JSON feature file");
+		}
+		if(c == '"') {
+			break;
+		}
+		if(c == '\\') {
+			c = _get();
+			switch(c) {
+			case 'n': c = '\n'; break;
+			case 't': c = '\t'; break;
+			case 'r': c = '\r'; break;
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'u':
+				// Labels are ASCII, keep the low byte of the code point
+				{
+					char hex[5] = {0};
+					for(size_t i=0; i<4; i++) {
+						hex[i] = static_cast<char>(_get());
+					}
+					c = std::strtol(hex, nullptr, 16) & 0xFF;
+				}
+				break;
+			default: break;
+			}
+		}
+		out.push_back(static_cast<char>(c));
+	}
+}
+
+void JsonFeatureReader::_parse_number(float& out) {
+	_token.clear();
+	int c = _peek();
+	while(c != EOF && c != ',' && c != ']' && c != '}' && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+		_token.push_back(static_cast<char>(_get()));
+		c = _peek();
+	}
+
+	if(_token == "null") {
+		out = 0;
+		return;
+	}
+
+	const char* begin = _token.data();
+	const char* end = begin+_token.size();
+	std::from_chars_result result = std::from_chars(begin, end, out);
+	if(result.ec != std::errc() || result.ptr != end) {
+		throw std::runtime_error(_name+": invalid number \""+_token+"\" in JSON feature file");
+	}
+}
+
+void JsonFeatureReader::_parse_data_array() {
+	_expect('[');
+	if(_skip_whitespace() == ']') {
+		_get();
+		return;
+	}
+
+	while(true) {
+		float value;
+		_skip_whitespace();
+		_parse_number(value);
+		_values.push_back(value);
+
+		int c = _skip_whitespace();
+		_get();
+		if(c == ']') {
+			break;
+		}
+		if(c != ',') {
+			throw std::runtime_error(_name+": expected ',' or ']' in data array");
+		}
+	}
+}
+
+void JsonFeatureReader::_parse_data_string() {
+	std::string data;
+	_parse_string(data);
+
+	const char* cursor = data.data();
+	const char* end = cursor+data.size();
+	while(cursor < end) {
+		if(std::strchr("[], \t\r\n", *cursor) != nullptr) {
+			cursor++;
+			continue;
+		}
+
+		float value;
+		std::from_chars_result result = std::from_chars(cursor, end, value);
+		if(result.ec != std::errc()) {
+			throw std::runtime_error(_name+": invalid number in data string");
+		}
+		_values.push_back(value);
+		cursor = result.ptr;
+	}
+}
+
+void JsonFeatureReader::_skip_value() {
+	int c = _skip_whitespace();
+	if(c == '"') {
+		_parse_string(_token);
+	}
+	else if(c == '{' || c == '[') {
+		size_t depth = 0;
+		do {
+			c = _peek();
+			if(c == '"') {
+				_parse_string(_token);
+				continue;
+			}
+			_get();
+			if(c == '{' || c == '[') {
+				depth++;
+			}
+			else if(c == '}' || c == ']') {
+				depth--;
+			}
+			else if(c == EOF) {
+				throw std::runtime_error(_name+": unexpected end of JSON feature file");
+			}
+		} while(depth > 0);
+	}
+	else {
+		_token.clear();
+		c = _peek();
+		while(c != EOF && c != ',' && c != '}' && c != ']' && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+			_token.push_back(static_cast<char>(_get()));
+			c = _peek();
+		}
+	}
+}
@@ -1,4 +1,9 @@
 #include "Math.h"
+#include "Parallel.h"
+
+// Minimum number of values by thread of the element-wise operations and the transpose
+#define MATH_PARALLEL_SIZE (1 << 18)
+#define MATH_TRANSPOSE_BLOCK 32
 
 Tensor<float> _priv::MathHelper::unary_arithmetic_operator(const Tensor<float>& in) {
 	return Tensor<float>(in.shape());
@@ -11,13 +16,48 @@ Tensor<float> _priv::MathHelper::binary_arithmetic_operator(const Tensor<float>&
 	return Tensor<float>(lhs.shape());
 }
 
-Tensor<float> add(const Tensor<float>& lhs, const Tensor<float>& rhs) {
-	Tensor<float> out = _priv::MathHelper::binary_arithmetic_operator(lhs, rhs);
+namespace {
 
-	for(size_t i=0; i<out.shape().product(); i++) {
-		out.at_index(i) = lhs.at_index(i)+rhs.at_index(i);
+	template<typename Operator>
+	void elementwise(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out, Operator op) {
+		if(lhs.shape() != rhs.shape()) {
+			throw std::runtime_error("Incompatible shape ("+lhs.shape().to_string()+" "+rhs.shape().to_string()+")");
+		}
+		if(out.shape() != lhs.shape()) {
+			out = Tensor<float>(lhs.shape());
+		}
+
+		const float* l = lhs.begin();
+		const float* r = rhs.begin();
+		float* o = out.begin();
+		parallel_range(lhs.shape().product(), MATH_PARALLEL_SIZE, [l, r, o, op](size_t, size_t start, size_t end) {
+			for(size_t i=start; i<end; i++) {
+				o[i] = op(l[i], r[i]);
+			}
+		});
 	}
 
+}
+
+void add(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out) {
+	elementwise(lhs, rhs, out, [](float l, float r) { return l+r; });
+}
+
+void sub(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out) {
+	elementwise(lhs, rhs, out, [](float l, float r) { return l-r; });
+}
+
+void mul(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out) {
+	elementwise(lhs, rhs, out, [](float l, float r) { return l*r; });
+}
+
+void div(const Tensor<float>& lhs, const Tensor<float>& rhs, Tensor<float>& out) {
+	elementwise(lhs, rhs, out, [](float l, float r) { return l/r; });
+}
+
+Tensor<float> add(const Tensor<float>& lhs, const Tensor<float>& rhs) {
+	Tensor<float> out = _priv::MathHelper::binary_arithmetic_operator(lhs, rhs);
+	add(lhs, rhs, out);
 	return out;
 }
 
@@ -25,13 +65,14 @@ Tensor<float> operator+(const Tensor<float>& lhs, const Tensor<float>& rhs) {
 	return add(lhs, rhs);
 }
 
+Tensor<float> operator+(Tensor<float>&& lhs, const Tensor<float>& rhs) {
+	add(lhs, rhs, lhs);
+	return std::move(lhs);
+}
+
 Tensor<float> sub(const Tensor<float>& lhs, const Tensor<float>& rhs) {
 	Tensor<float> out = _priv::MathHelper::binary_arithmetic_operator(lhs, rhs);
-
-	for(size_t i=0; i<out.shape().product(); i++) {
-		out.at_index(i) = lhs.at_index(i)-rhs.at_index(i);
-	}
-
+	sub(lhs, rhs, out);
 	return out;
 }
 
@@ -39,13 +80,14 @@ Tensor<float> operator-(const Tensor<float>& lhs, const Tensor<float>& rhs) {
 	return sub(lhs, rhs);
 }
 
+Tensor<float> operator-(Tensor<float>&& lhs, const Tensor<float>& rhs) {
+	sub(lhs, rhs, lhs);
+	return std::move(lhs);
+}
+
 Tensor<float> mul(const Tensor<float>& lhs, const Tensor<float>& rhs) {
 	Tensor<float> out = _priv::MathHelper::binary_arithmetic_operator(lhs, rhs);
-
-	for(size_t i=0; i<out.shape().product(); i++) {
-		out.at_index(i) = lhs.at_index(i)*rhs.at_index(i);
-	}
-
+	mul(lhs, rhs, out);
 	return out;
 }
 
@@ -53,13 +95,14 @@ Tensor<float> operator*(const Tensor<float>& lhs, const Tensor<float>& rhs) {
 	return mul(lhs, rhs);
 }
 
+Tensor<float> operator*(Tensor<float>&& lhs, const Tensor<float>& rhs) {
+	mul(lhs, rhs, lhs);
+	return std::move(lhs);
+}
+
 Tensor<float> div(const Tensor<float>& lhs, const Tensor<float>& rhs) {
 	Tensor<float> out = _priv::MathHelper::binary_arithmetic_operator(lhs, rhs);
-
-	for(size_t i=0; i<out.shape().product(); i++) {
-		out.at_index(i) = lhs.at_index(i)/rhs.at_index(i);
-	}
-
+	div(lhs, rhs, out);
 	return out;
 }
 
@@ -67,6 +110,11 @@ Tensor<float> operator/(const Tensor<float>& lhs, const Tensor<float>& rhs) {
 	return div(lhs, rhs);
 }
 
+Tensor<float> operator/(Tensor<float>&& lhs, const Tensor<float>& rhs) {
+	div(lhs, rhs, lhs);
+	return std::move(lhs);
+}
+
 Tensor<float> sqrt(const Tensor<float>& in) {
 	Tensor<float> out = _priv::MathHelper::unary_arithmetic_operator(in);
 
@@ -77,6 +125,13 @@ Tensor<float> sqrt(const Tensor<float>& in) {
 	return out;
 }
 
+Tensor<float> sqrt(Tensor<float>&& in) {
+	for(float& value : in) {
+		value = std::sqrt(value);
+	}
+	return std::move(in);
+}
+
 Tensor<float> diag(const Tensor<float>& in) {
 	if(in.shape().number() != 1) {
 		throw std::runtime_error("Expected 1D tensor");
@@ -136,6 +191,36 @@ Tensor<float> dot(const Tensor<float>& lhs, const Tensor<float>& rhs, size_t n)
 	return out;
 }
 
+Tensor<float> dot_transpose(const Tensor<float>& lhs, const Tensor<float>& rhs, float alpha) {
+	if(lhs.shape().number() != 2 || rhs.shape().number() != 2) {
+		throw std::runtime_error("Expected 2D tensors");
+	}
+	if(lhs.shape().dim(1) != rhs.shape().dim(1)) {
+		throw std::runtime_error("Incompatible shape "+lhs.shape().to_string()+" "+rhs.shape().to_string());
+	}
+
+	size_t l_size = lhs.shape().dim(0);
+	size_t r_size = rhs.shape().dim(0);
+	size_t in_size = lhs.shape().dim(1);
+
+	Tensor<float> out(Shape({l_size, r_size}));
+
+	if(&lhs == &rhs) {
+		// Symmetric result, only the upper triangle is computed then mirrored
+		cblas_ssyrk(CblasRowMajor, CblasUpper, CblasNoTrans, l_size, in_size, alpha, lhs.begin(), in_size, 0.0, out.begin(), l_size);
+		for(size_t i=0; i<l_size; i++) {
+			for(size_t j=0; j<i; j++) {
+				out.at(i, j) = out.at(j, i);
+			}
+		}
+	}
+	else {
+		cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, l_size, r_size, in_size, alpha, lhs.begin(), in_size, rhs.begin(), in_size, 0.0, out.begin(), r_size);
+	}
+
+	return out;
+}
+
 Tensor<float> sep_sign(const Tensor<float>& in) {
 
 	std::vector<size_t> dims;
@@ -175,6 +260,20 @@ Tensor<float> flatten(const Tensor<float>& in) {
 	return reshape(in, Shape({in.shape().product()}));
 }
 
+Tensor<float> reshape(Tensor<float>&& in, const Shape& new_shape) {
+	if(new_shape.product() != in.shape().product()) {
+		throw std::runtime_error("Incompatible shape");
+	}
+
+	in.reshape(new_shape);
+	return std::move(in);
+}
+
+Tensor<float> flatten(Tensor<float>&& in) {
+	Shape shape({in.shape().product()});
+	return reshape(std::move(in), shape);
+}
+
 Tensor<float> create(float value, const Shape& shape) {
 	Tensor<float> out(shape);
 	out.fill(value);
@@ -195,9 +294,10 @@ Tensor<float> mean1(const Tensor<float>& in) {
 	Tensor<float> out(Shape({size}));
 
 	for(size_t i=0; i<size; i++) {
+		const float* row = in.begin()+i*size1;
 		float v = 0;
 		for(size_t j=0; j<size1; j++) {
-			v += in.at_index(i*size1+j);
+			v += row[j];
 		}
 		out.at(i) = v/size1;
 	}
@@ -230,19 +330,69 @@ Tensor<float> expand_in(const Tensor<float>& in, const Shape& new_dims) {
 	return out;
 }
 
+void sub_expand_in(Tensor<float>& out, const Tensor<float>& in) {
+	size_t size1 = in.shape().product();
+	if(out.shape().number() < in.shape().number()) {
+		throw std::runtime_error("Incompatible shape ("+out.shape().to_string()+" "+in.shape().to_string()+")");
+	}
+	for(size_t i=0; i<in.shape().number(); i++) {
+		if(out.shape().dim(i) != in.shape().dim(i)) {
+			throw std::runtime_error("Incompatible shape ("+out.shape().to_string()+" "+in.shape().to_string()+")");
+		}
+	}
+
+	size_t size2 = size1 == 0 ? 0 : out.shape().product()/size1;
+	const float* v = in.begin();
+	float* o = out.begin();
+	parallel_range(size1, std::max<size_t>(1, MATH_PARALLEL_SIZE/size2), [v, o, size2](size_t, size_t start, size_t end) {
+		for(size_t i=start; i<end; i++) {
+			float* row = o+i*size2;
+			for(size_t j=0; j<size2; j++) {
+				row[j] -= v[i];
+			}
+		}
+	});
+}
+
 Tensor<float> transpose(const Tensor<float>& in) {
+	Tensor<float> out;
+	transpose(in, out);
+	return out;
+}
+
+void transpose(const Tensor<float>& in, Tensor<float>& out) {
 	if(in.shape().number() != 2) {
 		throw std::runtime_error("Unsupported shape");
 	}
+	if(&in == &out) {
+		throw std::runtime_error("transpose: out can't be in");
+	}
+
 	size_t n = in.shape().dim(0);
 	size_t m = in.shape().dim(1);
-	Tensor<float> out(Shape({m, n}));
-	for(size_t i=0; i<n; i++) {
-		for(size_t j=0; j<m; j++) {
-			out.at(j, i) = in.at(i, j);
-		}
+	Shape out_shape({m, n});
+	if(out.shape() != out_shape) {
+		out = Tensor<float>(out_shape);
 	}
-	return out;
+
+	// The blocks of rows are split in threads, each block is copied by square tiles that stay in cache
+	const float* src = in.begin();
+	float* dst = out.begin();
+	size_t block_number = (n+MATH_TRANSPOSE_BLOCK-1)/MATH_TRANSPOSE_BLOCK;
+	parallel_range(block_number, std::max<size_t>(1, MATH_PARALLEL_SIZE/(MATH_TRANSPOSE_BLOCK*m)), [src, dst, n, m](size_t, size_t start, size_t end) {
+		for(size_t b=start; b<end; b++) {
+			size_t i0 = b*MATH_TRANSPOSE_BLOCK;
+			size_t i1 = std::min(n, i0+MATH_TRANSPOSE_BLOCK);
+			for(size_t j0=0; j0<m; j0+=MATH_TRANSPOSE_BLOCK) {
+				size_t j1 = std::min(m, j0+MATH_TRANSPOSE_BLOCK);
+				for(size_t i=i0; i<i1; i++) {
+					for(size_t j=j0; j<j1; j++) {
+						dst[j*n+i] = src[i*m+j];
+					}
+				}
+			}
+		}
+	});
 }
 
 Tensor<float> scale(const Tensor<float>& in, float min, float max) {
@@ -1,53 +1,52 @@
 #include "NumpyInput.h"
 
-NumpyInput::NumpyInput(const std::string& filename) : _name(filename), _archive(), _data(nullptr), _label(nullptr), _current(0) {
-	NumpyReader::load(filename, _archive);
+NumpyInput::NumpyInput(const std::string& filename) : _name(filename), _archive(), _data(nullptr), _label(), _shape(), _current(0), _begin(0), _end(0) {
+	NumpyReader::open(filename, _archive);
 	_data = &_archive.at("arr_0.npy");
-	_label = &_archive.at("arr_1.npy");
+	_label = _archive.at("arr_1.npy").load();
 
 	if(_data->dimension_number() != 4) {
 		throw std::runtime_error("[NumpyInput] Unknown format (expected 4-dimension data tensor)");
 	}
 
-	if(_label->dimension_number() != 1) {
+	if(_label.dimension_number() != 1) {
 		throw std::runtime_error("[NumpyInput] Unknown format (expected 1-dimension label tensor)");
 	}
-	if(_data->dimension(0) != _label->dimension(0)) {
+	if(_data->dimension(0) != _label.dimension(0)) {
 		throw std::runtime_error("[NumpyInput] Incompatible data and label tensor");
 	}
+
+	_shape = Shape({_data->dimension(1), _data->dimension(2), _data->dimension(3)});
+	_end = _label.dimension(0);
 }
 
 bool NumpyInput::has_next() const {
-	return _current < _label->dimension(0);
+	return _data != nullptr && _current < _end;
 }
 
 std::pair<std::string, Tensor<InputType>> NumpyInput::next() {
-	size_t width = _data->dimension(1);
-	size_t height = _data->dimension(2);
-	size_t depth = _data->dimension(3);
-
-	std::pair<std::string, Tensor<InputType>> out(std::to_string(_label->at(_current)), Shape({width, height, depth}));
-
-	for(size_t x=0; x<width; x++) {
-		for(size_t y=0; y<height; y++) {
-			for(size_t z=0; z<depth; z++) {
-				out.second.at(x, y, z) = _data->at(_current, x, y, z);
-			}
-		}
-	}
+	// The sample is in row major order like the tensor, it is converted in place
+	std::pair<std::string, Tensor<InputType>> out(std::to_string(_label.at(_current)), _shape);
+	_data->slice(_current, out.second.begin());
 
 	_current++;
 	return out;
 }
 
 void NumpyInput::reset() {
-	_current = 0;
+	_current = _begin;
+}
+
+void NumpyInput::shard(size_t index, size_t number) {
+	std::pair<size_t, size_t> range = shard_range(_label.dimension(0), index, number);
+	_begin = range.first;
+	_end = range.second;
+	reset();
 }
 
 void NumpyInput::close() {
 	_archive.clear();
 	_data = nullptr;
-	_label = nullptr;
 }
 
 std::string NumpyInput::to_string() const {
@@ -55,5 +54,5 @@ std::string NumpyInput::to_string() const {
 }
 
 const Shape& NumpyInput::shape() const {
-	throw std::runtime_error("Unimplemented");
+	return _shape;
 }
@@ -1,4 +1,8 @@
 #include "NumpyReader.h"
+#include <atomic>
+#include <thread>
+#include <numeric>
+#include "Inflate.h"
 
 std::unique_ptr<NumpyHeaderObject> NumpyHeaderObject::read(const std::string& str, size_t& cursor) {
 	size_t current_cursor = cursor;
@@ -35,3 +39,424 @@ std::unique_ptr<NumpyHeaderObject> NumpyHeaderObject::read(const std::string& st
 		throw std::runtime_error("Unknown next token: "+NumpyHeaderObject::print_next_token(str, current_cursor));
 	}
 }
+
+namespace {
+
+	uint16_t read_uint16(const uint8_t* data) {
+		return data[0] | (data[1] << 8);
+	}
+
+	uint32_t read_uint32(const uint8_t* data) {
+		return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+
+	uint64_t read_uint64(const uint8_t* data) {
+		return static_cast<uint64_t>(read_uint32(data)) | (static_cast<uint64_t>(read_uint32(data+4)) << 32);
+	}
+
+	// Plain loops over contiguous values, vectorized by the compiler when no byte swap is needed.
+	template<typename S, typename T>
+	void convert_values(const uint8_t* src, size_t count, T* out, bool swap) {
+		if(!swap) {
+			for(size_t i=0; i<count; i++) {
+				S value;
+				std::memcpy(&value, src+i*sizeof(S), sizeof(S));
+				out[i] = static_cast<T>(value);
+			}
+		}
+		else {
+			for(size_t i=0; i<count; i++) {
+				uint8_t bytes[sizeof(S)];
+				std::reverse_copy(src+i*sizeof(S), src+(i+1)*sizeof(S), bytes);
+				S value;
+				std::memcpy(&value, bytes, sizeof(S));
+				out[i] = static_cast<T>(value);
+			}
+		}
+	}
+
+}
+
+NumpyLazyArray::NumpyLazyArray() : _descr(), _dimension(), _size(0), _item_size(0), _data(), _filename(), _offset(0), _file(), _buffer() {
+
+}
+
+size_t NumpyLazyArray::slice_size() const {
+	return _dimension.empty() ? 1 : _size/std::max<size_t>(1, _dimension.at(0));
+}
+
+void NumpyLazyArray::slice(size_t index, float* out) const {
+	size_t count = slice_size();
+	_read(index*count, count, out);
+}
+
+void NumpyLazyArray::slice(size_t index, double* out) const {
+	size_t count = slice_size();
+	_read(index*count, count, out);
+}
+
+void NumpyLazyArray::read(size_t start, size_t count, float* out) const {
+	_read(start, count, out);
+}
+
+void NumpyLazyArray::read(size_t start, size_t count, double* out) const {
+	_read(start, count, out);
+}
+
+NumpyArray NumpyLazyArray::load() const {
+	NumpyArray array(_dimension);
+	if(_size > 0) {
+		_read(0, _size, &array.at_index(0));
+	}
+	return array;
+}
+
+template<typename T>
+void NumpyLazyArray::_read(size_t start, size_t count, T* out) const {
+	if(start+count > _size) {
+		throw std::runtime_error("NumpyLazyArray: read out of bounds");
+	}
+
+	const uint8_t* src;
+	if(!_data.empty()) {
+		src = _data.data()+_offset+start*_item_size;
+	}
+	else {
+		_buffer.resize(count*_item_size);
+		_file.clear();
+		_file.seekg(_offset+start*_item_size);
+		_file.read(reinterpret_cast<char*>(_buffer.data()), count*_item_size);
+		if(!_file.good()) {
+			throw std::runtime_error("Unable to read "+_filename);
+		}
+		src = _buffer.data();
+	}
+
+	bool swap = _item_size > 1 && (ByteOrer::is_little_endian() ? _descr[0] == '>' : _descr[0] == '<');
+	char type = _descr[1];
+
+	if(type == 'f' && _item_size == 4) {
+		convert_values<float>(src, count, out, swap);
+	}
+	else if(type == 'f' && _item_size == 8) {
+		convert_values<double>(src, count, out, swap);
+	}
+	else if(type == 'i' && _item_size == 1) {
+		convert_values<int8_t>(src, count, out, swap);
+	}
+	else if(type == 'i' && _item_size == 2) {
+		convert_values<int16_t>(src, count, out, swap);
+	}
+	else if(type == 'i' && _item_size == 4) {
+		convert_values<int32_t>(src, count, out, swap);
+	}
+	else if(type == 'i' && _item_size == 8) {
+		convert_values<int64_t>(src, count, out, swap);
+	}
+	else if((type == 'u' || type == 'b') && _item_size == 1) {
+		convert_values<uint8_t>(src, count, out, swap);
+	}
+	else if(type == 'u' && _item_size == 2) {
+		convert_values<uint16_t>(src, count, out, swap);
+	}
+	else if(type == 'u' && _item_size == 4) {
+		convert_values<uint32_t>(src, count, out, swap);
+	}
+	else if(type == 'u' && _item_size == 8) {
+		convert_values<uint64_t>(src, count, out, swap);
+	}
+	else {
+		throw std::runtime_error("unsupported format: "+_descr);
+	}
+}
+
+void NumpyReader::open(const std::string& filename, NumpyLazyArchive& archive, size_t thread_number) {
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+
+	if(!file) {
+		throw std::runtime_error("Unable to open "+filename);
+	}
+
+	std::vector<ZipMember> members = _read_directory(file, filename);
+	std::vector<NumpyLazyArray> arrays(members.size());
+
+	std::vector<size_t> deflated;
+	for(size_t i=0; i<members.size(); i++) {
+		const ZipMember& member = members[i];
+
+		if(member.compression_method == ZIP_DEFLATED) {
+			deflated.push_back(i);
+		}
+		else if(member.compression_method == ZIP_STORED) {
+			// Only the header is read, the values stay in the file
+			uint64_t offset = _data_offset(file, member);
+			std::vector<uint8_t> header(std::min<uint64_t>(member.uncompressed_size, 12));
+			file.seekg(offset);
+			file.read(reinterpret_cast<char*>(header.data()), header.size());
+			if(header.size() == 12) {
+				size_t header_length = header[6] == 1 ? read_uint16(header.data()+8)+10 : read_uint32(header.data()+8)+12;
+				header.resize(std::min<uint64_t>(header_length, member.uncompressed_size));
+				file.seekg(offset);
+				file.read(reinterpret_cast<char*>(header.data()), header.size());
+			}
+			if(!file.good()) {
+				throw std::runtime_error("Bad file format : truncated member "+member.name);
+			}
+
+			NumpyLazyArray& array = arrays[i];
+			array._offset = offset+_parse_npy_header(header.data(), header.size(), array);
+			if(array._offset+array._size*array._item_size > offset+member.uncompressed_size) {
+				throw std::runtime_error("Bad file format : truncated member "+member.name);
+			}
+			array._filename = filename;
+			array._file.open(filename, std::ios::in | std::ios::binary);
+		}
+		else {
+			throw std::runtime_error("Unsupported compression method");
+		}
+	}
+
+	// The deflated members are decompressed in parallel, each thread reads its members with its own stream
+	if(thread_number == 0) {
+		thread_number = std::max<size_t>(1, std::thread::hardware_concurrency());
+	}
+	thread_number = std::min(thread_number, deflated.size());
+
+	std::atomic<size_t> next(0);
+	std::vector<std::exception_ptr> errors(members.size());
+	auto worker = [&]() {
+		std::ifstream member_file(filename, std::ios::in | std::ios::binary);
+		for(size_t k=next++; k<deflated.size(); k=next++) {
+			size_t i = deflated[k];
+			const ZipMember& member = members[i];
+			NumpyLazyArray& array = arrays[i];
+			try {
+				std::vector<uint8_t> compressed(member.compressed_size);
+				member_file.clear();
+				member_file.seekg(_data_offset(member_file, member));
+				member_file.read(reinterpret_cast<char*>(compressed.data()), compressed.size());
+				if(!member_file.good()) {
+					throw std::runtime_error("Bad file format : truncated member "+member.name);
+				}
+
+				array._data.resize(member.uncompressed_size);
+				inflate_raw(compressed.data(), compressed.size(), array._data.data(), array._data.size());
+
+				if(crc32(array._data.data(), array._data.size()) != member.crc) {
+					throw std::runtime_error("Bad file format : CRC mismatch in "+member.name);
+				}
+
+				array._offset = _parse_npy_header(array._data.data(), array._data.size(), array);
+				if(array._offset+array._size*array._item_size > array._data.size()) {
+					throw std::runtime_error("Bad file format : truncated member "+member.name);
+				}
+			}
+			catch(...) {
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(size_t i=1; i<thread_number; i++) {
+		threads.emplace_back(worker);
+	}
+	if(thread_number > 0) {
+		worker();
+	}
+	for(std::thread& thread : threads) {
+		thread.join();
+	}
+
+	for(size_t i=0; i<members.size(); i++) {
+		if(errors[i]) {
+			std::rethrow_exception(errors[i]);
+		}
+		archive.emplace(members[i].name, std::move(arrays[i]));
+	}
+}
+
+NumpyLazyArray NumpyReader::open(const std::string& filename) {
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+
+	if(!file) {
+		throw std::runtime_error("Unable to open "+filename);
+	}
+
+	file.seekg(0, std::ios::end);
+	uint64_t file_size = file.tellg();
+
+	std::vector<uint8_t> header(std::min<uint64_t>(file_size, 12));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(header.data()), header.size());
+	if(header.size() == 12) {
+		size_t header_length = header[6] == 1 ? read_uint16(header.data()+8)+10 : read_uint32(header.data()+8)+12;
+		header.resize(std::min<uint64_t>(header_length, file_size));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(header.data()), header.size());
+	}
+
+	NumpyLazyArray array;
+	array._offset = _parse_npy_header(header.data(), header.size(), array);
+	if(array._offset+array._size*array._item_size > file_size) {
+		throw std::runtime_error("Bad file format : truncated file "+filename);
+	}
+	array._filename = filename;
+	array._file.open(filename, std::ios::in | std::ios::binary);
+	return array;
+}
+
+std::vector<NumpyReader::ZipMember> NumpyReader::_read_directory(std::ifstream& file, const std::string& filename) {
+	file.seekg(0, std::ios::end);
+	uint64_t file_size = file.tellg();
+
+	// The end of central directory record is in the last 22 bytes, followed by a comment of at most 65535 bytes
+	std::vector<uint8_t> tail(std::min<uint64_t>(file_size, 22+65535));
+	file.seekg(file_size-tail.size());
+	file.read(reinterpret_cast<char*>(tail.data()), tail.size());
+
+	size_t end = tail.size();
+	for(size_t i=tail.size() >= 22 ? tail.size()-22+1 : 0; i-->0;) {
+		if(read_uint32(tail.data()+i) == ZIP_END_OF_DIRECTORY_MAGIC) {
+			end = i;
+			break;
+		}
+	}
+	if(end == tail.size()) {
+		throw std::runtime_error("Bad file format : no zip directory in "+filename);
+	}
+
+	uint64_t entry_number = read_uint16(tail.data()+end+10);
+	uint64_t directory_size = read_uint32(tail.data()+end+12);
+	uint64_t directory_offset = read_uint32(tail.data()+end+16);
+
+	if((entry_number == 0xFFFF || directory_size == 0xFFFFFFFF || directory_offset == 0xFFFFFFFF) &&
+			end >= 20 && read_uint32(tail.data()+end-20) == ZIP64_END_OF_DIRECTORY_LOCATOR_MAGIC) {
+		uint8_t record[56];
+		file.seekg(read_uint64(tail.data()+end-20+8));
+		file.read(reinterpret_cast<char*>(record), 56);
+		if(!file.good() || read_uint32(record) != ZIP64_END_OF_DIRECTORY_MAGIC) {
+			throw std::runtime_error("Bad file format : bad zip64 directory in "+filename);
+		}
+		entry_number = read_uint64(record+32);
+		directory_size = read_uint64(record+40);
+		directory_offset = read_uint64(record+48);
+	}
+
+	std::vector<uint8_t> directory(directory_size);
+	file.seekg(directory_offset);
+	file.read(reinterpret_cast<char*>(directory.data()), directory.size());
+	if(!file.good()) {
+		throw std::runtime_error("Bad file format : truncated zip directory in "+filename);
+	}
+
+	std::vector<ZipMember> members;
+	size_t cursor = 0;
+	for(uint64_t e=0; e<entry_number; e++) {
+		if(cursor+46 > directory.size() || read_uint32(directory.data()+cursor) != ZIP_DICTIONNARY_MAGIC) {
+			throw std::runtime_error("Bad file format : unknwon zip magic");
+		}
+
+		const uint8_t* entry = directory.data()+cursor;
+		ZipMember member;
+		member.compression_method = read_uint16(entry+10);
+		member.crc = read_uint32(entry+16);
+		member.compressed_size = read_uint32(entry+20);
+		member.uncompressed_size = read_uint32(entry+24);
+		uint16_t name_length = read_uint16(entry+28);
+		uint16_t extra_field_length = read_uint16(entry+30);
+		uint16_t comment_length = read_uint16(entry+32);
+		member.local_header_offset = read_uint32(entry+42);
+
+		if(cursor+46+name_length+extra_field_length+comment_length > directory.size()) {
+			throw std::runtime_error("Bad file format : truncated zip directory in "+filename);
+		}
+		member.name = std::string(reinterpret_cast<const char*>(entry+46), name_length);
+
+		// The zip64 extra field holds the 64 bits values of the fields set to 0xFFFFFFFF
+		const uint8_t* extra = entry+46+name_length;
+		size_t extra_cursor = 0;
+		while(extra_cursor+4 <= extra_field_length) {
+			uint16_t id = read_uint16(extra+extra_cursor);
+			uint16_t length = read_uint16(extra+extra_cursor+2);
+			const uint8_t* value = extra+extra_cursor+4;
+			const uint8_t* value_end = value+std::min<size_t>(length, extra_field_length-extra_cursor-4);
+			if(id == 0x0001) {
+				if(member.uncompressed_size == 0xFFFFFFFF && value+8 <= value_end) {
+					member.uncompressed_size = read_uint64(value);
+					value += 8;
+				}
+				if(member.compressed_size == 0xFFFFFFFF && value+8 <= value_end) {
+					member.compressed_size = read_uint64(value);
+					value += 8;
+				}
+				if(member.local_header_offset == 0xFFFFFFFF && value+8 <= value_end) {
+					member.local_header_offset = read_uint64(value);
+				}
+			}
+			extra_cursor += 4+length;
+		}
+
+		members.push_back(member);
+		cursor += 46+name_length+extra_field_length+comment_length;
+	}
+
+	return members;
+}
+
+uint64_t NumpyReader::_data_offset(std::ifstream& file, const ZipMember& member) {
+	uint8_t header[30];
+	file.clear();
+	file.seekg(member.local_header_offset);
+	file.read(reinterpret_cast<char*>(header), 30);
+
+	if(!file.good() || read_uint32(header) != ZIP_FILE_MAGIC) {
+		throw std::runtime_error("Bad file format : unknwon zip magic");
+	}
+
+	return member.local_header_offset+30+read_uint16(header+26)+read_uint16(header+28);
+}
+
+size_t NumpyReader::_parse_npy_header(const uint8_t* data, size_t size, NumpyLazyArray& array) {
+	if(size < 10 || data[0] != NPY_MAGIC_1 || std::string(reinterpret_cast<const char*>(data+1), 5) != NPY_MAGIC_2) {
+		throw std::runtime_error("Bad file format : not a numpy file");
+	}
+
+	// Version 1.0 has a 16 bits header length, the next versions a 32 bits one
+	uint8_t major_version = data[6];
+	size_t prefix_length = major_version == 1 ? 10 : 12;
+	if(size < prefix_length) {
+		throw std::runtime_error("Bad file format : not a numpy file");
+	}
+	size_t header_length = major_version == 1 ? read_uint16(data+8) : read_uint32(data+8);
+	if(size < prefix_length+header_length) {
+		throw std::runtime_error("Bad file format : truncated numpy header");
+	}
+
+	std::string header_str(reinterpret_cast<const char*>(data+prefix_length), header_length);
+
+	size_t cursor = 0;
+	std::unique_ptr<NumpyHeaderObject> header = NumpyHeaderObject::read(header_str, cursor);
+	NumpyHeaderMap& cast_header = dynamic_cast<NumpyHeaderMap&>(*header);
+
+	NumpyHeaderTuple& shape = dynamic_cast<NumpyHeaderTuple&>(*cast_header.value().at("shape"));
+
+	array._dimension.clear();
+	std::transform(std::begin(shape.value()), std::end(shape.value()), std::back_inserter(array._dimension), [](const std::unique_ptr<NumpyHeaderObject>& element) {
+		return dynamic_cast<NumpyHeaderInt&>(*element).value();
+	});
+	array._size = std::accumulate(std::begin(array._dimension), std::end(array._dimension), static_cast<size_t>(1), std::multiplies<size_t>());
+
+	auto fortran_order = cast_header.value().find("fortran_order");
+	if(fortran_order != cast_header.value().end() && dynamic_cast<NumpyHeaderBool&>(*fortran_order->second).value()) {
+		throw std::runtime_error("unsupported format: fortran order");
+	}
+
+	array._descr = dynamic_cast<NumpyHeaderString&>(*cast_header.value().at("descr")).value();
+	if(array._descr.size() < 3) {
+		throw std::runtime_error("unsupported format: "+array._descr);
+	}
+	array._item_size = std::stoul(array._descr.substr(2));
+
+	return prefix_length+header_length;
+}
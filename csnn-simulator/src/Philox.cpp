@@ -0,0 +1,69 @@
+#include "Philox.h"
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+Philox::Philox(uint64_t seed, size_t stream, size_t epoch, size_t sample) : _key(), _counter(), _output(), _cursor(4)
+{
+	_key[0] = static_cast<uint32_t>(seed);
+	_key[1] = static_cast<uint32_t>(seed >> 32);
+	// _counter[0] is the block index inside the stream, incremented every 4 numbers.
+	_counter[0] = 0;
+	_counter[1] = static_cast<uint32_t>(sample);
+	_counter[2] = static_cast<uint32_t>(epoch);
+	_counter[3] = static_cast<uint32_t>(stream);
+}
+
+Philox::result_type Philox::operator()()
+{
+	if (_cursor == 4)
+	{
+		_generate();
+		_counter[0]++;
+		_cursor = 0;
+	}
+	return _output[_cursor++];
+}
+
+uint64_t Philox::seed_from(const std::string &name)
+{
+	// FNV-1a
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (char c : name)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+void Philox::_generate()
+{
+	uint32_t c[4] = {_counter[0], _counter[1], _counter[2], _counter[3]};
+	uint32_t k[2] = {_key[0], _key[1]};
+
+	for (size_t r = 0; r < PHILOX_ROUNDS; r++)
+	{
+		uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c[0];
+		uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c[2];
+		uint32_t n[4] = {
+			static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+			static_cast<uint32_t>(p1),
+			static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+			static_cast<uint32_t>(p0)};
+		c[0] = n[0];
+		c[1] = n[1];
+		c[2] = n[2];
+		c[3] = n[3];
+		k[0] += PHILOX_W0;
+		k[1] += PHILOX_W1;
+	}
+
+	_output[0] = c[0];
+	_output[1] = c[1];
+	_output[2] = c[2];
+	_output[3] = c[3];
+}
@@ -1,4 +1,5 @@
 #include "SpikeConverter.h"
+#include <algorithm>
 
 void SpikeConverter::to_spike(const Tensor<Time> &in, std::vector<Spike> &out)
 {
@@ -7,6 +8,12 @@ void SpikeConverter::to_spike(const Tensor<Time> &in, std::vector<Spike> &out)
 	size_t depth = in.shape().dim(2);
 	size_t conv_depth = in.shape().number() > 3 ? in.shape().dim(3) : 1;
 
+	// The spikes are counted first so that the output is allocated once, then emitted in the order of the tensor, in a single pass.
+	const Time *data = in.begin();
+	size_t size = in.shape().product();
+	out.reserve(out.size() + std::count_if(data, data + size, [](Time t)
+										   { return t != INFINITE_TIME; }));
+
 	if (in.shape().number() == 3)
 		for (size_t x = 0; x < width; x++)
 		{
@@ -14,7 +21,7 @@ void SpikeConverter::to_spike(const Tensor<Time> &in, std::vector<Spike> &out)
 			{
 				for (size_t z = 0; z < depth; z++)
 				{
-					Time t = in.at(x, y, z);
+					Time t = *data++;
 					if (t != INFINITE_TIME)
 					{
 						out.emplace_back(t, x, y, z);
@@ -31,7 +38,7 @@ void SpikeConverter::to_spike(const Tensor<Time> &in, std::vector<Spike> &out)
 				{
 					for (size_t k = 0; k < conv_depth; k++)
 					{
-						Time t = in.at(x, y, z, k);
+						Time t = *data++;
 						if (t != INFINITE_TIME)
 						{
 							out.emplace_back(t, x, y, z, k);
@@ -50,29 +57,38 @@ void SpikeConverter::to_spike(const Tensor<Time> &in, std::vector<Spike> &out, s
 	size_t height = in.shape().dim(1);
 	size_t depth = in.shape().dim(2);
 	size_t conv_depth = in.shape().number() > 3 ? in.shape().dim(3) : 1;
+	// Values of one (x, y) position, contiguous in the tensor.
+	size_t pixel_size = depth * conv_depth;
+
 	if (in.shape().number() == 3)
 		for (size_t x = x_start; x < std::min(width, x_end); x++)
 			for (size_t y = y_start; y < std::min(height, y_end); y++)
+			{
+				const Time *pixel = in.begin() + (x * height + y) * pixel_size;
 				for (size_t z = 0; z < depth; z++)
 				{
-					Time t = in.at(x, y, z);
+					Time t = pixel[z];
 					if (t != INFINITE_TIME)
 					{
 						out.emplace_back(t, x - x_start, y - y_start, z);
 					}
 				}
+			}
 	else
 		for (size_t x = x_start; x < std::min(width, x_end); x++)
 			for (size_t y = y_start; y < std::min(height, y_end); y++)
+			{
+				const Time *pixel = in.begin() + (x * height + y) * pixel_size;
 				for (size_t z = 0; z < depth; z++)
 					for (size_t k = 0; k < conv_depth; k++)
 					{
-						Time t = in.at(x, y, z, k);
+						Time t = pixel[z * conv_depth + k];
 						if (t != INFINITE_TIME)
 						{
 							out.emplace_back(t, x - x_start, y - y_start, z, k);
 						}
 					}
+			}
 
 	std::sort(std::begin(out), std::end(out), TimeComparator());
 }
@@ -91,3 +107,69 @@ void SpikeConverter::from_spike(const std::vector<Spike> &in, Tensor<Time> &out)
 			out.at(spike.x, spike.y, spike.z, spike.k) = spike.time;
 		}
 }
+
+void SpikeConverter::to_spike(const SparseTensor<Time> &in, std::vector<Spike> &out)
+{
+	if (in.default_value() != INFINITE_TIME)
+	{
+		to_spike(from_sparse_tensor(in), out);
+		return;
+	}
+
+	size_t height = in.shape().dim(1);
+	size_t depth = in.shape().dim(2);
+	size_t conv_depth = in.shape().number() > 3 ? in.shape().dim(3) : 1;
+
+	out.reserve(out.size() + in.values().size());
+	for (const std::pair<uint32_t, Time> &value : in.values())
+	{
+		if (value.second == INFINITE_TIME)
+		{
+			continue;
+		}
+
+		size_t index = value.first;
+		size_t k = index % conv_depth;
+		index /= conv_depth;
+		size_t z = index % depth;
+		index /= depth;
+		size_t y = index % height;
+		size_t x = index / height;
+
+		if (in.shape().number() == 3)
+			out.emplace_back(value.second, x, y, z);
+		else
+			out.emplace_back(value.second, x, y, z, k);
+	}
+
+	std::sort(std::begin(out), std::end(out), TimeComparator());
+}
+
+void SpikeConverter::from_spike(const std::vector<Spike> &in, SparseTensor<Time> &out)
+{
+	size_t height = out.shape().dim(1);
+	size_t depth = out.shape().dim(2);
+	size_t conv_depth = out.shape().number() > 3 ? out.shape().dim(3) : 1;
+
+	std::vector<std::pair<uint32_t, Time>> values;
+	values.reserve(in.size());
+	for (const Spike &spike : in)
+	{
+		size_t k = out.shape().number() > 3 ? spike.k : 0;
+		values.emplace_back(((spike.x * height + spike.y) * depth + spike.z) * conv_depth + k, spike.time);
+	}
+
+	// As in the dense conversion, the last spike of a neuron overwrites the previous ones.
+	std::stable_sort(values.begin(), values.end(), [](const std::pair<uint32_t, Time> &a, const std::pair<uint32_t, Time> &b)
+					 { return a.first < b.first; });
+
+	out.reset(INFINITE_TIME);
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		if (i + 1 == values.size() || values[i + 1].first != values[i].first)
+		{
+			out.add_index(values[i].first, values[i].second);
+		}
+	}
+	out.optimize_space();
+}
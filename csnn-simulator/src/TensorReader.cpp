@@ -1,17 +1,17 @@
 #include "TensorReader.h"
 
 TensorReader::TensorReader() :
-	_name(), _file(), _tensor_counter(0), _cursor(0), _sparse(false) {
+	_name(), _file(), _tensor_counter(0), _cursor(0), _begin(0), _end(0), _sparse(false), _indexed(false), _data_position(), _shape(), _index() {
 
 }
 
-TensorReader::TensorReader(const std::string& filename) :
-	_name(filename), _file(), _tensor_counter(0), _cursor(0), _sparse(false) {
+TensorReader::TensorReader(const std::string& filename) : TensorReader() {
 	open(filename);
 }
 
 TensorReader::TensorReader(TensorReader&& that) noexcept :
-	_name(that._name), _file(std::move(that._file)), _tensor_counter(that._tensor_counter), _cursor(that._cursor), _sparse(that._sparse) {
+	_name(that._name), _file(std::move(that._file)), _tensor_counter(that._tensor_counter), _cursor(that._cursor), _begin(that._begin), _end(that._end), _sparse(that._sparse),
+	_indexed(that._indexed), _data_position(that._data_position), _shape(std::move(that._shape)), _index(std::move(that._index)) {
 
 }
 
@@ -28,8 +28,23 @@ void TensorReader::open(const std::string& filename) {
 		throw std::runtime_error("Unable to open "+filename);
 	}
 
+	_index.clear();
 	_read_header();
+	_data_position = _file.tellg();
+	_cursor = 0;
+	_begin = 0;
+	_end = _tensor_counter;
+
+	if(_indexed) {
+		_read_index();
+	}
 
+	// The shape is the one of the first record
+	_shape = Shape();
+	if(_tensor_counter > 0) {
+		_read_record_header(_shape);
+		_file.seekg(_data_position);
+	}
 }
 
 bool TensorReader::eof() const {
@@ -37,27 +52,12 @@ bool TensorReader::eof() const {
 }
 
 bool TensorReader::has_next() const {
-	return _cursor <_tensor_counter;
+	return _cursor < _end;
 }
 
 std::pair<std::string, Tensor<InputType>> TensorReader::next() {
-	uint8_t label_size = 0;
-	_file.read(reinterpret_cast<char*>(&label_size), sizeof(uint8_t));
-	char* label_buffer = new char[label_size];
-	_file.read(label_buffer, label_size);
-
-	std::string label(label_buffer, label_size);
-	delete[] label_buffer;
-
-	uint8_t dim_number = 0;
-	_file.read(reinterpret_cast<char*>(&dim_number), sizeof(uint8_t));
-	std::vector<size_t> dims;
-	for(size_t i = 0; i<dim_number; i++) {
-		uint16_t dim = 0;
-		_file.read(reinterpret_cast<char*>(&dim), sizeof(uint16_t));
-		dims.push_back(dim);
-	}
-	Shape shape(dims);
+	Shape shape;
+	std::string label = _read_record_header(shape);
 	std::pair<std::string, Tensor<InputType>> t(label, shape);
 
 	if(_sparse) {
@@ -80,10 +80,76 @@ std::pair<std::string, Tensor<InputType>> TensorReader::next() {
 	return t;
 }
 
+std::pair<std::string, SparseTensor<float>> TensorReader::next_sparse() {
+	if(!_sparse) {
+		std::pair<std::string, Tensor<InputType>> dense = next();
+		return std::make_pair(dense.first, to_sparse_tensor(dense.second));
+	}
+
+	Shape shape;
+	std::string label = _read_record_header(shape);
+	std::pair<std::string, SparseTensor<float>> t(label, SparseTensor<float>(shape));
+
+	uint32_t index;
+	_file.read(reinterpret_cast<char*>(&index), sizeof(uint32_t));
+	while(index != 0xFFFFFFFF) {
+		float f;
+		_file.read(reinterpret_cast<char*>(&f), sizeof(float));
+		t.second.add_index(index, f);
+		_file.read(reinterpret_cast<char*>(&index), sizeof(uint32_t));
+	}
+
+	_cursor++;
+
+	return t;
+}
+
+void TensorReader::seek(size_t index) {
+	if(index > _tensor_counter) {
+		throw std::runtime_error(_name+": seek out of range");
+	}
+
+	_build_index();
+
+	_file.clear();
+	_file.seekg(index < _tensor_counter ? static_cast<std::streamoff>(_index[index].offset) : static_cast<std::streamoff>(_data_position));
+	_cursor = index;
+}
+
+size_t TensorReader::size() const {
+	return _end - _begin;
+}
+
+bool TensorReader::sparse() const {
+	return _sparse;
+}
+
+const std::string& TensorReader::label(size_t index) {
+	_build_index();
+	return _index.at(index).label;
+}
+
+size_t TensorReader::nnz(size_t index) {
+	_build_index();
+	return _index.at(index).nnz;
+}
+
 void TensorReader::reset() {
-	_file.seekg(0, std::ios::beg);
+	if(_begin > 0) {
+		seek(_begin);
+		return;
+	}
+
+	_file.clear();
+	_file.seekg(_data_position);
 	_cursor = 0;
-	_read_header();
+}
+
+void TensorReader::shard(size_t index, size_t number) {
+	std::pair<size_t, size_t> range = shard_range(_tensor_counter, index, number);
+	_begin = range.first;
+	_end = range.second;
+	reset();
 }
 
 void TensorReader::close() {
@@ -96,23 +162,125 @@ void TensorReader::_read_header() {
 	uint32_t magic = 0;
 	_file.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
 
-	if(magic == 0x234264FF) { //v1
+	if(magic == TENSOR_FILE_MAGIC) { //v1
 		uint8_t flag = 0;
 		_file.read(reinterpret_cast<char*>(&flag), sizeof(uint8_t));
-		_sparse = (flag & 0x1) != 0;
+		_sparse = (flag & TENSOR_FILE_SPARSE) != 0;
+		_indexed = (flag & TENSOR_FILE_INDEXED) != 0;
 		uint32_t counter = 0;
 		_file.read(reinterpret_cast<char*>(&counter), sizeof(uint32_t));
 		_tensor_counter = counter;
 	}
 	else { //v0
+		_sparse = false;
+		_indexed = false;
 		_tensor_counter = magic;
 	}
 }
 
+void TensorReader::_read_index() {
+	uint64_t index_offset = 0;
+	uint32_t index_magic = 0;
+	_file.seekg(-static_cast<std::streamoff>(sizeof(uint64_t)+sizeof(uint32_t)), std::ios::end);
+	_file.read(reinterpret_cast<char*>(&index_offset), sizeof(uint64_t));
+	_file.read(reinterpret_cast<char*>(&index_magic), sizeof(uint32_t));
+
+	if(!_file.good() || index_magic != TENSOR_FILE_INDEX_MAGIC) {
+		// Not closed properly, the index will be built by a scan if needed
+		_file.clear();
+		_file.seekg(_data_position);
+		_indexed = false;
+		return;
+	}
+
+	_file.seekg(index_offset);
+	_index.resize(_tensor_counter);
+	for(TensorFileIndexEntry& entry : _index) {
+		uint8_t label_size = 0;
+		_file.read(reinterpret_cast<char*>(&entry.offset), sizeof(uint64_t));
+		_file.read(reinterpret_cast<char*>(&entry.nnz), sizeof(uint32_t));
+		_file.read(reinterpret_cast<char*>(&label_size), sizeof(uint8_t));
+		entry.label.resize(label_size);
+		_file.read(&entry.label[0], label_size);
+	}
+
+	if(!_file.good()) {
+		throw std::runtime_error(_name+": truncated index");
+	}
+
+	_file.seekg(_data_position);
+}
+
+void TensorReader::_build_index() {
+	if(_index.size() == _tensor_counter) {
+		return;
+	}
+
+	std::streampos position = _file.tellg();
+	size_t cursor = _cursor;
+
+	_file.clear();
+	_file.seekg(_data_position);
+	_index.clear();
+	for(size_t i=0; i<_tensor_counter; i++) {
+		TensorFileIndexEntry entry;
+		entry.offset = _file.tellg();
+
+		Shape shape;
+		entry.label = _read_record_header(shape);
+		entry.nnz = 0;
+
+		if(_sparse) {
+			uint32_t index;
+			_file.read(reinterpret_cast<char*>(&index), sizeof(uint32_t));
+			while(index != 0xFFFFFFFF && _file.good()) {
+				_file.seekg(sizeof(float), std::ios::cur);
+				entry.nnz++;
+				_file.read(reinterpret_cast<char*>(&index), sizeof(uint32_t));
+			}
+		}
+		else {
+			// The values have to be read to count the non zero ones
+			std::vector<float> values(shape.product());
+			_file.read(reinterpret_cast<char*>(values.data()), sizeof(float)*values.size());
+			for(float value : values) {
+				entry.nnz += value != 0.0 ? 1 : 0;
+			}
+		}
+
+		if(!_file.good()) {
+			throw std::runtime_error(_name+": truncated file");
+		}
+		_index.push_back(entry);
+	}
+
+	_file.clear();
+	_file.seekg(position);
+	_cursor = cursor;
+}
+
+std::string TensorReader::_read_record_header(Shape& shape) {
+	uint8_t label_size = 0;
+	_file.read(reinterpret_cast<char*>(&label_size), sizeof(uint8_t));
+	std::string label(label_size, '\0');
+	_file.read(&label[0], label_size);
+
+	uint8_t dim_number = 0;
+	_file.read(reinterpret_cast<char*>(&dim_number), sizeof(uint8_t));
+	std::vector<size_t> dims;
+	for(size_t i = 0; i<dim_number; i++) {
+		uint16_t dim = 0;
+		_file.read(reinterpret_cast<char*>(&dim), sizeof(uint16_t));
+		dims.push_back(dim);
+	}
+	shape = Shape(dims);
+	return label;
+}
+
 std::string TensorReader::to_string() const {
-	return "TensorReader("+_name+")";
+	return "TensorReader("+_name+")["+std::to_string(_tensor_counter)+"]";
 }
 
 const Shape& TensorReader::shape() const {
-	throw std::runtime_error("Unimplemented");
+	return _shape;
 }
@@ -1,6 +1,6 @@
 #include "TensorWriter.h"
 
-TensorWriter::TensorWriter() : _file(), _tensor_counter(0),_sparse(false) {
+TensorWriter::TensorWriter() : _file(), _tensor_counter(0),_sparse(false), _index() {
 
 }
 
@@ -19,15 +19,17 @@ void TensorWriter::open(const std::string& filename, bool sparse) {
 
 	_file.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
 	_sparse = sparse;
+	_tensor_counter = 0;
+	_index.clear();
 
 	if(!_file.is_open()) {
 		throw std::runtime_error("Unable to open "+filename);
 	}
 
-	uint32_t v1_magic = 0x234264FF;
+	uint32_t v1_magic = TENSOR_FILE_MAGIC;
 	_file.write(reinterpret_cast<const char*>(&v1_magic), sizeof(uint32_t));
 
-	uint8_t flag = (sparse ? 0x1 : 0x0);
+	uint8_t flag = (sparse ? TENSOR_FILE_SPARSE : 0x0) | TENSOR_FILE_INDEXED;
 	_file.write(reinterpret_cast<const char*>(&flag), sizeof(uint8_t));
 
 	uint32_t counter = 0;
@@ -39,24 +41,17 @@ void TensorWriter::write(const std::string& label, const Tensor<float>& t) {
 		throw std::runtime_error("No open file");
 	}
 
-	uint8_t label_size = label.size();
-	_file.write(reinterpret_cast<const char*>(&label_size), sizeof(uint8_t));
-	_file.write(label.c_str(), label_size);
-
-	uint8_t dim_number = t.shape().number();
-	_file.write(reinterpret_cast<const char*>(&dim_number), sizeof(uint8_t));
-	for(size_t i = 0; i<dim_number; i++) {
-		uint16_t dim = t.shape().dim(i);
-		_file.write(reinterpret_cast<const char*>(&dim), sizeof(uint16_t));
-	}
+	_write_header(label, t.shape());
 
+	size_t size = t.shape().product();
+	uint32_t nnz = 0;
 	if(_sparse) {
-		size_t size = t.shape().product();
 		for(uint32_t i=0; i<size; i++) {
 			if(t.at_index(i) != 0.0) {
 				 _file.write(reinterpret_cast<const char*>(&i), sizeof(uint32_t));
 				 float f = t.at_index(i);
 				 _file.write(reinterpret_cast<const char*>(&f), sizeof(float));
+				 nnz++;
 			}
 		}
 		uint32_t eol = 0xFFFFFFFF;
@@ -64,22 +59,83 @@ void TensorWriter::write(const std::string& label, const Tensor<float>& t) {
 
 	}
 	else {
-		_file.write(reinterpret_cast<const char*>(t.begin()), sizeof(float)*t.shape().product());
+		_file.write(reinterpret_cast<const char*>(t.begin()), sizeof(float)*size);
+		for(size_t i=0; i<size; i++) {
+			nnz += t.at_index(i) != 0.0 ? 1 : 0;
+		}
+	}
+
+	_index.back().nnz = nnz;
+	_tensor_counter++;
+}
+
+void TensorWriter::write(const std::string& label, const SparseTensor<float>& t) {
+	// Sparse records only hold non zero values over a zero background
+	if(!_sparse || t.default_value() != 0.0) {
+		Tensor<float> dense(t.shape());
+		from_sparse_tensor(t, dense);
+		write(label, dense);
+		return;
+	}
+
+	if(!_file.good()) {
+		throw std::runtime_error("No open file");
 	}
 
+	_write_header(label, t.shape());
 
-	_file.flush();
+	uint32_t nnz = 0;
+	for(const std::pair<uint32_t, float>& value : t.values()) {
+		if(value.second != 0.0) {
+			_file.write(reinterpret_cast<const char*>(&value.first), sizeof(uint32_t));
+			_file.write(reinterpret_cast<const char*>(&value.second), sizeof(float));
+			nnz++;
+		}
+	}
+	uint32_t eol = 0xFFFFFFFF;
+	_file.write(reinterpret_cast<const char*>(&eol), sizeof(uint32_t));
+
+	_index.back().nnz = nnz;
 	_tensor_counter++;
 }
 
 void TensorWriter::close() {
 	if(_file.is_open()) {
 		_file.clear();
+
+		uint64_t index_offset = _file.tellp();
+		for(const TensorFileIndexEntry& entry : _index) {
+			_file.write(reinterpret_cast<const char*>(&entry.offset), sizeof(uint64_t));
+			_file.write(reinterpret_cast<const char*>(&entry.nnz), sizeof(uint32_t));
+			uint8_t label_size = entry.label.size();
+			_file.write(reinterpret_cast<const char*>(&label_size), sizeof(uint8_t));
+			_file.write(entry.label.c_str(), label_size);
+		}
+		uint32_t index_magic = TENSOR_FILE_INDEX_MAGIC;
+		_file.write(reinterpret_cast<const char*>(&index_offset), sizeof(uint64_t));
+		_file.write(reinterpret_cast<const char*>(&index_magic), sizeof(uint32_t));
+
 		_file.seekp(sizeof(uint32_t)+sizeof(uint8_t), std::ios::beg);
 
 		uint32_t counter = _tensor_counter;
 		_file.write(reinterpret_cast<const char*>(&counter), sizeof(uint32_t));
 		_file.flush();
 		_file.close();
+		_index.clear();
+	}
+}
+
+void TensorWriter::_write_header(const std::string& label, const Shape& shape) {
+	_index.push_back(TensorFileIndexEntry{static_cast<uint64_t>(_file.tellp()), 0, label.substr(0, static_cast<uint8_t>(label.size()))});
+
+	uint8_t label_size = label.size();
+	_file.write(reinterpret_cast<const char*>(&label_size), sizeof(uint8_t));
+	_file.write(label.c_str(), label_size);
+
+	uint8_t dim_number = shape.number();
+	_file.write(reinterpret_cast<const char*>(&dim_number), sizeof(uint8_t));
+	for(size_t i = 0; i<dim_number; i++) {
+		uint16_t dim = shape.dim(i);
+		_file.write(reinterpret_cast<const char*>(&dim), sizeof(uint16_t));
 	}
 }
@@ -6,7 +6,7 @@ using namespace dataset;
 
 Cifar::Cifar(const std::vector<std::string>& files) :
 	_files(files), _reader(files.front(), std::ios::in | std::ios::binary),
-	_file_cursor(0), _shape({CIFAR_WIDTH, CIFAR_HEIGHT, CIFAR_DEPTH}), _next_label(0) {
+	_file_cursor(0), _shape({CIFAR_WIDTH, CIFAR_HEIGHT, CIFAR_DEPTH}), _next_label(0), _current(0), _begin(0), _end(std::numeric_limits<size_t>::max()) {
 
 	if(!_reader.is_open()) {
 		throw std::runtime_error("Unable to open "+files.front());
@@ -16,7 +16,7 @@ Cifar::Cifar(const std::vector<std::string>& files) :
 }
 
 bool Cifar::has_next() const {
-	return _file_cursor < _files.size();
+	return _file_cursor < _files.size() && _current < _end;
 }
 
 
@@ -38,16 +38,45 @@ std::pair<std::string, Tensor<InputType>> Cifar::next() {
 	//_reader.setstate(std::ios_base::eofbit);
 
 	check_next();
+	_current++;
 
 	return out;
 }
 
 void Cifar::reset() {
-	_file_cursor = 0;
 	if(_reader.is_open()) {
 		_reader.close();
 	}
-	_reader.open(_files.front(), std::ios::in | std::ios::binary);
+
+	// The records have a fixed size, find the file and the position of the first sample of the shard.
+	_file_cursor = 0;
+	_current = _begin;
+	size_t skip = _begin;
+	while(_file_cursor < _files.size()) {
+		size_t count = std::filesystem::file_size(_files[_file_cursor])/CIFAR_RECORD_SIZE;
+		if(skip < count) {
+			break;
+		}
+		skip -= count;
+		_file_cursor++;
+	}
+
+	if(_file_cursor < _files.size()) {
+		_reader.clear();
+		_reader.open(_files[_file_cursor], std::ios::in | std::ios::binary);
+		if(!_reader.is_open()) {
+			throw std::runtime_error("Unable to open "+_files[_file_cursor]);
+		}
+		_reader.seekg(skip*CIFAR_RECORD_SIZE);
+		check_next();
+	}
+}
+
+void Cifar::shard(size_t index, size_t number) {
+	std::pair<size_t, size_t> range = shard_range(record_count(), index, number);
+	_begin = range.first;
+	_end = range.second;
+	reset();
 }
 
 void Cifar::close() {
@@ -55,7 +84,16 @@ void Cifar::close() {
 }
 
 size_t Cifar::size() const {
-	return 0;
+	size_t end = std::min(_end, record_count());
+	return end > _begin ? end - _begin : 0;
+}
+
+size_t Cifar::record_count() const {
+	size_t size = 0;
+	for(const std::string& file : _files) {
+		size += std::filesystem::file_size(file)/CIFAR_RECORD_SIZE;
+	}
+	return size;
 }
 
 std::string Cifar::to_string() const {
@@ -73,6 +111,7 @@ void Cifar::check_next() {
 		_file_cursor++;
 		_reader.close();
 		if(_file_cursor < _files.size()) {
+			_reader.clear();
 			_reader.open(_files[_file_cursor], std::ios::in | std::ios::binary);
 
 			if(!_reader.is_open()) {
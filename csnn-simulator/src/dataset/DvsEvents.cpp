@@ -0,0 +1,368 @@
+#include "dataset/DvsEvents.h"
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#ifdef SMID_AVX256
+#include <immintrin.h>
+#endif
+
+using namespace dataset;
+
+size_t DvsEventBuffer::size() const
+{
+	return t.size();
+}
+
+void DvsEventBuffer::clear()
+{
+	t.clear();
+	x.clear();
+	y.clear();
+	p.clear();
+}
+
+void DvsEventBuffer::resize(size_t size)
+{
+	t.resize(size);
+	x.resize(size);
+	y.resize(size);
+	p.resize(size);
+}
+
+template <typename T>
+static T read_le(const char *data)
+{
+	T value;
+	std::memcpy(&value, data, sizeof(T));
+	return value;
+}
+
+// Decodes count polarity events of event_size bytes: a 32 bits address (x: bits 17-31, y: bits 2-16, polarity: bit 1)
+// followed by a 32 bits timestamp, extended by the overflow counter of the packet.
+static void decode_polarity(const char *data, size_t count, size_t event_size, uint64_t overflow, DvsEventBuffer &events)
+{
+	size_t offset = events.size();
+	events.resize(offset + count);
+
+	size_t i = 0;
+#ifdef SMID_AVX256
+	if (event_size == 8)
+	{
+		const __m256i __deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+		const __m256i __mask_xy = _mm256_set1_epi32(0x7FFF);
+		const __m256i __mask_p = _mm256_set1_epi32(1);
+		const __m256i __overflow = _mm256_set1_epi64x(static_cast<int64_t>(overflow << 31));
+		const __m256i __zero = _mm256_setzero_si256();
+
+		for (; i + 8 <= count; i += 8)
+		{
+			// 8 events = (address, timestamp) x 8, split in the 8 addresses and the 8 timestamps.
+			__m256i __lo = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i * 8)), __deinterleave);
+			__m256i __hi = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i * 8 + 32)), __deinterleave);
+			__m256i __address = _mm256_permute2x128_si256(__lo, __hi, 0x20);
+			__m256i __timestamp = _mm256_permute2x128_si256(__lo, __hi, 0x31);
+
+			__m256i __x = _mm256_and_si256(_mm256_srli_epi32(__address, 17), __mask_xy);
+			__m256i __y = _mm256_and_si256(_mm256_srli_epi32(__address, 2), __mask_xy);
+			__m256i __p = _mm256_and_si256(_mm256_srli_epi32(__address, 1), __mask_p);
+
+			// [x0-3 y0-3 | x4-7 y4-7] -> [x0-7 | y0-7]
+			__m256i __xy = _mm256_permute4x64_epi64(_mm256_packus_epi32(__x, __y), 0xD8);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(events.x.data() + offset + i), _mm256_castsi256_si128(__xy));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(events.y.data() + offset + i), _mm256_extracti128_si256(__xy, 1));
+
+			__m256i __p8 = _mm256_packus_epi16(_mm256_packus_epi32(__p, __zero), __zero);
+			int32_t p_lo = _mm256_extract_epi32(__p8, 0);
+			int32_t p_hi = _mm256_extract_epi32(__p8, 4);
+			std::memcpy(events.p.data() + offset + i, &p_lo, 4);
+			std::memcpy(events.p.data() + offset + i + 4, &p_hi, 4);
+
+			__m256i __t_lo = _mm256_or_si256(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(__timestamp)), __overflow);
+			__m256i __t_hi = _mm256_or_si256(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(__timestamp, 1)), __overflow);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(events.t.data() + offset + i), __t_lo);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(events.t.data() + offset + i + 4), __t_hi);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		uint32_t address = read_le<uint32_t>(data + i * event_size);
+		uint32_t timestamp = read_le<uint32_t>(data + i * event_size + 4);
+		events.x[offset + i] = (address >> 17) & 0x7FFF;
+		events.y[offset + i] = (address >> 2) & 0x7FFF;
+		events.p[offset + i] = (address >> 1) & 0x1;
+		events.t[offset + i] = static_cast<uint64_t>(timestamp) | (overflow << 31);
+	}
+}
+
+DvsEvents::DvsEvents(const std::string &dataset_path, const std::string &trial_filename, DvsBinning binning, size_t frame_number, uint64_t duration)
+	: _binning(binning), _frame_number(frame_number), _duration(duration),
+	  _dataset_path(dataset_path), _trial_filename(trial_filename), _samples(), _cursor(0), _trial(), _events(),
+	  _shape({FRAME_HEIGHT, FRAME_WIDTH, VIDEO_DEPTH, frame_number})
+{
+	if (_frame_number == 0)
+	{
+		throw std::runtime_error("DvsEvents: frame_number must be greater than 0");
+	}
+
+	std::ifstream trial_file(_dataset_path + "/" + _trial_filename);
+	if (!trial_file.is_open())
+	{
+		throw std::runtime_error("Can't open " + _dataset_path + "/" + _trial_filename);
+	}
+
+	// Only the label files are read here, the recordings are decoded when their first sample is reached.
+	std::string line;
+	while (std::getline(trial_file, line))
+	{
+		line.erase(std::remove_if(line.begin(), line.end(), [](char c)
+								  { return std::isspace(static_cast<unsigned char>(c)); }),
+				   line.end());
+		if (line.empty())
+		{
+			continue;
+		}
+
+		std::string trial = line.substr(0, line.rfind('.'));
+		std::ifstream label_file(_dataset_path + "/" + trial + "_labels.csv");
+		if (!label_file.is_open())
+		{
+			throw std::runtime_error("Can't open " + _dataset_path + "/" + trial + "_labels.csv");
+		}
+
+		std::string row;
+		std::getline(label_file, row); // class,startTime_usec,endTime_usec
+		while (std::getline(label_file, row))
+		{
+			std::replace(row.begin(), row.end(), ',', ' ');
+			std::istringstream stream(row);
+			size_t label;
+			uint64_t start, end;
+			if (stream >> label >> start >> end)
+			{
+				// The labels of DVS128 Gesture start at 1
+				_samples.emplace_back(trial, label - 1, start, end);
+			}
+		}
+	}
+}
+
+bool DvsEvents::has_next() const
+{
+	return _cursor < size();
+}
+
+std::pair<std::string, Tensor<InputType>> DvsEvents::next()
+{
+	DvsEventBuffer events;
+	std::pair<std::string, Tensor<InputType>> out(_next_events(events), _shape);
+	out.second.fill(0);
+
+	std::vector<DvsFrame> frames = _split(events);
+	for (size_t k = 0; k < frames.size(); k++)
+	{
+		for (size_t i = frames[k].begin; i < frames[k].end; i++)
+		{
+			if (events.x[i] < FRAME_WIDTH && events.y[i] < FRAME_HEIGHT)
+			{
+				out.second.at(events.y[i], events.x[i], events.p[i], k) += 1;
+			}
+		}
+	}
+
+	return out;
+}
+
+std::vector<DvsFrame> DvsEvents::_split(const DvsEventBuffer &events) const
+{
+	size_t n = events.size();
+	std::vector<DvsFrame> frames(_frame_number, DvsFrame{n, n, 0, 0});
+
+	if (n == 0)
+	{
+		return frames;
+	}
+
+	if (_binning == DVS_BINNING_FRAME_COUNT)
+	{
+		size_t di = n / _frame_number;
+		for (size_t i = 0; i < _frame_number; i++)
+		{
+			frames[i].begin = i * di;
+			frames[i].end = i == _frame_number - 1 ? n : (i + 1) * di;
+			if (frames[i].end > frames[i].begin)
+			{
+				frames[i].t_begin = events.t[frames[i].begin];
+				frames[i].t_end = events.t[frames[i].end - 1];
+			}
+		}
+	}
+	else if (_binning == DVS_BINNING_TIME_WINDOW)
+	{
+		uint64_t t0 = events.t.front();
+		uint64_t dt = (events.t.back() - t0) / _frame_number;
+		size_t begin = 0;
+		for (size_t i = 0; i < _frame_number; i++)
+		{
+			frames[i].t_begin = t0 + dt * i;
+			frames[i].t_end = i == _frame_number - 1 ? events.t.back() : frames[i].t_begin + dt;
+			while (begin < n && events.t[begin] < frames[i].t_begin)
+			{
+				begin++;
+			}
+			size_t end = begin;
+			while (end < n && (i == _frame_number - 1 || events.t[end] < frames[i].t_end))
+			{
+				end++;
+			}
+			frames[i].begin = begin;
+			frames[i].end = end;
+			begin = end;
+		}
+	}
+	else
+	{
+		size_t begin = 0;
+		for (size_t i = 0; i < _frame_number && begin < n; i++)
+		{
+			uint64_t t_begin = events.t[begin];
+			size_t end = begin;
+			while (end < n && events.t[end] - t_begin <= _duration)
+			{
+				end++;
+			}
+			frames[i] = DvsFrame{begin, end, t_begin, t_begin + _duration};
+			begin = end;
+		}
+	}
+
+	return frames;
+}
+
+std::string DvsEvents::_next_events(DvsEventBuffer &events)
+{
+	const std::tuple<std::string, size_t, uint64_t, uint64_t> &sample = _samples[_cursor];
+	const std::string &trial = std::get<0>(sample);
+	uint64_t start = std::get<2>(sample);
+	uint64_t end = std::get<3>(sample);
+
+	if (trial != _trial)
+	{
+		_events.clear();
+		load_aedat(_dataset_path + "/" + trial + ".aedat", _events);
+		_sort(_events);
+		_trial = trial;
+	}
+
+	// The events of the trial are sorted by timestamp, the sample is the contiguous range [start, end).
+	size_t first = std::lower_bound(_events.t.begin(), _events.t.end(), start) - _events.t.begin();
+	size_t last = std::lower_bound(_events.t.begin() + first, _events.t.end(), end) - _events.t.begin();
+
+	events.t.assign(_events.t.begin() + first, _events.t.begin() + last);
+	events.x.assign(_events.x.begin() + first, _events.x.begin() + last);
+	events.y.assign(_events.y.begin() + first, _events.y.begin() + last);
+	events.p.assign(_events.p.begin() + first, _events.p.begin() + last);
+
+	_cursor++;
+	return std::to_string(std::get<1>(sample));
+}
+
+void DvsEvents::_sort(DvsEventBuffer &events)
+{
+	if (std::is_sorted(events.t.begin(), events.t.end()))
+	{
+		return;
+	}
+
+	// The packets of a recording can overlap in time, the events are reordered with a stable sort to keep the order of equal timestamps.
+	std::vector<size_t> order(events.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&events](size_t a, size_t b) { return events.t[a] < events.t[b]; });
+
+	DvsEventBuffer sorted;
+	sorted.resize(events.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		sorted.t[i] = events.t[order[i]];
+		sorted.x[i] = events.x[order[i]];
+		sorted.y[i] = events.y[order[i]];
+		sorted.p[i] = events.p[order[i]];
+	}
+	events = std::move(sorted);
+}
+
+void DvsEvents::load_aedat(const std::string &filename, DvsEventBuffer &events)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Can't open " + filename);
+	}
+
+	// ASCII header
+	std::string line;
+	while (file.peek() == '#' && std::getline(file, line))
+	{
+		if (line.compare(0, 12, "#!END-HEADER") == 0)
+		{
+			break;
+		}
+	}
+
+	char header[DVS_PACKET_HEADER_SIZE];
+	std::vector<char> data;
+	while (file.read(header, DVS_PACKET_HEADER_SIZE))
+	{
+		uint16_t type = read_le<uint16_t>(header);
+		uint32_t event_size = read_le<uint32_t>(header + 4);
+		uint32_t overflow = read_le<uint32_t>(header + 12);
+		uint32_t capacity = read_le<uint32_t>(header + 16);
+
+		size_t length = static_cast<size_t>(capacity) * event_size;
+		if (type != DVS_POLARITY_EVENT)
+		{
+			file.seekg(length, std::ios::cur);
+			continue;
+		}
+
+		if (event_size < 8)
+		{
+			throw std::runtime_error(filename + ": invalid polarity event size");
+		}
+
+		data.resize(length);
+		file.read(data.data(), length);
+		decode_polarity(data.data(), file.gcount() / event_size, event_size, overflow, events);
+	}
+}
+
+void DvsEvents::reset()
+{
+	_cursor = 0;
+}
+
+void DvsEvents::close()
+{
+	_trial.clear();
+	_events = DvsEventBuffer();
+}
+
+size_t DvsEvents::size() const
+{
+	return _samples.size();
+}
+
+std::string DvsEvents::to_string() const
+{
+	return "DvsEvents(" + _dataset_path + "/" + _trial_filename + ", " + std::to_string(_samples.size()) + " samples)";
+}
+
+const Shape &DvsEvents::shape() const
+{
+	return _shape;
+}
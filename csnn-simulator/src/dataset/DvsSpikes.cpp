@@ -0,0 +1,83 @@
+#include "dataset/DvsSpikes.h"
+#include <algorithm>
+
+using namespace dataset;
+
+DvsSpikes::DvsSpikes(const std::string &dataset_path, const std::string &trial_filename, DvsBinning binning, size_t frame_number, uint64_t duration)
+	: DvsEvents(dataset_path, trial_filename, binning, frame_number, duration), _spiked(Shape({FRAME_HEIGHT, FRAME_WIDTH, VIDEO_DEPTH}))
+{
+}
+
+std::string DvsSpikes::next_spikes(std::vector<Spike> &spikes)
+{
+	DvsEventBuffer events;
+	std::string label = _next_events(events);
+	std::vector<DvsFrame> frames = _split(events);
+
+	spikes.clear();
+	for (size_t k = 0; k < frames.size(); k++)
+	{
+		const DvsFrame &frame = frames[k];
+		float scale = frame.t_end > frame.t_begin ? 1.0f / static_cast<float>(frame.t_end - frame.t_begin) : 0.0f;
+
+		// Each slice is an independent presentation in [0, 1], where a pixel spikes at most once.
+		_spiked.fill(false);
+
+		for (size_t i = frame.begin; i < frame.end; i++)
+		{
+			if (events.x[i] >= FRAME_WIDTH || events.y[i] >= FRAME_HEIGHT)
+			{
+				continue;
+			}
+
+			bool &spiked = _spiked.at(events.y[i], events.x[i], events.p[i]);
+			if (spiked)
+			{
+				continue;
+			}
+			spiked = true;
+
+			Time time = std::min<Time>(1.0f, static_cast<Time>(events.t[i] - frame.t_begin) * scale);
+			spikes.emplace_back(time, events.y[i], events.x[i], events.p[i], k);
+		}
+	}
+
+	return label;
+}
+
+std::pair<std::string, SparseTensor<InputType>> DvsSpikes::next_sparse()
+{
+	std::vector<Spike> spikes;
+	std::pair<std::string, SparseTensor<InputType>> out(next_spikes(spikes), SparseTensor<InputType>(_shape, INFINITE_TIME));
+
+	size_t width = _shape.dim(1);
+	size_t depth = _shape.dim(2);
+	size_t conv_depth = _shape.dim(3);
+
+	std::vector<std::pair<uint32_t, Time>> values;
+	values.reserve(spikes.size());
+	for (const Spike &spike : spikes)
+	{
+		values.emplace_back(((spike.x * width + spike.y) * depth + spike.z) * conv_depth + spike.k, spike.time);
+	}
+	std::sort(values.begin(), values.end());
+
+	for (const std::pair<uint32_t, Time> &value : values)
+	{
+		out.second.add_index(value.first, value.second);
+	}
+	out.second.optimize_space();
+
+	return out;
+}
+
+std::pair<std::string, Tensor<InputType>> DvsSpikes::next()
+{
+	std::pair<std::string, SparseTensor<InputType>> entry = next_sparse();
+	return std::make_pair(entry.first, from_sparse_tensor(entry.second));
+}
+
+std::string DvsSpikes::to_string() const
+{
+	return "DvsSpikes(" + DvsEvents::to_string() + ")";
+}
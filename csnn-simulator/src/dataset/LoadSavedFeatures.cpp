@@ -2,7 +2,7 @@
 using namespace dataset;
 
 LoadSavedFeatures::LoadSavedFeatures(const std::string &folder_path, size_t max_read) : _folder_path(folder_path),
-                                                                                        _size(0), _cursor(0), _shape({1, 1, 1, 1}), _max_read(max_read)
+                                                                                        _reader(), _size(0), _cursor(0), _shape({1, 1, 1, 1}), _max_read(max_read)
 {
     // Get the saved locations of the featues
     for (const auto &file : std::filesystem::directory_iterator(_folder_path))
@@ -11,43 +11,57 @@ LoadSavedFeatures::LoadSavedFeatures(const std::string &folder_path, size_t max_
         _data_list.push_back(_file_path);
     }
 
-    // load the saved spatial features.
-    LoadPairVector(_data_list[0], _features);
+    if (_data_list.empty())
+    {
+        throw std::runtime_error("LoadSavedFeatures: no feature file in " + _folder_path);
+    }
+
+    // the saved spatial features are streamed, only the current sample is in memory.
+    _reader = OpenFeatureReader(_data_list[0]);
+    _shape = _reader->shape();
 
-    _shape = _features[0].second.shape();
-    _size = _features.size();
+    FeatureStoreReader *store = dynamic_cast<FeatureStoreReader *>(_reader.get());
+    if (store != nullptr)
+    {
+        _size = store->size();
+    }
+    else
+    {
+        // the JSON files have no sample count, count them with a second reader.
+        JsonFeatureReader counter(_data_list[0]);
+        while (counter.has_next())
+        {
+            counter.next_sparse();
+            _size++;
+        }
+    }
 }
 
 bool LoadSavedFeatures::has_next() const
 {
-    return _cursor < size();
+    return _cursor < size() && _reader->has_next();
 }
 
 std::pair<std::string, Tensor<InputType>> LoadSavedFeatures::next()
 {
-    std::string _label = _features[_cursor].first;
-
-    std::pair<std::string, Tensor<InputType>> out(_label, _shape);
-
-    out.second = _features[_cursor].second;
-
     _cursor++;
-
-    return out;
+    return _reader->next();
 }
 
 void LoadSavedFeatures::reset()
 {
+    _reader->reset();
     _cursor = 0;
 }
 
 void LoadSavedFeatures::close()
 {
+    _reader->close();
 }
 
 size_t LoadSavedFeatures::size() const
 {
-    return std::min(_size, _max_read);
+    return std::min<size_t>(_size, _max_read);
 }
 
 std::string LoadSavedFeatures::to_string() const
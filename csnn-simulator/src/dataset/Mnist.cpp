@@ -4,7 +4,7 @@ using namespace dataset;
 
 Mnist::Mnist(const std::string &image_filename, const std::string &label_filename, size_t max_read) : _image_filename(image_filename), _label_filename(label_filename),
 																									  _image_file(image_filename, std::ios::binary), _label_file(label_filename, std::ios::binary),
-																									  _size(0), _cursor(0), _shape({MNIST_HEIGHT, MNIST_WIDTH, MNIST_DEPTH}), _max_read(max_read)
+																									  _size(0), _cursor(0), _begin(0), _end(std::numeric_limits<uint32_t>::max()), _shape({MNIST_HEIGHT, MNIST_WIDTH, MNIST_DEPTH}), _max_read(max_read)
 {
 
 	if (!_image_file.is_open())
@@ -21,7 +21,7 @@ Mnist::Mnist(const std::string &image_filename, const std::string &label_filenam
 
 bool Mnist::has_next() const
 {
-	return _cursor < size();
+	return _cursor < std::min<size_t>({_size, _max_read, _end});
 }
 
 std::pair<std::string, Tensor<InputType>> Mnist::next()
@@ -55,9 +55,27 @@ std::pair<std::string, Tensor<InputType>> Mnist::next()
 void Mnist::reset()
 {
 	_cursor = 0;
+	_label_file.clear();
+	_image_file.clear();
 	_label_file.seekg(0, std::ios::beg);
 	_image_file.seekg(0, std::ios::beg);
 	read_header();
+
+	// The records have a fixed size, skip the samples before the shard.
+	if (_begin > 0)
+	{
+		_cursor = _begin;
+		_label_file.seekg(_begin * sizeof(uint8_t), std::ios::cur);
+		_image_file.seekg(_begin * MNIST_WIDTH * MNIST_HEIGHT * sizeof(uint8_t), std::ios::cur);
+	}
+}
+
+void Mnist::shard(size_t index, size_t number)
+{
+	std::pair<size_t, size_t> range = shard_range(std::min<size_t>(_size, _max_read), index, number);
+	_begin = range.first;
+	_end = range.second;
+	reset();
 }
 
 void Mnist::close()
@@ -68,7 +86,8 @@ void Mnist::close()
 
 size_t Mnist::size() const
 {
-	return std::min(_size, _max_read);
+	size_t end = std::min<size_t>({_size, _max_read, _end});
+	return end > _begin ? end - _begin : 0;
 }
 
 std::string Mnist::to_string() const
@@ -1,66 +1,226 @@
 #include "dataset/SpikingVideo.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "tool/npy.hpp"
 
 using namespace dataset;
 
-SpikingVideo::SpikingVideo(const std::string& videos_npy_filename, const std::string& label_npy_filename)
-        :_videos_npy_filename(videos_npy_filename),
-         _label_npy_filename(label_npy_filename),
-         _size(0), 
-         _cursor(0),
-         _label_cursor(0),
-         _shape({FRAME_HEIGHT,FRAME_WIDTH,VIDEO_DEPTH,FRAME_NUMBER})
+SpikingVideo::SpikingVideo(const std::string& videos_npy_filename, const std::string& label_npy_filename, size_t spatial_factor, size_t temporal_factor)
+	: _videos_npy_filename(videos_npy_filename),
+	  _label_npy_filename(label_npy_filename),
+	  _size(0),
+	  _cursor(0), _begin(0), _end(0),
+	  _frame_number(0), _depth(0), _height(0), _width(0),
+	  _spatial_factor(spatial_factor), _temporal_factor(temporal_factor),
+	  _shape(),
+	  _label(), _label_shape(),
+	  _fd(-1), _map(nullptr), _map_size(0), _data(nullptr),
+	  _sample_size(0)
 {
-    npy::LoadArrayFromNumpy(_videos_npy_filename, _data_shape, _is_fortran, _data);
-    npy::LoadArrayFromNumpy(_label_npy_filename,_label_shape,_is_fortran,_label);
+	if (_spatial_factor == 0 || _temporal_factor == 0) {
+		throw std::runtime_error("SpikingVideo: the spatial and temporal factors must be at least 1");
+	}
+
+	std::ifstream stream(_videos_npy_filename, std::ifstream::binary);
+	if (!stream) {
+		throw std::runtime_error("Unable to open " + _videos_npy_filename);
+	}
+
+	npy::header_t header = npy::parse_header(npy::read_header(stream));
+	size_t offset = stream.tellg();
+	stream.close();
+
+	if (header.dtype.tie() != npy::dtype_map.at(std::type_index(typeid(float))).tie()) {
+		throw std::runtime_error(_videos_npy_filename + ": expected float32 frames");
+	}
+
+	if (header.fortran_order) {
+		throw std::runtime_error(_videos_npy_filename + ": fortran order is not supported");
+	}
+
+	if (header.shape.size() != 5) {
+		throw std::runtime_error(_videos_npy_filename + ": expected shape (samples, frames, depth, height, width)");
+	}
+
+	_size = header.shape[0];
+	_frame_number = header.shape[1];
+	_depth = header.shape[2];
+	_height = header.shape[3];
+	_width = header.shape[4];
+	_sample_size = _frame_number * _depth * _height * _width;
+
+	if (_height < _spatial_factor || _width < _spatial_factor || _frame_number < _temporal_factor) {
+		throw std::runtime_error(_videos_npy_filename + ": the reduction factors are larger than the frames (" + std::to_string(_frame_number) + ", " +
+								 std::to_string(_depth) + ", " + std::to_string(_height) + ", " + std::to_string(_width) + ")");
+	}
+
+	_shape = Shape({_height / _spatial_factor, _width / _spatial_factor, _depth, _frame_number / _temporal_factor});
+	_end = _size;
+
+	// The labels are read before the frames are mapped, a missing or short label file does not leave a mapping behind.
+	npy::LoadArrayFromNumpy(_label_npy_filename, _label_shape, _is_fortran, _label);
+	if (_label.size() < _size) {
+		throw std::runtime_error(_label_npy_filename + ": less labels than samples");
+	}
+
+	_fd = open(_videos_npy_filename.c_str(), O_RDONLY);
+	if (_fd == -1) {
+		throw std::runtime_error("Unable to open " + _videos_npy_filename);
+	}
+
+	// The destructor is not called when the constructor throws, close() releases the descriptor and the mapping before rethrowing.
+	try {
+		_map_size = lseek(_fd, 0, SEEK_END);
+		if (_map_size < offset + _size * _sample_size * sizeof(float)) {
+			throw std::runtime_error(_videos_npy_filename + ": truncated file");
+		}
+
+		void* map = mmap(nullptr, _map_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+		if (map == MAP_FAILED) {
+			throw std::runtime_error("Unable to map " + _videos_npy_filename);
+		}
+		_map = static_cast<char*>(map);
+		_data = reinterpret_cast<const float*>(_map + offset);
+
+		madvise(_map, _map_size, MADV_SEQUENTIAL);
+		if (_size > 0) {
+			_advise(0, MADV_WILLNEED);
+		}
+	}
+	catch (...) {
+		close();
+		throw;
+	}
 }
 
+SpikingVideo::~SpikingVideo()
+{
+	close();
+}
 
 bool SpikingVideo::has_next() const
 {
-	return _cursor < size();
+	return _map != nullptr && _cursor < _end;
 }
 
 std::pair<std::string, Tensor<InputType>> SpikingVideo::next()
 {
-    size_t _current_label = _label[_label_cursor];
-    std::pair<std::string, Tensor<InputType>> out(std::to_string(static_cast<size_t>(_current_label)), _shape);
-    for (size_t i = 0; i < FRAME_NUMBER; i++)
-    {
-        for (size_t j = 0; j < VIDEO_DEPTH; j++)
-        { 
-            for (size_t y = 0; y < FRAME_HEIGHT; y++)
-	        {
-		        for (size_t x = 0; x < FRAME_WIDTH; x++)
-		        {
-			        float pixel;
-                    pixel = _data[i*FRAME_WIDTH*VIDEO_DEPTH*FRAME_NUMBER*+j*FRAME_WIDTH*VIDEO_DEPTH+y*FRAME_WIDTH+x];
-			        out.second.at(y,x,j,i) = static_cast<InputType>(pixel);
-		        }
-	        }
-        }
-    }
-
-	//Tensor<float>::draw_nonscaled_tensor("/home/zhang/S2/RP/csnn-simulator-build/test/Raw_" + std::to_string(_current_label) + "_" + std::to_string(_cursor/(FRAME_HEIGHT*FRAME_WIDTH*VIDEO_DEPTH*FRAME_NUMBER)) + "_", out.second);
-
-	_cursor+=FRAME_HEIGHT*FRAME_WIDTH*VIDEO_DEPTH*FRAME_NUMBER;
-    _label_cursor++;
+	size_t _current_label = _label[_cursor];
+	std::pair<std::string, Tensor<InputType>> out(std::to_string(_current_label), _shape);
+
+	if (_cursor + 1 < _end) {
+		_advise(_cursor + 1, MADV_WILLNEED);
+	}
+
+	if (_spatial_factor == 1 && _temporal_factor == 1) {
+		_copy(sample_data(_cursor), out.second.begin());
+	}
+	else {
+		_reduce(sample_data(_cursor), out.second.begin());
+	}
+
+	// The sample is copied, its pages can be released.
+	_advise(_cursor, MADV_DONTNEED);
+
+	_cursor++;
 	return out;
 }
 
+void SpikingVideo::_copy(const float* sample, InputType* out) const
+{
+	// npy (frames, depth, height, width) to tensor (height, width, depth, frames)
+	for (size_t i = 0; i < _frame_number; i++)
+	{
+		for (size_t j = 0; j < _depth; j++)
+		{
+			const float* frame = sample + (i * _depth + j) * _height * _width;
+			for (size_t y = 0; y < _height; y++)
+			{
+				for (size_t x = 0; x < _width; x++)
+				{
+					out[((y * _width + x) * _depth + j) * _frame_number + i] = static_cast<InputType>(frame[y * _width + x]);
+				}
+			}
+		}
+	}
+}
+
+void SpikingVideo::_reduce(const float* sample, InputType* out) const
+{
+	size_t out_frame_number = _shape.dim(3);
+	size_t out_height = _shape.dim(0);
+	size_t out_width = _shape.dim(1);
+
+	std::fill(out, out + _shape.product(), static_cast<InputType>(0));
+
+	// Event-count pooling: the source values of a block are summed into the output value
+	for (size_t i = 0; i < out_frame_number * _temporal_factor; i++)
+	{
+		size_t oi = i / _temporal_factor;
+		for (size_t j = 0; j < _depth; j++)
+		{
+			const float* frame = sample + (i * _depth + j) * _height * _width;
+			for (size_t y = 0; y < out_height * _spatial_factor; y++)
+			{
+				InputType* row = out + (y / _spatial_factor) * out_width * _depth * out_frame_number + j * out_frame_number + oi;
+				const float* src = frame + y * _width;
+				for (size_t x = 0; x < out_width * _spatial_factor; x++)
+				{
+					row[(x / _spatial_factor) * _depth * out_frame_number] += static_cast<InputType>(src[x]);
+				}
+			}
+		}
+	}
+}
+
+const float* SpikingVideo::sample_data(size_t index) const
+{
+	return _data + index * _sample_size;
+}
 
+void SpikingVideo::_advise(size_t index, int advice) const
+{
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+
+	// madvise requires a page aligned address, only the pages that are fully inside the sample are released.
+	size_t begin = reinterpret_cast<const char*>(sample_data(index)) - _map;
+	size_t end = begin + _sample_size * sizeof(float);
+	if (advice == MADV_DONTNEED) {
+		begin = (begin + page_size - 1) / page_size * page_size;
+		end = end / page_size * page_size;
+	}
+	else {
+		begin = begin / page_size * page_size;
+	}
+
+	if (end > begin) {
+		madvise(_map + begin, end - begin, advice);
+	}
+}
 
 size_t SpikingVideo::size() const
 {
-	return _data_shape[0]*FRAME_HEIGHT*FRAME_WIDTH*VIDEO_DEPTH*FRAME_NUMBER;
+	return _end - _begin;
 }
 
 void SpikingVideo::reset()
 {
-	_cursor = 0;
-    _label_cursor=0;
+	_cursor = _begin;
+	if (_begin < _end) {
+		_advise(_begin, MADV_WILLNEED);
+	}
+}
+
+void SpikingVideo::shard(size_t index, size_t number)
+{
+	std::pair<size_t, size_t> range = shard_range(_size, index, number);
+	_begin = range.first;
+	_end = range.second;
+	reset();
 }
 
 const Shape &SpikingVideo::shape() const
@@ -68,14 +228,25 @@ const Shape &SpikingVideo::shape() const
 	return _shape;
 }
 
-
-
 std::string SpikingVideo::to_string() const
 {
-	return "SpikingVideo(" + std::to_string(_cursor) + ", " + std::to_string(_label_cursor) + ")";
+	std::string reduction;
+	if (_spatial_factor != 1 || _temporal_factor != 1) {
+		reduction = ", reduced to " + _shape.to_string();
+	}
+	return "SpikingVideo(" + _videos_npy_filename + ", " + std::to_string(_size) + " samples" + reduction + ")";
 }
 
 void SpikingVideo::close()
 {
-    ///
-}
\ No newline at end of file
+	if (_map != nullptr) {
+		munmap(_map, _map_size);
+		_map = nullptr;
+		_data = nullptr;
+	}
+
+	if (_fd != -1) {
+		::close(_fd);
+		_fd = -1;
+	}
+}
@@ -1,5 +1,7 @@
 #include "dataset/Video.h"
+#include "DiskCache.h"
 #include <iostream>
+#include <sstream>
 
 using namespace dataset;
 
@@ -16,7 +18,8 @@ Video::Video(const std::string &video_folder_path, const size_t &frame_per_video
 			 const size_t &sample_per_video, const size_t &grey_video,
 			 std::string exp_name, const size_t &draw, const size_t &frame_size_width, const size_t &frame_size_height, size_t max_read) : _video_folder_path(video_folder_path), _frame_per_video(frame_per_video), _frame_gap(frame_gap), _frame_gap_counter(0), _grey_video(grey_video),
 																																		   _sample_per_video(sample_per_video), _draw(draw), _frame_size_width(frame_size_width), _frame_size_height(frame_size_height), _exp_name(exp_name), _frame_preprocess(0), _frame_number(0), _threshold(threshold),
-																																		   _cursor(0), _cursor_count(0), _label_count(0), _shape({VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_DEPTH, CONV_DEPTH}), _max_read(max_read)
+																																		   _cursor(0), _cursor_count(0), _label_count(0), _shape({VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_DEPTH, CONV_DEPTH}), _max_read(max_read),
+																																		   _schedule(), _begin(0), _end(0), _thread_number(0), _prefetch_size(0), _cache_directory(), _cache_size(VIDEO_CACHE_SIZE), _workers(), _mutex(), _ready(), _space(), _prefetched(), _next_task(0), _consumed(0), _stop(false)
 {
 	for (const auto &file : std::filesystem::directory_iterator(_video_folder_path))
 	{
@@ -48,61 +51,155 @@ Video::Video(const std::string &video_folder_path, const size_t &frame_per_video
 	size_t _depth = _size_frame.channels();
 	size_t _conv_depth = _frame_per_video;
 	_shape = Shape(std::vector<size_t>({_height, _width, _depth, _conv_depth}));
+
+	// The samples taken by next(): with sample_per_video, the same video is read several times, each time shifted by 3 frames.
+	size_t cursor = 0;
+	size_t cursor_count = 0;
+	while (cursor < std::min(_size, _max_read))
+	{
+		_schedule.emplace_back(cursor, cursor_count);
+		if (_sample_per_video > 0)
+		{
+			if (cursor_count == _sample_per_video)
+			{
+				cursor++;
+				cursor_count = 0;
+			}
+			cursor_count++;
+		}
+		else
+			cursor++;
+	}
+
+	_end = _schedule.size();
+}
+
+Video::~Video()
+{
+	_stop_workers();
+}
+
+void Video::set_prefetch(size_t thread_number, size_t prefetch_size)
+{
+	if (!_workers.empty())
+		throw std::runtime_error("Video: the prefetch settings can't be changed once the decoding has started");
+
+	_thread_number = thread_number;
+	_prefetch_size = prefetch_size;
+}
+
+void Video::set_cache(bool cache, const std::string &directory, size_t size)
+{
+	if (!_workers.empty())
+		throw std::runtime_error("Video: the cache settings can't be changed once the decoding has started");
+
+	_cache_directory = cache ? directory : "";
+	_cache_size = size;
 }
 
 bool Video::has_next() const
 {
-	return _cursor < size();
+	return _consumed < _end;
 }
 
 std::pair<std::string, Tensor<InputType>> Video::next()
 {
-	_current_video_name = _video_list[_cursor];
-	cv::VideoCapture capture(_current_video_name);
+	if (!has_next())
+		throw std::runtime_error("Video: no more samples to read");
 
-	if (!capture.isOpened())
-		std::cout << "Unable to open file!" << std::endl;
+	if (_workers.empty())
+		_start_workers();
 
-	_frame_number = 0;
-	int size[3] = {_shape.dim(0), _shape.dim(1), _shape.dim(2)};
+	// The samples are decoded by the workers, wait for the one of the current position.
+	DecodedSample sample;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_ready.wait(lock, [this]
+					{ return _prefetched.find(_consumed) != _prefetched.end(); });
+		auto it = _prefetched.find(_consumed);
+		sample = std::move(it->second);
+		_prefetched.erase(it);
+		_consumed++;
+	}
+	_space.notify_all();
 
-	// frame dimentions
-	cv::Mat frame(_shape.dim(2), size, CV_32F, cv::Scalar(0)), skipFrame(_shape.dim(2), size, CV_32F, cv::Scalar(0)), spframe(_shape.dim(2), size, CV_32F, cv::Scalar(0));
-	// generate random sample start
-	int rand_start = rand() % 100;
-	// start video from a different point by adding a shift
-	set_frame_gap(_cursor_count * 3, capture, skipFrame);
+	if (sample.error)
+		std::rethrow_exception(sample.error);
 
+	_current_video_name = _video_list[_cursor];
 	size_t _label = assign_label_to_sample(_current_video_name);
-	// make shape dims of frame.
-	std::pair<std::string, Tensor<InputType>> out(std::to_string(static_cast<size_t>(_label)), _shape);
-	// extract a frame
-	capture >> frame;
+	std::pair<std::string, Tensor<InputType>> out(std::to_string(static_cast<size_t>(_label)), std::move(sample.tensor));
 
-	if (!frame.empty())
-		if (_frame_size_width != 0 || _frame_size_height != 0)
-			cv::resize(frame, frame, cv::Size(_frame_size_width, _frame_size_height));
+	_frame_number = 0;
+	if (_sample_per_video > 0)
+	{
+		if (_cursor_count == _sample_per_video)
+		{
+			_cursor++;
+			_cursor_count = 0;
+		}
+		_cursor_count++;
+	}
+	else
+		_cursor++;
 
-	if (!frame.empty())
-		if (_grey_video == 1 && !frame.empty())
-			cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
+	if (sample.moving && _draw == 1)
+		save_as_images(out);
 
-	int fluct = 0;
+	_frame_gap_counter = 0;
 
-	// loop.
-	while (true)
+	//Tensor<float>::draw_resized_tensor("/home/melassal/Workspace/CSNN/csnn-simulator-build/test/", out.second);
+	return out;
+}
+
+/**
+ * @brief Decodes one sample: skips the first frames of the video, then takes _frame_per_video frames, skipping _frame_gap frames after each one.
+ * When a threshold is set, the frames that don't move enough are discarded.
+ * Called by the worker threads, so it only reads the settings of the dataset.
+ *
+ * @param video_name the path of the video.
+ * @param shift the number of frames skipped at the start of the video.
+ * @param sample the decoded sample.
+ */
+void Video::_decode(const std::string &video_name, size_t shift, DecodedSample &sample)
+{
+	std::string key;
+	if (!_cache_directory.empty())
 	{
-		// speed up the action.
-		cv::Mat next_frame(_shape.dim(2), size, CV_32F, cv::Scalar(0));
+		key = _cache_key(video_name, shift);
+		if (_load_cache(key, sample))
+			return;
+	}
+
+	sample.tensor = Tensor<InputType>(_shape);
+	sample.tensor.fill(0);
+	sample.moving = false;
+
+	cv::VideoCapture capture(video_name);
+	if (!capture.isOpened())
+		throw std::runtime_error("Unable to open " + video_name);
+
+	// grab() skips a frame without decoding it.
+	for (size_t i = 0; i < shift; i++)
+		capture.grab();
 
+	cv::Mat frame;
+	capture >> frame;
+
+	if (!frame.empty() && (_frame_size_width != 0 || _frame_size_height != 0))
+		cv::resize(frame, frame, cv::Size(_frame_size_width, _frame_size_height));
+
+	if (!frame.empty() && _grey_video == 1)
+		cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
+
+	int frame_number = 0;
+	while (true)
+	{
+		cv::Mat next_frame;
 		capture >> next_frame;
 
-		// count number of frames
-		if (frame.empty() || next_frame.empty() || _frame_number == _frame_per_video)
-		{
-			_frame_number = 0;
+		if (frame.empty() || next_frame.empty() || frame_number == _frame_per_video)
 			break;
-		}
 
 		if (_frame_size_height != 0 || _frame_size_width != 0)
 			cv::resize(next_frame, next_frame, cv::Size(_frame_size_width, _frame_size_height));
@@ -110,56 +207,178 @@ std::pair<std::string, Tensor<InputType>> Video::next()
 		if (_grey_video == 1)
 			cv::cvtColor(next_frame, next_frame, cv::COLOR_BGR2GRAY);
 
-		// if (_current_video_name.find("running") != std::string::npos || _current_video_name.find("jogging") != std::string::npos || _current_video_name.find("walking") != std::string::npos)
-		if (_threshold > 0)
-			if (movement_threshold(frame, next_frame))
-			{
-				frame = next_frame;
-				fluct = 0;
-				continue;
-			}
+		if (_threshold > 0 && movement_threshold(frame, next_frame))
+		{
+			frame = next_frame;
+			sample.moving = false;
+			continue;
+		}
 
-		if (_frame_gap > 0)
-			set_frame_gap(_frame_gap, capture, skipFrame);
+		for (int i = 0; i < _frame_gap; i++)
+			capture.grab();
 
-		if (!frame.empty())
+		// frame_number loops over the CONV_DEPTH by being incremented every frame.
+		size_t channels = frame.channels();
+		for (int i = 0; i < frame.rows; i++)
 		{
-			// _frame_number loops over the CONV_DEPTH by being incremented every frame.
-			for (int i = 0; i < frame.rows; i++)
-				for (int j = 0; j < frame.cols; j++)
-					for (int k = 0; k < frame.channels(); k++)
-					{
-						if (frame.channels() > 1)
-							out.second.at(i, j, k, _frame_number) = (frame.at<cv::Vec3b>(i, j)[k]);
-						else
-							out.second.at(i, j, k, _frame_number) = (frame.at<unsigned char>(i, j));
-					}
-			_frame_number++;
+			const unsigned char *row = frame.ptr<unsigned char>(i);
+			for (int j = 0; j < frame.cols; j++)
+				for (size_t k = 0; k < channels; k++)
+					sample.tensor.at(i, j, k, frame_number) = row[j * channels + k];
 		}
-		fluct = 1;
+		frame_number++;
+
+		sample.moving = true;
 		frame = next_frame;
 	}
-	if (_sample_per_video > 0)
+
+	if (!_cache_directory.empty())
+		_save_cache(key, sample);
+}
+
+std::string Video::_cache_key(const std::string &video_name, size_t shift) const
+{
+	std::stringstream key;
+	key << video_name << ";" << std::filesystem::last_write_time(video_name).time_since_epoch().count() << ";" << std::filesystem::file_size(video_name)
+		<< ";" << shift << ";" << _frame_gap << ";" << _threshold << ";" << _grey_video << ";" << _frame_size_width << "x" << _frame_size_height << ";" << _frame_per_video;
+	return key.str();
+}
+
+/**
+ * @brief Cache file layout: key length (uint32), key, moving flag (uint8), dimension number (uint32), dimensions (uint32), values (float).
+ * The key is checked when the file is read, so a hash collision or a modified video is a cache miss.
+ */
+bool Video::_load_cache(const std::string &key, DecodedSample &sample) const
+{
+	std::ifstream file(_cache_directory + "/" + std::to_string(std::hash<std::string>()(key)), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	uint32_t key_length = 0;
+	file.read(reinterpret_cast<char *>(&key_length), sizeof(uint32_t));
+	if (!file.good() || key_length != key.size())
+		return false;
+
+	std::string file_key(key_length, '\0');
+	file.read(&file_key[0], key_length);
+	if (file_key != key)
+		return false;
+
+	uint8_t moving = 0;
+	uint32_t dim_number = 0;
+	file.read(reinterpret_cast<char *>(&moving), sizeof(uint8_t));
+	file.read(reinterpret_cast<char *>(&dim_number), sizeof(uint32_t));
+	if (!file.good() || dim_number != _shape.number())
+		return false;
+
+	for (size_t i = 0; i < dim_number; i++)
 	{
-		if (_cursor_count == _sample_per_video)
+		uint32_t dim = 0;
+		file.read(reinterpret_cast<char *>(&dim), sizeof(uint32_t));
+		if (dim != _shape.dim(i))
+			return false;
+	}
+
+	sample.tensor = Tensor<InputType>(_shape);
+	file.read(reinterpret_cast<char *>(sample.tensor.begin()), _shape.product() * sizeof(InputType));
+	sample.moving = moving != 0;
+	return file.good();
+}
+
+void Video::_save_cache(const std::string &key, const DecodedSample &sample) const
+{
+	if (!reserve_disk_cache(_cache_directory, sizeof(uint32_t) + key.size() + sizeof(uint8_t) + sizeof(uint32_t) * (1 + _shape.number()) + _shape.product() * sizeof(InputType), _cache_size))
+		return;
+
+	// Written in a temporary file then renamed, so that a reader never sees a partial file.
+	std::string filename = _cache_directory + "/" + std::to_string(std::hash<std::string>()(key));
+	std::stringstream temporary;
+	temporary << filename << "." << std::this_thread::get_id() << ".tmp";
+
+	{
+		std::ofstream file(temporary.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return;
+
+		uint32_t key_length = key.size();
+		uint8_t moving = sample.moving ? 1 : 0;
+		uint32_t dim_number = _shape.number();
+		file.write(reinterpret_cast<const char *>(&key_length), sizeof(uint32_t));
+		file.write(key.data(), key_length);
+		file.write(reinterpret_cast<const char *>(&moving), sizeof(uint8_t));
+		file.write(reinterpret_cast<const char *>(&dim_number), sizeof(uint32_t));
+		for (size_t i = 0; i < dim_number; i++)
 		{
-			_cursor++;
-			_cursor_count = 0;
+			uint32_t dim = _shape.dim(i);
+			file.write(reinterpret_cast<const char *>(&dim), sizeof(uint32_t));
 		}
-		_cursor_count++;
+		file.write(reinterpret_cast<const char *>(sample.tensor.begin()), _shape.product() * sizeof(InputType));
 	}
-	else
-		_cursor++;
 
-	if (fluct == 1 && _draw == 1)
-		save_as_images(out);
+	std::error_code error;
+	std::filesystem::rename(temporary.str(), filename, error);
+	if (error)
+		std::filesystem::remove(temporary.str(), error);
+}
 
-	_frame_gap_counter = 0;
+void Video::_start_workers()
+{
+	if (!_cache_directory.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(_cache_directory, error);
+	}
 
-	capture.release();
+	size_t thread_number = _thread_number > 0 ? _thread_number : std::max<size_t>(1, std::thread::hardware_concurrency());
+	if (_prefetch_size == 0)
+		_prefetch_size = 2 * thread_number;
 
-	//Tensor<float>::draw_resized_tensor("/home/melassal/Workspace/CSNN/csnn-simulator-build/test/", out.second);
-	return out;
+	_stop = false;
+	for (size_t i = 0; i < thread_number; i++)
+		_workers.emplace_back(&Video::_run_worker, this);
+}
+
+void Video::_stop_workers()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_space.notify_all();
+
+	for (std::thread &worker : _workers)
+		worker.join();
+	_workers.clear();
+}
+
+void Video::_run_worker()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		// The queue is bounded: a worker only starts a sample that is less than _prefetch_size samples ahead of next().
+		_space.wait(lock, [this]
+					{ return _stop || _next_task >= _end || _next_task < _consumed + _prefetch_size; });
+		if (_stop || _next_task >= _end)
+			return;
+
+		size_t task = _next_task++;
+		lock.unlock();
+
+		DecodedSample sample;
+		try
+		{
+			_decode(_video_list[_schedule[task].first], _schedule[task].second * 3, sample);
+		}
+		catch (...)
+		{
+			sample.error = std::current_exception();
+		}
+
+		lock.lock();
+		_prefetched.emplace(task, std::move(sample));
+		_ready.notify_all();
+	}
 }
 
 void Video::save_as_images(std::pair<std::string, Tensor<InputType>> out)
@@ -262,28 +481,41 @@ cv::Mat Video::frame_preprocess(int _frame_preprocess, cv::Mat frame, cv::Mat ne
 
 void Video::reset()
 {
-	_cursor = 0;
+	_stop_workers();
+	_prefetched.clear();
+	_next_task = _begin;
+	_consumed = _begin;
+
+	_cursor = _begin < _schedule.size() ? _schedule[_begin].first : 0;
+	_cursor_count = _begin < _schedule.size() ? _schedule[_begin].second : 0;
 	_label_count = 0;
 }
 
+void Video::shard(size_t index, size_t number)
+{
+	std::pair<size_t, size_t> range = shard_range(_schedule.size(), index, number);
+	_begin = range.first;
+	_end = range.second;
+	reset();
+}
+
 void Video::close()
 {
-	// _label_file.close();
-	// _image_file.close();
+	_stop_workers();
+	_prefetched.clear();
 }
 
 size_t Video::size() const
 {
-	return std::min(_size, _max_read);
+	return _end - _begin;
 }
 
 std::string Video::to_string() const
 {
-	int _spv = _sample_per_video <= 0 ? 1 : _sample_per_video;
 	if (_video_folder_path.find("train") != std::string::npos)
-		set_sample_count(size() * _spv, 1);
+		set_sample_count(size(), 1);
 	if (_video_folder_path.find("test") != std::string::npos)
-		set_sample_count(size() * _spv, 2);
+		set_sample_count(size(), 2);
 
 	return "Video(" + _video_folder_path + ")[" + std::to_string(size()) + "]";
 }
@@ -114,8 +114,8 @@ void EmptyExecution::_process_output(size_t index)
 			}
 			if (_save_features)
 			{
-				SavePairVector(_file_path + "/ExtractedFeatures/" + _experiment.name() + "/train/" + _experiment.name() + ".json", output_train_set);
-				SavePairVector(_file_path + "/ExtractedFeatures/" + _experiment.name() + "/test/" + _experiment.name() + ".json", output_test_set);
+				SavePairVector(_file_path + "/ExtractedFeatures/" + _experiment.name() + "/train/" + _experiment.name() + ".features", output_train_set);
+				SavePairVector(_file_path + "/ExtractedFeatures/" + _experiment.name() + "/test/" + _experiment.name() + ".features", output_test_set);
 			}
 			if (_draw_features)
 			{
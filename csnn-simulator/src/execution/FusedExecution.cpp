@@ -55,8 +55,8 @@ void FusedExecution::_load_data()
 		size_t count = 0;
 		while (input->has_next())
 		{
-			auto entry = input->next();
-			_train_set.emplace_back(entry.first, to_sparse_tensor(entry.second));
+			auto entry = input->next_sparse();
+			_train_set.emplace_back(entry.first, std::move(entry.second));
 			count++;
 		}
 		_experiment.log() << "Load " << count << " train samples from " << input->to_string() << std::endl;
@@ -68,8 +68,8 @@ void FusedExecution::_load_data()
 		size_t count = 0;
 		while (input->has_next())
 		{
-			auto entry = input->next();
-			_test_set.emplace_back(entry.first, to_sparse_tensor(entry.second));
+			auto entry = input->next_sparse();
+			_test_set.emplace_back(entry.first, std::move(entry.second));
 			count++;
 		}
 		_experiment.log() << "Load " << count << " test samples from " << input->to_string() << std::endl;
@@ -123,8 +123,8 @@ void FusedExecution::_process_output(size_t index)
 			}
 			if (_save_features)
 			{
-				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/Fused_Result/train/" + _experiment.name() + ".json", output_train_set);
-				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/Fused_Result/test/" + _experiment.name() + ".json", output_test_set);
+				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/Fused_Result/train/" + _experiment.name() + ".features", output_train_set);
+				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/Fused_Result/test/" + _experiment.name() + ".features", output_test_set);
 			}
 			if (_draw_features)
 			{
@@ -53,8 +53,8 @@ void SparseIntermediateExecution::_load_data()
 		size_t count = 0;
 		while (input->has_next())
 		{
-			auto entry = input->next();
-			_train_set.emplace_back(entry.first, to_sparse_tensor(entry.second));
+			auto entry = input->next_sparse();
+			_train_set.emplace_back(entry.first, std::move(entry.second));
 			count++;
 		}
 		_experiment.log() << "Load " << count << " train samples from " << input->to_string() << std::endl;
@@ -66,8 +66,8 @@ void SparseIntermediateExecution::_load_data()
 		size_t count = 0;
 		while (input->has_next())
 		{
-			auto entry = input->next();
-			_test_set.emplace_back(entry.first, to_sparse_tensor(entry.second));
+			auto entry = input->next_sparse();
+			_test_set.emplace_back(entry.first, std::move(entry.second));
 			count++;
 		}
 		_experiment.log() << "Load " << count << " test samples from " << input->to_string() << std::endl;
@@ -84,6 +84,10 @@ void SparseIntermediateExecution::_process_train_data(AbstractProcess &process,
 		throw std::runtime_error("train_pass_number() should be > 0");
 	}
 
+	SparseTwoPassProcess *sparse_two_pass_process = n == 2 ? dynamic_cast<SparseTwoPassProcess *>(&process) : nullptr;
+	SparseProcess *sparse_process = n == 1 || sparse_two_pass_process != nullptr ? dynamic_cast<SparseProcess *>(&process) : nullptr;
+	SparseSpikeProcess *sparse_spike_process = dynamic_cast<SparseSpikeProcess *>(&process);
+
 	for (size_t i = 0; i < n; i++)
 	{
 
@@ -91,9 +95,24 @@ void SparseIntermediateExecution::_process_train_data(AbstractProcess &process,
 		size_t total_capacity = 0;
 		for (size_t j = 0; j < data.size(); j++)
 		{
-			Tensor<float> current = from_sparse_tensor(data[j].second);
-			process.process_train_sample(data[j].first, current, i, j, data.size());
-			data[j].second = to_sparse_tensor(current);
+			if (sparse_two_pass_process != nullptr && i == 0)
+			{
+				sparse_two_pass_process->compute_sparse(data[j].first, data[j].second);
+			}
+			else if (sparse_process != nullptr)
+			{
+				sparse_process->process_train_sparse(data[j].first, data[j].second);
+			}
+			else if (sparse_spike_process != nullptr)
+			{
+				sparse_spike_process->process_train_sparse_sample(data[j].first, data[j].second, i, j, data.size());
+			}
+			else
+			{
+				Tensor<float> current = from_sparse_tensor(data[j].second);
+				process.process_train_sample(data[j].first, current, i, j, data.size());
+				data[j].second = to_sparse_tensor(current);
+			}
 
 			total_size += data[j].second.values().size();
 			total_capacity += data[j].second.values().size();
@@ -122,11 +141,26 @@ void SparseIntermediateExecution::_process_train_data(AbstractProcess &process,
 
 void SparseIntermediateExecution::_process_test_data(AbstractProcess &process, std::vector<std::pair<std::string, SparseTensor<float>>> &data)
 {
+	size_t n = process.train_pass_number();
+	SparseProcess *sparse_process = n == 1 || (n == 2 && dynamic_cast<SparseTwoPassProcess *>(&process) != nullptr) ? dynamic_cast<SparseProcess *>(&process) : nullptr;
+	SparseSpikeProcess *sparse_spike_process = dynamic_cast<SparseSpikeProcess *>(&process);
+
 	for (size_t j = 0; j < _test_set.size(); j++)
 	{
-		Tensor<float> current = from_sparse_tensor(data[j].second);
-		process.process_test_sample(data[j].first, current, j, data.size());
-		data[j].second = to_sparse_tensor(current);
+		if (sparse_process != nullptr)
+		{
+			sparse_process->process_test_sparse(data[j].first, data[j].second);
+		}
+		else if (sparse_spike_process != nullptr)
+		{
+			sparse_spike_process->process_test_sparse_sample(data[j].first, data[j].second, j, data.size());
+		}
+		else
+		{
+			Tensor<float> current = from_sparse_tensor(data[j].second);
+			process.process_test_sample(data[j].first, current, j, data.size());
+			data[j].second = to_sparse_tensor(current);
+		}
 
 		if (data[j].second.shape() != process.shape())
 		{
@@ -17,8 +17,8 @@ void SparseIntermediateExecutionNew::process(size_t refresh_interval)
 	if (_allow_residual_connections == true)
 	{
 		std::filesystem::create_directories(_file_path + "/ResInput/");
-		SaveInputPairVector(_file_path + "/ResInput/" + _experiment.name() + "_train.json", _train_set);
-		SaveInputPairVector(_file_path + "/ResInput/" + _experiment.name() + "_test.json", _test_set);
+		SaveInputPairVector(_file_path + "/ResInput/" + _experiment.name() + "_train.features", _train_set);
+		SaveInputPairVector(_file_path + "/ResInput/" + _experiment.name() + "_test.features", _test_set);
 	}
 	std::vector<size_t> train_index;
 	for (size_t i = 0; i < _train_set.size(); i++)
@@ -70,8 +70,8 @@ void SparseIntermediateExecutionNew::_load_data()
 		size_t count = 0;
 		while (input->has_next())
 		{
-			auto entry = input->next();
-			_train_set.emplace_back(entry.first, to_sparse_tensor(entry.second));
+			auto entry = input->next_sparse();
+			_train_set.emplace_back(entry.first, std::move(entry.second));
 			count++;
 		}
 		_experiment.log() << "Load " << count << " train samples from " << input->to_string() << std::endl;
@@ -83,8 +83,8 @@ void SparseIntermediateExecutionNew::_load_data()
 		size_t count = 0;
 		while (input->has_next())
 		{
-			auto entry = input->next();
-			_test_set.emplace_back(entry.first, to_sparse_tensor(entry.second));
+			auto entry = input->next_sparse();
+			_test_set.emplace_back(entry.first, std::move(entry.second));
 			count++;
 		}
 		_experiment.log() << "Load " << count << " test samples from " << input->to_string() << std::endl;
@@ -140,6 +140,10 @@ void SparseIntermediateExecutionNew::_process_train_data(AbstractProcess &proces
 	{
 		throw std::runtime_error("train_pass_number() should be > 0");
 	}
+
+	SparseTwoPassProcess *sparse_two_pass_process = n == 2 ? dynamic_cast<SparseTwoPassProcess *>(&process) : nullptr;
+	SparseProcess *sparse_process = n == 1 || sparse_two_pass_process != nullptr ? dynamic_cast<SparseProcess *>(&process) : nullptr;
+	SparseSpikeProcess *sparse_spike_process = dynamic_cast<SparseSpikeProcess *>(&process);
 	// during training, n = epochs
 	for (size_t i = 0; i < n; i++)
 	{
@@ -151,9 +155,24 @@ void SparseIntermediateExecutionNew::_process_train_data(AbstractProcess &proces
 
 		for (size_t j = 0; j < data.size(); j++)
 		{
-			Tensor<float> current = from_sparse_tensor(data[j].second);
-			process.process_train_sample(_experiment.name() + ";." + std::to_string(process.index()) + ";." + data[j].first, current, i, j, data.size());
-			data[j].second = to_sparse_tensor(current);
+			if (sparse_two_pass_process != nullptr && i == 0)
+			{
+				sparse_two_pass_process->compute_sparse(_experiment.name() + ";." + std::to_string(process.index()) + ";." + data[j].first, data[j].second);
+			}
+			else if (sparse_process != nullptr)
+			{
+				sparse_process->process_train_sparse(_experiment.name() + ";." + std::to_string(process.index()) + ";." + data[j].first, data[j].second);
+			}
+			else if (sparse_spike_process != nullptr)
+			{
+				sparse_spike_process->process_train_sparse_sample(_experiment.name() + ";." + std::to_string(process.index()) + ";." + data[j].first, data[j].second, i, j, data.size());
+			}
+			else
+			{
+				Tensor<float> current = from_sparse_tensor(data[j].second);
+				process.process_train_sample(_experiment.name() + ";." + std::to_string(process.index()) + ";." + data[j].first, current, i, j, data.size());
+				data[j].second = to_sparse_tensor(current);
+			}
 
 			total_size += data[j].second.values().size();
 			total_capacity += data[j].second.values().size();
@@ -182,14 +201,29 @@ void SparseIntermediateExecutionNew::_process_train_data(AbstractProcess &proces
 
 void SparseIntermediateExecutionNew::_process_test_data(AbstractProcess &process, std::vector<std::pair<std::string, SparseTensor<float>>> &data)
 {
+	size_t n = process.train_pass_number();
+	SparseProcess *sparse_process = n == 1 || (n == 2 && dynamic_cast<SparseTwoPassProcess *>(&process) != nullptr) ? dynamic_cast<SparseProcess *>(&process) : nullptr;
+	SparseSpikeProcess *sparse_spike_process = dynamic_cast<SparseSpikeProcess *>(&process);
+
 	if (process.class_name() == "SetTemporalDepth")
 		_set_temporal_depth(process, data);
 
 	for (size_t j = 0; j < data.size(); j++)
 	{
-		Tensor<float> current = from_sparse_tensor(data[j].second);
-		process.process_test_sample(data[j].first, current, j, data.size());
-		data[j].second = to_sparse_tensor(current);
+		if (sparse_process != nullptr)
+		{
+			sparse_process->process_test_sparse(data[j].first, data[j].second);
+		}
+		else if (sparse_spike_process != nullptr)
+		{
+			sparse_spike_process->process_test_sparse_sample(data[j].first, data[j].second, j, data.size());
+		}
+		else
+		{
+			Tensor<float> current = from_sparse_tensor(data[j].second);
+			process.process_test_sample(data[j].first, current, j, data.size());
+			data[j].second = to_sparse_tensor(current);
+		}
 
 		if (data[j].second.shape() != process.shape() && process.class_name() != "LateFusion")
 		{
@@ -216,8 +250,8 @@ void SparseIntermediateExecutionNew::_process_output(size_t index)
 			{
 				std::filesystem::create_directories(_file_path + "/ExtractedTimestamps/" + _mainExpName + "/test/");
 				std::filesystem::create_directories(_file_path + "/ExtractedTimestamps/" + _mainExpName + "/train/");
-				SavePairVector(_file_path + "/ExtractedTimestamps/" + _mainExpName + "/train/" + _experiment.name() + "_timestamps.json", _train_set);
-				SavePairVector(_file_path + "/ExtractedTimestamps/" + _mainExpName + "/test/" + _experiment.name() + "_timestamps.json", _test_set);
+				SavePairVector(_file_path + "/ExtractedTimestamps/" + _mainExpName + "/train/" + _experiment.name() + "_timestamps.features", _train_set);
+				SavePairVector(_file_path + "/ExtractedTimestamps/" + _mainExpName + "/test/" + _experiment.name() + "_timestamps.features", _test_set);
 			}
 
 			for (std::pair<std::string, SparseTensor<float>> &entry : _train_set)
@@ -253,8 +287,8 @@ void SparseIntermediateExecutionNew::_process_output(size_t index)
 			{
 				std::filesystem::create_directories(_file_path + "/ExtractedFeatures/" + _mainExpName + "/test/");
 				std::filesystem::create_directories(_file_path + "/ExtractedFeatures/" + _mainExpName + "/train/");
-				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/train/" + _experiment.name() + ".json", output_train_set);
-				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/test/" + _experiment.name() + ".json", output_test_set);
+				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/train/" + _experiment.name() + ".features", output_train_set);
+				SavePairVector(_file_path + "/ExtractedFeatures/" + _mainExpName + "/test/" + _experiment.name() + ".features", output_test_set);
 			}
 			if (_draw_features)
 			{
@@ -266,8 +300,8 @@ void SparseIntermediateExecutionNew::_process_output(size_t index)
 			if (_allow_residual_connections == true)
 			{
 				std::filesystem::create_directories(_file_path + "/ResInput/");
-				SaveInputPairVector(_file_path + "/ResInput/" + _experiment.output_at(i).name() + "_train.json", _train_set);
-				SaveInputPairVector(_file_path + "/ResInput/" + _experiment.output_at(i).name() + "_test.json", _test_set);
+				SaveInputPairVector(_file_path + "/ResInput/" + _experiment.output_at(i).name() + "_train.features", _train_set);
+				SaveInputPairVector(_file_path + "/ResInput/" + _experiment.output_at(i).name() + "_test.features", _test_set);
 			}
 
 			for (Analysis *analysis : output.analysis())
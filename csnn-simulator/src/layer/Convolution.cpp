@@ -1,4 +1,6 @@
 #include "layer/Convolution.h"
+#include "Simd.h"
+#include "layer/Homeostasis.h"
 #include "Experiment.h"
 #include <execution>
 #include <mutex>
@@ -107,16 +109,19 @@ void Convolution::process_train_sample(const std::string &label, Tensor<float> &
 		size_t x = 0;
 		size_t y = 0;
 
+		// The patch position only depends on (layer, epoch, sample), not on the samples processed before.
+		Philox random_generator = experiment()->random_stream(index(), current_pass, current_index);
+
 		if (_filter_width < _width)
 		{
 			std::uniform_int_distribution<size_t> rand_x(0, _width - _filter_width);
-			x = rand_x(experiment()->random_generator());
+			x = rand_x(random_generator);
 		}
 
 		if (_filter_height < _height)
 		{
 			std::uniform_int_distribution<size_t> rand_y(0, _height - _filter_height);
-			y = rand_y(experiment()->random_generator());
+			y = rand_y(random_generator);
 		}
 
 		Tensor<Time> input_time(Shape({_filter_width, _filter_height, _input_depth}));
@@ -258,10 +263,6 @@ void Convolution::plot_evolution(bool only_in_train)
 #endif
 
 #ifdef SMID_AVX256
-#include <immintrin.h>
-
-#define AVX_256_N 8
-
 static __m256i _generate_mask(int n)
 {
 
@@ -348,19 +349,7 @@ void _priv::ConvolutionImpl::train(const std::vector<Spike> &input_spike, const
 				{
 					if (_a.at_index(i * AVX_256_N + j) > th.at_index(i * AVX_256_N + j))
 					{
-						for (size_t z1 = 0; z1 < depth; z1++)
-						{
-							th.at(z1) -= _model._lr_th * (spike.time - _model._t_obj);
-							if (z1 != i * AVX_256_N + j)
-							{
-								th.at(z1) -= _model._lr_th / static_cast<float>(depth - 1);
-							}
-							else
-							{
-								th.at(z1) += _model._lr_th;
-							}
-							th.at(z1) = std::max<float>(_model._min_th, th.at(z1));
-						}
+						adapt_threshold(th, i * AVX_256_N + j, spike.time, _model._t_obj, _model._lr_th, _model._min_th);
 
 						for (size_t x = 0; x < _model._filter_width; x++)
 						{
@@ -390,19 +379,7 @@ void _priv::ConvolutionImpl::train(const std::vector<Spike> &input_spike, const
 			{
 				if (_a.at_index(n * AVX_256_N + j) > th.at_index(n * AVX_256_N + j))
 				{
-					for (size_t z1 = 0; z1 < depth; z1++)
-					{
-						th.at(z1) -= _model._lr_th * (spike.time - _model._t_obj);
-						if (z1 != n * AVX_256_N + j)
-						{
-							th.at(z1) -= _model._lr_th / static_cast<float>(depth - 1);
-						}
-						else
-						{
-							th.at(z1) += _model._lr_th;
-						}
-						th.at(z1) = std::max<float>(_model._min_th, th.at(z1));
-					}
+					adapt_threshold(th, n * AVX_256_N + j, spike.time, _model._t_obj, _model._lr_th, _model._min_th);
 
 					for (size_t x = 0; x < _model._filter_width; x++)
 					{
@@ -569,15 +546,7 @@ void _priv::ConvolutionImpl::train(const std::vector<Spike> &input_spike, const
 
 			if (_a.at(0, 0, z) >= th.at(z))
 			{
-				for (size_t z1 = 0; z1 < depth; z1++)
-				{
-					th.at(z1) -= _model._lr_th * (spike.time - _model._t_obj);
-					if (z1 != z)
-						th.at(z1) -= _model._lr_th / static_cast<float>(depth - 1);
-					else
-						th.at(z1) += _model._lr_th;
-					th.at(z1) = std::max<float>(_model._min_th, th.at(z1));
-				}
+				adapt_threshold(th, z, spike.time, _model._t_obj, _model._lr_th, _model._min_th);
 
 				for (size_t x = 0; x < _model._filter_width; x++)
 					for (size_t y = 0; y < _model._filter_height; y++)
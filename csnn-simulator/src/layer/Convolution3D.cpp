@@ -1,4 +1,7 @@
 #include "layer/Convolution3D.h"
+#include "Simd.h"
+#include "layer/Homeostasis.h"
+#include "layer/Quantization.h"
 #include "Experiment.h"
 #include <execution>
 #include <mutex>
@@ -17,13 +20,15 @@ static RegisterClassParameter<Convolution3D, LayerFactory> _register("Convolutio
  */
 Convolution3D::Convolution3D() : Layer4D(_register),
 								 _inhibition(true), _model_path(""), _draw(false), _epoch_number(0), _annealing(1.0), _min_th(0), _t_obj(0), _lr_th(0),
-								 _w(), _th(), _stdp(nullptr), _input_depth(0), _input_conv_depth(0), _impl(*this)
+								 _w(), _th(), _stdp(nullptr), _input_depth(0), _input_conv_depth(0), _impl(*this),
+								 _snapshot(), _snapshot_directory(), _snapshot_name(), _label_prefix(), _snapshot_label(), _snapshot_neuron(0)
 {
 	add_parameter("draw", _draw);
 	add_parameter("save_weights", _save_weights);
 	add_parameter("save_random_start", _save_random_start);
 	add_parameter("log_spiking_neuron", _log_spiking_neuron);
 	add_parameter("inhibition", _inhibition);
+	add_parameter("quantization", _quantization, 0u);
 	add_parameter("epoch", _epoch_number);
 	add_parameter("annealing", _annealing, 1.0f); // Simulated annealing is a method for solving unconstrained and bound-constrained optimization problems. this parameter is used to modify other parameters
 	add_parameter("min_th", _min_th);			  // minimum threashould
@@ -39,13 +44,15 @@ Convolution3D::Convolution3D(size_t filter_number, size_t filter_width, size_t f
 	: Layer4D(_register, filter_number, filter_width, filter_height, filter_depth, stride_x, stride_y, stride_k, padding_x, padding_y, padding_k),
 	  _inhibition(true), _model_path(model_path), _draw(false), _save_weights(false), _save_random_start(false), _log_spiking_neuron(false), _annealing(1.0),
 	  _min_th(0), _t_obj(0), _lr_th(0), _sample_number(0), _sample_count(0), _spike_count(0), _drawn_weights(0), _saved_weights(0), _logged_spiking_neuron(0), _saved_random_start(0),
-	  _w(), _th(), _stdp(nullptr), _input_depth(0), _impl(*this)
+	  _w(), _th(), _stdp(nullptr), _input_depth(0), _impl(*this),
+	  _snapshot(), _snapshot_directory(), _snapshot_name(), _label_prefix(), _snapshot_label(), _snapshot_neuron(0)
 {
 	add_parameter("draw", _draw);
 	add_parameter("save_weights", _save_weights);
 	add_parameter("save_random_start", _save_random_start);
 	add_parameter("log_spiking_neuron", _log_spiking_neuron);
 	add_parameter("inhibition", _inhibition);
+	add_parameter("quantization", _quantization, 0u);
 	add_parameter("epoch", _epoch_number);
 	add_parameter("annealing", _annealing, 1.0f);
 	add_parameter("min_th", _min_th);
@@ -81,6 +88,17 @@ Shape Convolution3D::compute_shape(const Shape &previous_shape)
 	parameter<Tensor<float>>("w").shape(_filter_width, _filter_height, _input_depth, _filter_number, _filter_conv_depth);
 	parameter<Tensor<float>>("th").shape(_filter_number);
 
+#ifdef SMID_AVX256
+	if (_quantization != 0)
+	{
+		throw std::runtime_error("Convolution3D: quantization is not supported by the SMID_AVX256 implementation");
+	}
+#endif
+	if (_quantization != 0 && _quantization != 8 && _quantization != 16)
+	{
+		throw std::runtime_error("Convolution3D: quantization must be 0, 8 or 16");
+	}
+
 	_impl.resize();
 	// TODO: _conv_depth or filter_depth here?
 	return Shape({_width, _height, _depth, _conv_depth});
@@ -99,28 +117,7 @@ size_t Convolution3D::train_pass_number() const
 
 void Convolution3D::process_train_sample(const std::string &label, Tensor<float> &sample, size_t current_pass, size_t current_index, size_t number)
 {
-	// The training
-	if (current_index == 0)
-	{
-		if (current_pass < _epoch_number)
-		{
-			_current_epoch_number = current_pass;
-			_current_width = 1;
-			_current_height = 1;
-			_current_conv_depth = 1;
-			std::cout << "\rEpoch " << current_pass << "/" << _epoch_number;
-
-			on_epoch_start();
-		}
-		else
-		{
-			_current_width = _width;
-			_current_height = _height;
-			_current_conv_depth = _conv_depth;
-			std::cout << std::endl
-					  << "Process train set" << std::endl;
-		}
-	}
+	_start_train_sample(current_pass, current_index);
 
 	std::vector<Spike> input_spike;
 	std::vector<Spike> output_spike;
@@ -129,29 +126,11 @@ void Convolution3D::process_train_sample(const std::string &label, Tensor<float>
 	{
 		size_t x = 0;
 		size_t y = 0;
-		size_t z = 0;
 		size_t k = 0;
-		float t = 0.0;
-		// do // take the random patches around places where a spike exists
-		// {
-		if (_filter_width < _width)
-		{
-			std::uniform_int_distribution<size_t> rand_x(0, _width - _filter_width);
-			x = rand_x(experiment()->random_generator());
-		}
-		if (_filter_height < _height)
-		{
-			std::uniform_int_distribution<size_t> rand_y(0, _height - _filter_height);
-			y = rand_y(experiment()->random_generator());
-		}
-		if (_filter_conv_depth < _conv_depth)
-		{
-			std::uniform_int_distribution<size_t> rand_y(0, _conv_depth - _filter_conv_depth);
-			k = rand_y(experiment()->random_generator());
-		}
+		_random_patch(current_pass, current_index, x, y, k);
 
 		// 	std::uniform_int_distribution<size_t> rand_z(0, _input_depth - 1);
-		// 	z = rand_z(experiment()->random_generator());
+		// 	z = rand_z(random_generator);
 		// 	t = sample.at(x, y, z, k);
 		// } while (t == 0.0 || t > 1);
 
@@ -191,13 +170,7 @@ void Convolution3D::process_train_sample(const std::string &label, Tensor<float>
 
 void Convolution3D::process_test_sample(const std::string &label, Tensor<float> &sample, size_t current_index, size_t number)
 {
-	if (current_index == 0)
-	{
-		std::cout << "Process test set" << std::endl;
-		_current_width = _width;
-		_current_height = _height;
-		_current_conv_depth = _conv_depth;
-	}
+	_start_test_sample(current_index);
 
 	std::vector<Spike> input_spike;
 	SpikeConverter::to_spike(sample, input_spike);
@@ -208,9 +181,159 @@ void Convolution3D::process_test_sample(const std::string &label, Tensor<float>
 	SpikeConverter::from_spike(output_spike, sample);
 }
 
+/**
+ * @brief Same as process_train_sample on a sample of the sparse executions: the patch and the spikes are read from the stored values.
+ * The input times given to test() are empty, the implementations only use them for training.
+ */
+void Convolution3D::process_train_sparse_sample(const std::string &label, SparseTensor<float> &sample, size_t current_pass, size_t current_index, size_t number)
+{
+	_start_train_sample(current_pass, current_index);
+
+	std::vector<Spike> input_spike;
+	std::vector<Spike> output_spike;
+
+	if (current_pass < _epoch_number)
+	{
+		size_t x = 0;
+		size_t y = 0;
+		size_t k = 0;
+		_random_patch(current_pass, current_index, x, y, k);
+
+		// Same patch as the dense version, only the stored values that fall inside it are copied.
+		const Shape &shape = sample.shape();
+		size_t sample_width = shape.dim(1);
+		size_t sample_conv_depth = shape.number() > 3 ? shape.dim(3) : 1;
+		Tensor<Time> input_time(Shape({_filter_width, _filter_height, _input_depth, _filter_conv_depth}));
+		input_time.fill(sample.default_value());
+		for (const std::pair<uint32_t, float> &value : sample.values())
+		{
+			size_t index = value.first;
+			size_t ck = index % sample_conv_depth;
+			index /= sample_conv_depth;
+			size_t cz = index % _input_depth;
+			index /= _input_depth;
+			size_t cy = index % sample_width;
+			size_t cx = index / sample_width;
+
+			if (cx >= x && cx < x + _filter_height && cy >= y && cy < y + _filter_width && ck >= k && ck < k + _filter_conv_depth)
+			{
+				input_time.at(cx - x, cy - y, cz, ck - k) = value.second;
+			}
+		}
+
+		SpikeConverter::to_spike(input_time, input_spike);
+		train(label, input_spike, input_time, output_spike);
+	}
+	else
+	{
+		SpikeConverter::to_spike(sample, input_spike);
+		_sample_number = number;
+		test(label, input_spike, Tensor<Time>(), output_spike);
+		sample = SparseTensor<float>(shape(), INFINITE_TIME);
+		SpikeConverter::from_spike(output_spike, sample);
+	}
+
+	if (current_index == number - 1 && current_pass < _epoch_number)
+	{
+		on_epoch_end();
+	}
+}
+
+void Convolution3D::process_test_sparse_sample(const std::string &label, SparseTensor<float> &sample, size_t current_index, size_t number)
+{
+	_start_test_sample(current_index);
+
+	std::vector<Spike> input_spike;
+	SpikeConverter::to_spike(sample, input_spike);
+	std::vector<Spike> output_spike;
+	_sample_number = number;
+	test(label, input_spike, Tensor<Time>(), output_spike);
+	sample = SparseTensor<float>(shape(), INFINITE_TIME);
+	SpikeConverter::from_spike(output_spike, sample);
+}
+
+void Convolution3D::_start_train_sample(size_t current_pass, size_t current_index)
+{
+	if (current_index != 0)
+	{
+		return;
+	}
+
+	// The training
+	if (current_pass < _epoch_number)
+	{
+		_current_epoch_number = current_pass;
+		_current_width = 1;
+		_current_height = 1;
+		_current_conv_depth = 1;
+		std::cout << "\rEpoch " << current_pass << "/" << _epoch_number;
+
+		on_epoch_start();
+	}
+	else
+	{
+		_current_width = _width;
+		_current_height = _height;
+		_current_conv_depth = _conv_depth;
+		// The weight files of the training are complete before the features are extracted.
+		_snapshot.wait();
+		std::cout << std::endl
+				  << "Process train set" << std::endl;
+	}
+}
+
+void Convolution3D::_start_test_sample(size_t current_index)
+{
+	if (current_index == 0)
+	{
+		std::cout << "Process test set" << std::endl;
+		_current_width = _width;
+		_current_height = _height;
+		_current_conv_depth = _conv_depth;
+	}
+}
+
+// The patch position only depends on (layer, epoch, sample), not on the samples processed before.
+void Convolution3D::_random_patch(size_t current_pass, size_t current_index, size_t &x, size_t &y, size_t &k)
+{
+	Philox random_generator = experiment()->random_stream(index(), current_pass, current_index);
+	// do // take the random patches around places where a spike exists
+	// {
+	if (_filter_width < _width)
+	{
+		std::uniform_int_distribution<size_t> rand_x(0, _width - _filter_width);
+		x = rand_x(random_generator);
+	}
+	if (_filter_height < _height)
+	{
+		std::uniform_int_distribution<size_t> rand_y(0, _height - _filter_height);
+		y = rand_y(random_generator);
+	}
+	if (_filter_conv_depth < _conv_depth)
+	{
+		std::uniform_int_distribution<size_t> rand_y(0, _conv_depth - _filter_conv_depth);
+		k = rand_y(random_generator);
+	}
+}
+
 void Convolution3D::train(const std::string &label, const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike)
 {
-	_impl.train(label, input_spike, input_time, output_spike);
+	if (_current_epoch_number == 0 && _save_random_start && _saved_random_start == 0)
+	{
+		_snapshot.save_weights(_snapshot_directory, _snapshot_name + "_random_start.json", _class_label(label), _w);
+		_saved_random_start = 1;
+	}
+
+	_impl.train(input_spike, input_time, output_spike);
+
+	if (!output_spike.empty() && _current_epoch_number == _epoch_number - 1 && _logged_spiking_neuron == 0 && (_draw || _save_weights || _log_spiking_neuron))
+	{
+		_snapshot_label = _class_label(label);
+		_snapshot_neuron = output_spike.front().z;
+		if (_log_spiking_neuron)
+			_snapshot.log_spiking_neuron(_snapshot_directory, _snapshot_name, _snapshot_label, _snapshot_neuron);
+		_logged_spiking_neuron = 1;
+	}
 }
 
 void Convolution3D::test(const std::string &, const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike)
@@ -218,12 +341,49 @@ void Convolution3D::test(const std::string &, const std::vector<Spike> &input_sp
 	_impl.test(input_spike, input_time, output_spike);
 }
 
+void Convolution3D::on_epoch_start()
+{
+	if (_current_epoch_number == 0 && _snapshot_directory.empty())
+	{
+		std::string index_name = std::to_string(index());
+		_snapshot_directory = _file_path + "/Weights/" + experiment()->name() + "/" + index_name + "/";
+		_snapshot_name = experiment()->name();
+		_label_prefix = experiment()->name() + ";." + index_name + ";.";
+	}
+}
+
 void Convolution3D::on_epoch_end()
 {
+	_impl.flush_depression();
+
+	// The weights are copied when the request is queued, before the annealing of the last epoch.
+	if (_current_epoch_number == _epoch_number - 1 && _logged_spiking_neuron == 1)
+	{
+		if (_draw && _drawn_weights == 0)
+		{
+			_snapshot.draw_weights(_snapshot_directory, _snapshot_name + "_N:" + std::to_string(_snapshot_neuron), _w);
+			_drawn_weights = 1;
+		}
+
+		if (_save_weights && _saved_weights == 0)
+		{
+			_snapshot.save_weights(_snapshot_directory, _snapshot_name + ".json", _snapshot_label, _w);
+			_saved_weights = 1;
+		}
+	}
+
 	_lr_th *= _annealing;
 	_stdp->adapt_parameters(_annealing);
 }
 
+std::string Convolution3D::_class_label(const std::string &label) const
+{
+	// The executions that prefix the label with the experiment name and the layer index.
+	if (label.compare(0, _label_prefix.size(), _label_prefix) == 0)
+		return label.substr(_label_prefix.size());
+	return label;
+}
+
 // This function is not extended because it's only for drawing.
 Tensor<float> Convolution3D::reconstruct(const Tensor<float> &t) const
 {
@@ -325,10 +485,6 @@ void Convolution3D::plot_evolution(bool only_in_train)
 #endif
 
 #ifdef SMID_AVX256
-#include <immintrin.h>
-
-#define AVX_256_N 8
-
 static __m256i _generate_mask(int n)
 {
 
@@ -415,19 +571,7 @@ void _priv::Convolution3DImpl::train(const std::vector<Spike> &input_spike, cons
 				{
 					if (_a.at_index(i * AVX_256_N + j) > th.at_index(i * AVX_256_N + j))
 					{
-						for (size_t z1 = 0; z1 < depth; z1++)
-						{
-							th.at(z1) -= _model._lr_th * (spike.time - _model._t_obj);
-							if (z1 != i * AVX_256_N + j)
-							{
-								th.at(z1) -= _model._lr_th / static_cast<float>(depth - 1);
-							}
-							else
-							{
-								th.at(z1) += _model._lr_th;
-							}
-							th.at(z1) = std::max<float>(_model._min_th, th.at(z1));
-						}
+						adapt_threshold(th, i * AVX_256_N + j, spike.time, _model._t_obj, _model._lr_th, _model._min_th);
 
 						for (size_t x = 0; x < _model._filter_width; x++)
 						{
@@ -457,19 +601,7 @@ void _priv::Convolution3DImpl::train(const std::vector<Spike> &input_spike, cons
 			{
 				if (_a.at_index(n * AVX_256_N + j) > th.at_index(n * AVX_256_N + j))
 				{
-					for (size_t z1 = 0; z1 < depth; z1++)
-					{
-						th.at(z1) -= _model._lr_th * (spike.time - _model._t_obj);
-						if (z1 != n * AVX_256_N + j)
-						{
-							th.at(z1) -= _model._lr_th / static_cast<float>(depth - 1);
-						}
-						else
-						{
-							th.at(z1) += _model._lr_th;
-						}
-						th.at(z1) = std::max<float>(_model._min_th, th.at(z1));
-					}
+					adapt_threshold(th, n * AVX_256_N + j, spike.time, _model._t_obj, _model._lr_th, _model._min_th);
 
 					for (size_t x = 0; x < _model._filter_width; x++)
 					{
@@ -488,6 +620,11 @@ void _priv::Convolution3DImpl::train(const std::vector<Spike> &input_spike, cons
 	}
 }
 
+// The AVX training updates every synapse of the winner directly, nothing is pending.
+void _priv::Convolution3DImpl::flush_depression()
+{
+}
+
 void _priv::Convolution3DImpl::test(const std::vector<Spike> &input_spike, const Tensor<Time> &, std::vector<Spike> &output_spike)
 {
 	size_t depth = _model.depth();
@@ -595,7 +732,8 @@ void _priv::Convolution3DImpl::test(const std::vector<Spike> &input_spike, const
 }
 
 #else
-_priv::Convolution3DImpl::Convolution3DImpl(Convolution3D &model) : _model(model), _a(), _inh()
+_priv::Convolution3DImpl::Convolution3DImpl(Convolution3D &model) : _model(model), _a(), _inh(), _update_count(), _synced_count(),
+																	  _quantized(false), _w8(), _th16(), _a16(), _inh16(), _w16(), _th32(), _a32(), _inh32()
 {
 }
 
@@ -610,13 +748,46 @@ void _priv::Convolution3DImpl::resize()
 	// these values are the total size of the convolutional layer.
 	_a = Tensor<float>(Shape({_model.width(), _model.height(), _model.depth(), _model.conv_depth()}));
 	_inh = Tensor<bool>(Shape({_model.width(), _model.height(), _model.depth(), _model.conv_depth()}));
+
+	_update_count = Tensor<uint32_t>(Shape({_model._filter_number}));
+	_update_count.fill(0);
+	_synced_count = Tensor<uint32_t>(Shape({_model._filter_width, _model._filter_height, _model._input_depth, _model._filter_number, _model._filter_conv_depth}));
+	_synced_count.fill(0);
+}
+
+/**
+ * @brief Returns a synapse weight after applying the depression it missed while its pre-synaptic neuron was silent.
+ * Each update of filter z that did not involve this synapse is the same STDP step with pre = INFINITE_TIME, so they are applied at once with STDP::process_silent.
+ */
+float &_priv::Convolution3DImpl::_synchronized_weight(size_t x, size_t y, size_t zi, size_t z, size_t k)
+{
+	size_t i = _model._w.shape().to_index(x, y, zi, z, k);
+	float &w = _model._w.at_index(i);
+	// A synapse updated by the current STDP step is already one update ahead, as are the repeated spikes of a synapse in the same sample
+	if (_synced_count.at_index(i) < _update_count.at(z))
+	{
+		w = _model._stdp->process_silent(w, _update_count.at(z) - _synced_count.at_index(i));
+		_synced_count.at_index(i) = _update_count.at(z);
+	}
+	return w;
 }
 
-void _priv::Convolution3DImpl::train(const std::string &label, const std::vector<Spike> &input_spike, const Tensor<Time> &input_time,
-									 std::vector<Spike> &output_spike)
+/**
+ * @brief Applies all the pending depression so that _w is up to date, this is done at the end of each epoch, before the learning rate is annealed.
+ */
+void _priv::Convolution3DImpl::flush_depression()
 {
-	this->_label = label;
-	this->train(input_spike, input_time, output_spike);
+	for (size_t x = 0; x < _model._filter_width; x++)
+		for (size_t y = 0; y < _model._filter_height; y++)
+			for (size_t zi = 0; zi < _model._input_depth; zi++)
+				for (size_t z = 0; z < _model._filter_number; z++)
+					for (size_t k = 0; k < _model._filter_conv_depth; k++)
+					{
+						_synchronized_weight(x, y, zi, z, k);
+					}
+
+	_update_count.fill(0);
+	_synced_count.fill(0);
 }
 
 /**
@@ -628,27 +799,12 @@ void _priv::Convolution3DImpl::train(const std::string &label, const std::vector
  * @param output_spike
  */
 
-void _priv::Convolution3DImpl::train(const std::vector<Spike> &input_spike, const Tensor<Time> &input_time, std::vector<Spike> &output_spike)
+void _priv::Convolution3DImpl::train(const std::vector<Spike> &input_spike, const Tensor<Time> &, std::vector<Spike> &output_spike)
 {
-	std::mutex _convolution_train_mutex; // mutex to aviod access violation durring multithreaded section
-	///////////////////////////////
-	std::string delimiter = ";.";
-	std::string _exp_name = _label.substr(0, _label.find(delimiter));
-	_label.erase(0, _exp_name.length() + delimiter.length());
-	std::string _layerIndex = _label.substr(0, _label.find(delimiter));
-	_label.erase(0, _layerIndex.length() + delimiter.length());
-	if (_model._draw || _model._log_spiking_neuron || _model._save_weights || _model._save_random_start)
-		std::filesystem::create_directories(_model._file_path + "/Weights/" + _exp_name + "/" + _layerIndex + "/");
-
-	if (_model._current_epoch_number == 0 && _model._save_random_start && _model._saved_random_start == 0)
-	{
-		SaveWeights(_model._file_path + "/Weights/" + _exp_name + "/" + _layerIndex + "/" + _exp_name + "_random_start.json", _label, _model._w);
-		_model._saved_random_start = 1;
-	}
+	_quantized = false;
 
 	size_t depth = _model.depth();
 	size_t conv_depth = _model.conv_depth();
-	Tensor<float> &w = _model._w;
 	Tensor<float> &th = _model._th;
 
 	std::fill(std::begin(_a), std::end(_a), 0);
@@ -657,54 +813,30 @@ void _priv::Convolution3DImpl::train(const std::vector<Spike> &input_spike, cons
 	{
 		for (size_t z = 0; z < depth; z++) // the number of filters
 		{
-			_a.at(0, 0, z, 0) += w.at(spike.x, spike.y, spike.z, z, spike.k);
+			_a.at(0, 0, z, 0) += _synchronized_weight(spike.x, spike.y, spike.z, z, spike.k);
 
 			// integrate the weight value in the neurons activation (multiple spikes are integrated to surpass the internal threshould of the neuron)
 			if (_a.at(0, 0, z, 0) >= th.at(z)) // a spike is fired
 			{
-				for (size_t z1 = 0; z1 < depth; z1++)
-				{
-					th.at(z1) -= _model._lr_th * (spike.time - _model._t_obj);
+				adapt_threshold(th, z, spike.time, _model._t_obj, _model._lr_th, _model._min_th);
 
-					if (z1 != z)
-						th.at(z1) -= _model._lr_th / static_cast<float>(depth - 1);
-					else
-						th.at(z1) += _model._lr_th;
-
-					th.at(z1) = std::max<float>(_model._min_th, th.at(z1));
+				// Only the synapses that received a spike are updated here. The others all get the depression for pre = INFINITE_TIME,
+				// which is counted in _update_count and applied when the weight is next read or at the end of the epoch.
+				for (const Spike &pre : input_spike)
+				{
+					float &weight = _synchronized_weight(pre.x, pre.y, pre.z, z, pre.k);
+					weight = _model._stdp->process(weight, pre.time, spike.time);
+					_synced_count.at(pre.x, pre.y, pre.z, z, pre.k) = _update_count.at(z) + 1;
 				}
-
-				for (size_t x = 0; x < _model._filter_width; x++)
-					for (size_t y = 0; y < _model._filter_height; y++)
-						for (size_t zi = 0; zi < _model._input_depth; zi++)
-							for (size_t k = 0; k < _model._filter_conv_depth; k++)
-							{
-								w.at(x, y, zi, z, k) = _model._stdp->process(w.at(x, y, zi, z, k), input_time.at(x, y, zi, k), spike.time);
-							}
+				_update_count.at(z)++;
 
 				// /// @brief counting the spikes.
 				// _model._spike_count++;
 				// std::cout << "\r[Spike count: " + std::to_string(_model._spike_count) + "]";
 				// std::cout.flush();
 
-				/// @brief for visualization.
-				if (_model._current_epoch_number == _model._epoch_number - 1 && _model._draw && _model._drawn_weights == 0)
-				{
-					Tensor<float>::draw_weight_tensor(_model._file_path + "/Weights/" + _exp_name + "/" + _layerIndex + "/" + _exp_name + "_N:" + std::to_string(z), w);
-					_model._drawn_weights = 1;
-				}
-
-				if (_model._current_epoch_number == _model._epoch_number - 1 && _model._log_spiking_neuron && _model._logged_spiking_neuron == 0)
-				{
-					LogSpikingNeuron(_model._file_path + "/Weights/" + _exp_name + "/" + _layerIndex + "/" + _exp_name, _label, z);
-					_model._logged_spiking_neuron = 1;
-				}
-
-				if (_model._current_epoch_number == _model._epoch_number - 1 && _model._save_weights && _model._saved_weights == 0)
-				{
-					SaveWeights(_model._file_path + "/Weights/" + _exp_name + "/" + _layerIndex + "/" + _exp_name + ".json", _label, w);
-					_model._saved_weights = 1;
-				}
+				// The winner is reported to the model, which handles the snapshots outside of this loop.
+				output_spike.emplace_back(spike.time, 0, 0, z, 0);
 
 				if (_model._inhibition)
 					return;
@@ -715,9 +847,44 @@ void _priv::Convolution3DImpl::train(const std::vector<Spike> &input_spike, cons
 
 void _priv::Convolution3DImpl::test(const std::vector<Spike> &input_spike, const Tensor<Time> &, std::vector<Spike> &output_spike)
 {
-	size_t depth = _model.depth();
 	_model._sample_count++;
 
+	if (_model._quantization != 0)
+	{
+		if (!_quantized)
+		{
+			if (_model._quantization == 8)
+				_quantize(_w8, _th16, _a16, _inh16, 8);
+			else
+				_quantize(_w16, _th32, _a32, _inh32, 16);
+			_quantized = true;
+		}
+
+		if (_model._quantization == 8)
+			_test_quantized(_w8, _th16, _a16, _inh16, input_spike, output_spike);
+		else
+			_test_quantized(_w16, _th32, _a32, _inh32, input_spike, output_spike);
+	}
+	else
+	{
+		_test_float(input_spike, output_spike);
+	}
+
+	draw_progress(_model._sample_count, _model._sample_number);
+
+	if (_model._sample_count == _model._sample_number)
+	{
+		std::cout << "\r[Spike count: " + std::to_string(_model._spike_count) + "] \n";
+		// experiment()->log()<< << "[Spike count: " << std::to_string(_model._spike_count) << "] \n";
+		_model._sample_count = 0;
+		_model._spike_count = 0;
+	}
+}
+
+void _priv::Convolution3DImpl::_test_float(const std::vector<Spike> &input_spike, std::vector<Spike> &output_spike)
+{
+	size_t depth = _model.depth();
+
 	Tensor<float> &w = _model._w;
 	Tensor<float> &th = _model._th;
 
@@ -770,14 +937,82 @@ void _priv::Convolution3DImpl::test(const std::vector<Spike> &input_spike, const
 		}
 	}
 	//});
-	draw_progress(_model._sample_count, _model._sample_number);
+}
 
-	if (_model._sample_count == _model._sample_number)
+/**
+ * @brief Converts the trained weights and thresholds to fixed point with a per-layer scale.
+ * W is the weight type (int8_t or int16_t) and P the potential type (int16_t or int32_t).
+ */
+template <typename W, typename P>
+void _priv::Convolution3DImpl::_quantize(Tensor<W> &w, Tensor<P> &th, Tensor<P> &a, Tensor<P> &inh, size_t bits)
+{
+	size_t depth = _model.depth();
+	float scale = quantization_scale(_model._w, bits);
+
+	w = Tensor<W>(Shape({_model._filter_width, _model._filter_height, _model._input_depth, _model._filter_conv_depth, depth}));
+	for (size_t x = 0; x < _model._filter_width; x++)
+		for (size_t y = 0; y < _model._filter_height; y++)
+			for (size_t zi = 0; zi < _model._input_depth; zi++)
+				for (size_t k = 0; k < _model._filter_conv_depth; k++)
+					for (size_t z = 0; z < depth; z++)
+					{
+						w.at(x, y, zi, k, z) = quantize_value<W>(_model._w.at(x, y, zi, z, k), scale);
+					}
+
+	th = Tensor<P>(Shape({depth}));
+	for (size_t z = 0; z < depth; z++)
 	{
-		std::cout << "\r[Spike count: " + std::to_string(_model._spike_count) + "] \n";
-		// experiment()->log()<< << "[Spike count: " << std::to_string(_model._spike_count) << "] \n";
-		_model._sample_count = 0;
-		_model._spike_count = 0;
+		th.at(z) = quantize_value<P>(_model._th.at(z), scale);
+	}
+
+	a = Tensor<P>(Shape({_model.width(), _model.height(), _model.conv_depth(), depth}));
+	inh = Tensor<P>(Shape({_model.width(), _model.height(), _model.conv_depth(), depth}));
+}
+
+/**
+ * @brief Same inference as _test_float on fixed point weights, the potentials of all the filters of a neuron are integrated at once.
+ * With inhibition, a neuron that fired is flagged in inh (-1) and integrate ignores it until the next sample.
+ */
+template <typename W, typename P>
+void _priv::Convolution3DImpl::_test_quantized(const Tensor<W> &w, const Tensor<P> &th, Tensor<P> &a, Tensor<P> &inh, const std::vector<Spike> &input_spike, std::vector<Spike> &output_spike)
+{
+	size_t depth = _model.depth();
+
+	a.fill(0);
+	inh.fill(0);
+
+	for (const Spike &spike : input_spike)
+	{
+		std::vector<std::tuple<uint16_t, uint16_t, uint16_t, uint16_t, uint16_t, uint16_t>> output_spikes;
+		_model.forward(spike.x, spike.y, spike.k, output_spikes);
+
+		for (const auto &entry : output_spikes)
+		{
+			uint16_t x = std::get<0>(entry);
+			uint16_t y = std::get<1>(entry);
+			uint16_t k = std::get<2>(entry);
+			uint16_t w_x = std::get<3>(entry);
+			uint16_t w_y = std::get<4>(entry);
+			uint16_t w_k = std::get<5>(entry);
+
+			P *potential = a.ptr(x, y, k, 0);
+			P *inhibited = inh.ptr(x, y, k, 0);
+			if (!integrate(potential, w.ptr(w_x, w_y, spike.z, w_k, 0), th.ptr_index(0), inhibited, depth))
+			{
+				continue;
+			}
+
+			for (size_t z = 0; z < depth; z++)
+			{
+				if (inhibited[z] == 0 && potential[z] >= th.at_index(z))
+				{
+					output_spike.emplace_back(spike.time, x, y, z, k);
+					_model._spike_count++;
+					if (_model._inhibition)
+						inhibited[z] = -1;
+				}
+			}
+		}
 	}
 }
 
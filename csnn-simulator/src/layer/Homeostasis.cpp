@@ -0,0 +1,57 @@
+#include "layer/Homeostasis.h"
+#include "Simd.h"
+
+#ifdef SMID_AVX256
+void layer::adapt_threshold(Tensor<float> &th, size_t winner, Time spike_time, float t_obj, float lr_th, float min_th)
+{
+	size_t depth = th.shape().product();
+	float shift = lr_th * (spike_time - t_obj);
+	float other = depth > 1 ? lr_th / static_cast<float>(depth - 1) : 0.0f;
+
+	size_t n = depth / AVX_256_N;
+
+	__m256 __shift = _mm256_set1_ps(shift);
+	__m256 __win = _mm256_set1_ps(lr_th);
+	__m256 __other = _mm256_set1_ps(-other);
+	__m256 __min = _mm256_set1_ps(min_th);
+	__m256 __winner = _mm256_set1_ps(static_cast<float>(winner));
+	__m256 __lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		__m256 __index = _mm256_add_ps(__lane, _mm256_set1_ps(static_cast<float>(i * AVX_256_N)));
+		__m256 __m = _mm256_cmp_ps(__index, __winner, _CMP_EQ_OQ);
+		__m256 __th = _mm256_loadu_ps(th.ptr_index(i * AVX_256_N));
+		__th = _mm256_sub_ps(__th, __shift);
+		__th = _mm256_add_ps(__th, _mm256_blendv_ps(__other, __win, __m));
+		__th = _mm256_max_ps(__th, __min);
+		_mm256_storeu_ps(th.ptr_index(i * AVX_256_N), __th);
+	}
+
+	for (size_t z = n * AVX_256_N; z < depth; z++)
+	{
+		float v = th.at_index(z) - shift;
+		v += z == winner ? lr_th : -other;
+		th.at_index(z) = std::max<float>(min_th, v);
+	}
+}
+
+#else
+
+void layer::adapt_threshold(Tensor<float> &th, size_t winner, Time spike_time, float t_obj, float lr_th, float min_th)
+{
+	size_t depth = th.shape().product();
+	float shift = lr_th * (spike_time - t_obj);
+	float other = depth > 1 ? lr_th / static_cast<float>(depth - 1) : 0.0f;
+
+	// Branch free body so that the compiler can vectorize it.
+	float *data = th.begin();
+	for (size_t z = 0; z < depth; z++)
+	{
+		float v = data[z] - shift;
+		v += z == winner ? lr_th : -other;
+		data[z] = std::max<float>(min_th, v);
+	}
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "layer/Quantization.h"
+
+float layer::quantization_scale(const Tensor<float> &w, size_t bits)
+{
+	if (bits != 8 && bits != 16)
+	{
+		throw std::runtime_error("Quantization: only 8 and 16 bits are supported");
+	}
+
+	float max = 0.0f;
+	for (float v : w)
+	{
+		max = std::max<float>(max, std::abs(v));
+	}
+
+	float q_max = static_cast<float>((1 << (bits - 1)) - 1);
+	return max > 0.0f ? q_max / max : q_max;
+}
+
+// The quantized inference only runs in the non SMID_AVX256 implementation of Convolution3D, so the kernels are selected on the
+// instruction set enabled by -march=native rather than on SMID_AVX256.
+#ifdef __AVX2__
+#include <immintrin.h>
+
+// 16 filters per instruction, potentials on 16 bits.
+bool layer::integrate(int16_t *a, const int8_t *w, const int16_t *th, const int16_t *inh, size_t n)
+{
+	size_t i = 0;
+	__m256i __fired = _mm256_setzero_si256();
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i __w = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(w + i)));
+		__m256i __a = _mm256_adds_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)), __w);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(a + i), __a);
+		__m256i __th = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(th + i));
+		__m256i __inh = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inh + i));
+		// a >= th and not inhibited <=> !(th > a || inh)
+		__fired = _mm256_or_si256(__fired, _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi16(__th, __a), __inh), _mm256_set1_epi16(-1)));
+	}
+
+	bool fired = _mm256_testz_si256(__fired, __fired) == 0;
+	for (; i < n; i++)
+	{
+		a[i] = static_cast<int16_t>(std::clamp<int32_t>(a[i] + w[i], std::numeric_limits<int16_t>::lowest(), std::numeric_limits<int16_t>::max()));
+		fired |= inh[i] == 0 && a[i] >= th[i];
+	}
+	return fired;
+}
+
+// 8 filters per instruction, potentials on 32 bits.
+bool layer::integrate(int32_t *a, const int16_t *w, const int32_t *th, const int32_t *inh, size_t n)
+{
+	size_t i = 0;
+	__m256i __fired = _mm256_setzero_si256();
+	__m256i __max = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i __w = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(w + i)));
+		__m256i __prev = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i __sum = _mm256_add_epi32(__prev, __w);
+		// There is no saturating 32 bits add: the sum overflowed when both operands have the same sign and the result has another one.
+		// The saturated value is INT32_MAX for a positive operand and INT32_MIN for a negative one.
+		__m256i __overflow = _mm256_srai_epi32(_mm256_andnot_si256(_mm256_xor_si256(__prev, __w), _mm256_xor_si256(__prev, __sum)), 31);
+		__m256i __saturated = _mm256_xor_si256(_mm256_srai_epi32(__prev, 31), __max);
+		__m256i __a = _mm256_blendv_epi8(__sum, __saturated, __overflow);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(a + i), __a);
+		__m256i __th = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(th + i));
+		__m256i __inh = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inh + i));
+		__fired = _mm256_or_si256(__fired, _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(__th, __a), __inh), _mm256_set1_epi32(-1)));
+	}
+
+	bool fired = _mm256_testz_si256(__fired, __fired) == 0;
+	for (; i < n; i++)
+	{
+		a[i] = static_cast<int32_t>(std::clamp<int64_t>(static_cast<int64_t>(a[i]) + w[i], std::numeric_limits<int32_t>::lowest(), std::numeric_limits<int32_t>::max()));
+		fired |= inh[i] == 0 && a[i] >= th[i];
+	}
+	return fired;
+}
+
+#else
+
+// Plain loops, the sums are computed on a wider type and clamped to saturate.
+bool layer::integrate(int16_t *a, const int8_t *w, const int16_t *th, const int16_t *inh, size_t n)
+{
+	bool fired = false;
+	for (size_t i = 0; i < n; i++)
+	{
+		a[i] = static_cast<int16_t>(std::clamp<int32_t>(a[i] + w[i], std::numeric_limits<int16_t>::lowest(), std::numeric_limits<int16_t>::max()));
+		fired |= inh[i] == 0 && a[i] >= th[i];
+	}
+	return fired;
+}
+
+bool layer::integrate(int32_t *a, const int16_t *w, const int32_t *th, const int32_t *inh, size_t n)
+{
+	bool fired = false;
+	for (size_t i = 0; i < n; i++)
+	{
+		a[i] = static_cast<int32_t>(std::clamp<int64_t>(static_cast<int64_t>(a[i]) + w[i], std::numeric_limits<int32_t>::lowest(), std::numeric_limits<int32_t>::max()));
+		fired |= inh[i] == 0 && a[i] >= th[i];
+	}
+	return fired;
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "process/AddSaltPepperNoise.h"
+#include "Experiment.h"
 
 using namespace process;
 
@@ -31,14 +32,26 @@ AddSaltPepperNoise::AddSaltPepperNoise(std::string expName, size_t salt_scalar,
 	_file_path = std::filesystem::current_path();
 }
 
+void AddSaltPepperNoise::process_train_sample(const std::string &label, Tensor<float> &sample, size_t current_pass, size_t current_index, size_t)
+{
+	Philox random_generator = experiment()->random_stream(index(), current_pass, current_index);
+	_process(label, sample, random_generator);
+}
+
+void AddSaltPepperNoise::process_test_sample(const std::string &label, Tensor<float> &sample, size_t current_index, size_t)
+{
+	Philox random_generator = experiment()->random_stream(index(), PHILOX_TEST_EPOCH, current_index);
+	_process(label, sample, random_generator);
+}
+
 void AddSaltPepperNoise::process_train(const std::string &label, Tensor<float> &sample)
 {
-	_process(label, sample);
+	process_train_sample(label, sample, 0, 0, 0);
 }
 
 void AddSaltPepperNoise::process_test(const std::string &label, Tensor<float> &sample)
 {
-	_process(label, sample);
+	process_test_sample(label, sample, 0, 0);
 }
 
 Shape AddSaltPepperNoise::compute_shape(const Shape &shape)
@@ -50,7 +63,7 @@ Shape AddSaltPepperNoise::compute_shape(const Shape &shape)
 	return Shape({_height, _width, _depth, _conv_depth});
 }
 
-void AddSaltPepperNoise::_process(const std::string &label, Tensor<InputType> &in) const
+void AddSaltPepperNoise::_process(const std::string &label, Tensor<InputType> &in, Philox &random_generator) const
 {
 	Tensor<InputType> out(Shape({_height, _width, _depth, _conv_depth}));
 
@@ -62,11 +75,20 @@ void AddSaltPepperNoise::_process(const std::string &label, Tensor<InputType> &i
 
 	for (cv::Mat &_frame : _frames)
 	{
-		for (int counter = 0; counter < _pepper_scalar; ++counter)
-			_frame.at<float>(rand() % _frame.rows, rand() % _frame.cols) = 0;
-
-		for (int counter = 0; counter < _salt_scalar; ++counter)
-			_frame.at<float>(rand() % _frame.rows, rand() % _frame.cols) = 255;
+		std::uniform_int_distribution<int> rand_row(0, _frame.rows - 1);
+		std::uniform_int_distribution<int> rand_col(0, _frame.cols - 1);
+
+		for (size_t counter = 0; counter < _pepper_scalar; ++counter)
+		{
+			int row = rand_row(random_generator);
+			_frame.at<float>(row, rand_col(random_generator)) = 0;
+		}
+
+		for (size_t counter = 0; counter < _salt_scalar; ++counter)
+		{
+			int row = rand_row(random_generator);
+			_frame.at<float>(row, rand_col(random_generator)) = 255;
+		}
 
 		_out_frames.push_back(_frame);
 	}
@@ -0,0 +1,142 @@
+#include "process/InputStage.h"
+#include <algorithm>
+
+#include "Simd.h"
+
+using namespace process;
+
+//
+//	InputStage
+//
+
+static RegisterClassParameter<InputStage, ProcessFactory> _register("InputStage");
+
+InputStage::InputStage() : UniquePassProcess(_register), _coding(INPUT_STAGE_LATENCY_CODING), _max_value(0), _threshold(0), _max_timestamp(0)
+{
+	add_parameter("coding", _coding);
+	add_parameter("max_value", _max_value);
+	add_parameter("threshold", _threshold);
+	add_parameter("max_timestamp", _max_timestamp);
+}
+
+InputStage::InputStage(size_t coding, float max_value, float threshold, float max_timestamp) : InputStage()
+{
+	parameter<size_t>("coding").set(coding);
+	parameter<float>("max_value").set(max_value);
+	parameter<float>("threshold").set(threshold);
+	parameter<float>("max_timestamp").set(max_timestamp);
+}
+
+Shape InputStage::compute_shape(const Shape &shape)
+{
+	if (_coding > INPUT_STAGE_RANK_ORDER_CODING)
+	{
+		throw std::runtime_error("InputStage: unknown coding " + std::to_string(_coding));
+	}
+
+	if (_max_value <= 0)
+	{
+		throw std::runtime_error("InputStage: max_value must be positive");
+	}
+
+	return shape;
+}
+
+void InputStage::process_train(const std::string &, Tensor<float> &sample)
+{
+	_process(sample);
+}
+
+void InputStage::process_test(const std::string &, Tensor<float> &sample)
+{
+	_process(sample);
+}
+
+void InputStage::_process(Tensor<float> &in) const
+{
+	size_t size = in.shape().product();
+
+	if (_coding == INPUT_STAGE_SCALING)
+	{
+		_scale(in.begin(), size);
+	}
+	else if (_coding == INPUT_STAGE_LATENCY_CODING)
+	{
+		_latency_coding(in.begin(), size);
+	}
+	else
+	{
+		_rank_order_coding(in.begin(), size);
+	}
+}
+
+void InputStage::_scale(float *data, size_t size) const
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	__m256 __max_value = _mm256_set1_ps(_max_value);
+	for (; i + AVX_256_N <= size; i += AVX_256_N)
+	{
+		_mm256_storeu_ps(data + i, _mm256_div_ps(_mm256_loadu_ps(data + i), __max_value));
+	}
+#endif
+	for (; i < size; i++)
+	{
+		data[i] = data[i] / _max_value;
+	}
+}
+
+void InputStage::_latency_coding(float *data, size_t size) const
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	__m256 __max_value = _mm256_set1_ps(_max_value);
+	__m256 __threshold = _mm256_set1_ps(_threshold);
+	__m256 __max_timestamp = _mm256_set1_ps(_max_timestamp > 0 ? _max_timestamp : INFINITE_TIME);
+	__m256 __zero = _mm256_setzero_ps();
+	__m256 __one = _mm256_set1_ps(1.0f);
+	__m256 __infinite = _mm256_set1_ps(INFINITE_TIME);
+	for (; i + AVX_256_N <= size; i += AVX_256_N)
+	{
+		__m256 __v = _mm256_div_ps(_mm256_loadu_ps(data + i), __max_value);
+		__m256 __ts = _mm256_max_ps(__zero, _mm256_sub_ps(__one, __v));
+		__m256 __silent = _mm256_or_ps(_mm256_cmp_ps(__v, __threshold, _CMP_LT_OQ),
+									   _mm256_or_ps(_mm256_cmp_ps(__ts, __one, _CMP_EQ_OQ), _mm256_cmp_ps(__ts, __max_timestamp, _CMP_GT_OQ)));
+		_mm256_storeu_ps(data + i, _mm256_blendv_ps(__ts, __infinite, __silent));
+	}
+#endif
+	for (; i < size; i++)
+	{
+		float v = data[i] / _max_value;
+		Time ts = std::max<Time>(0.0f, 1.0f - v);
+		data[i] = v < _threshold || ts == 1.0f || (ts > _max_timestamp && _max_timestamp > 0) ? INFINITE_TIME : ts;
+	}
+}
+
+void InputStage::_rank_order_coding(float *data, size_t size) const
+{
+	// The ranking is the sort of RankOrderCoding, only over the values that reach the threshold.
+	std::vector<std::pair<size_t, float>> list;
+	list.reserve(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		float v = data[i] / _max_value;
+		if (v < _threshold)
+		{
+			data[i] = INFINITE_TIME;
+		}
+		else
+		{
+			list.emplace_back(i, v);
+		}
+	}
+
+	std::sort(std::begin(list), std::end(list), [](const auto &e1, const auto &e2)
+			  { return e1.second > e2.second; });
+
+	Time last = list.size() > 1 ? static_cast<Time>(list.size() - 1) : 1.0f;
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		data[list[i].first] = static_cast<Time>(i) / last;
+	}
+}
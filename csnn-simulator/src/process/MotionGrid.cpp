@@ -1,4 +1,8 @@
 #include "process/MotionGrid.h"
+#include <string_view>
+
+#include "DiskCache.h"
+#include "Simd.h"
 
 using namespace process;
 
@@ -8,13 +12,161 @@ using namespace process;
 #include <opencv2/videoio.hpp>
 #include <opencv2/video.hpp>
 
+//
+//	MotionGridHelper
+//
+
+void _priv::MotionGridHelper::tensor_to_frames(const Tensor<float> &in, std::vector<cv::Mat> &frames)
+{
+	Tensor<float>::tensor_to_matrices(frames, in);
+}
+
+/**
+ * @brief Cache file layout: key length (uint32), key, values (float, two per pixel).
+ * The key is checked when the file is read, so a hash collision on the file name is a cache miss.
+ */
+void _priv::MotionGridHelper::optical_flow(const cv::Mat &previous, const cv::Mat &next, cv::Mat &flow, const std::string &cache_directory, size_t cache_size)
+{
+	bool cache = !cache_directory.empty();
+	flow.create(previous.rows, previous.cols, CV_32FC2);
+	size_t flow_size = previous.rows * previous.cols * 2;
+
+	std::string key;
+	std::string filename;
+	if (cache)
+	{
+		size_t frame_size = previous.rows * previous.cols * sizeof(float);
+		std::stringstream stream;
+		stream << "farneback;0.5;3;15;3;5;1.2;0;" << previous.cols << "x" << previous.rows
+			   << ";" << std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char *>(previous.ptr<float>(0)), frame_size))
+			   << ";" << std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char *>(next.ptr<float>(0)), frame_size));
+		key = stream.str();
+		filename = cache_directory + "/" + std::to_string(std::hash<std::string>()(key));
+
+		std::ifstream file(filename, std::ios::in | std::ios::binary);
+		uint32_t key_length = 0;
+		if (file.is_open() && file.read(reinterpret_cast<char *>(&key_length), sizeof(uint32_t)) && key_length == key.size())
+		{
+			std::string file_key(key_length, '\0');
+			file.read(&file_key[0], key_length);
+			if (file_key == key && file.read(reinterpret_cast<char *>(flow.ptr<float>(0)), flow_size * sizeof(float)))
+				return;
+		}
+	}
+
+	cv::calcOpticalFlowFarneback(previous, next, flow, 0.5, 3, 15, 3, 5, 1.2, 0);
+
+	if (cache && reserve_disk_cache(cache_directory, sizeof(uint32_t) + key.size() + flow_size * sizeof(float), cache_size))
+	{
+		// Written in a temporary file then renamed, so that a reader never sees a partial file.
+		std::error_code error;
+		std::filesystem::create_directories(cache_directory, error);
+
+		std::stringstream temporary;
+		temporary << filename << "." << std::this_thread::get_id() << ".tmp";
+
+		{
+			std::ofstream file(temporary.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return;
+
+			uint32_t key_length = key.size();
+			file.write(reinterpret_cast<const char *>(&key_length), sizeof(uint32_t));
+			file.write(key.data(), key_length);
+			file.write(reinterpret_cast<const char *>(flow.ptr<float>(0)), flow_size * sizeof(float));
+		}
+
+		std::filesystem::rename(temporary.str(), filename, error);
+		if (error)
+			std::filesystem::remove(temporary.str(), error);
+	}
+}
+
+void _priv::MotionGridHelper::split_velocity(const float *v, float *negative, float *positive, size_t size, float gain, float threshold)
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	__m256 __gain = _mm256_set1_ps(gain);
+	__m256 __threshold = _mm256_set1_ps(threshold);
+	__m256 __min = _mm256_set1_ps(-255.0f);
+	__m256 __max = _mm256_set1_ps(255.0f);
+	__m256 __sign = _mm256_set1_ps(-0.0f);
+	for (; i + AVX_256_N <= size; i += AVX_256_N)
+	{
+		__m256 __a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(__gain, _mm256_loadu_ps(v + i)), __min), __max);
+		__m256 __truncated = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(__a));
+		_mm256_storeu_ps(positive + i, _mm256_and_ps(_mm256_cmp_ps(__a, __threshold, _CMP_GE_OQ), __truncated));
+		_mm256_storeu_ps(negative + i, _mm256_and_ps(_mm256_cmp_ps(__a, __threshold, _CMP_LT_OQ), _mm256_andnot_ps(__sign, __truncated)));
+	}
+#endif
+	for (; i < size; i++)
+	{
+		float a = gain * v[i];
+		if (a > 255)
+			a = 255;
+		if (a < -255)
+			a = -255;
+
+		positive[i] = a >= threshold ? static_cast<float>(static_cast<int>(a)) : 0.0f;
+		negative[i] = a < threshold ? static_cast<float>(static_cast<int>(std::abs(a))) : 0.0f;
+	}
+}
+
+void _priv::MotionGridHelper::split_direction(const float *v, float *negative, float *positive, size_t size, float scaler)
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	__m256 __scaler = _mm256_set1_ps(scaler);
+	__m256 __two = _mm256_set1_ps(2.0f);
+	__m256 __max = _mm256_set1_ps(255.0f);
+	__m256 __sign = _mm256_set1_ps(-0.0f);
+	for (; i + AVX_256_N <= size; i += AVX_256_N)
+	{
+		__m256 __v = _mm256_loadu_ps(v + i);
+		__m256 __abs = _mm256_andnot_ps(__sign, __v);
+		__m256 __n = _mm256_min_ps(_mm256_div_ps(_mm256_mul_ps(__scaler, _mm256_sub_ps(__abs, __v)), __two), __max);
+		__m256 __p = _mm256_min_ps(_mm256_div_ps(_mm256_mul_ps(__scaler, _mm256_add_ps(__abs, __v)), __two), __max);
+		_mm256_storeu_ps(negative + i, _mm256_cvtepi32_ps(_mm256_cvttps_epi32(__n)));
+		_mm256_storeu_ps(positive + i, _mm256_cvtepi32_ps(_mm256_cvttps_epi32(__p)));
+	}
+#endif
+	for (; i < size; i++)
+	{
+		float n = scaler * (std::abs(v[i]) - v[i]) / 2;
+		float p = scaler * (std::abs(v[i]) + v[i]) / 2;
+		if (n > 255)
+			n = 255;
+		if (p > 255)
+			p = 255;
+
+		negative[i] = static_cast<float>(static_cast<int>(n));
+		positive[i] = static_cast<float>(static_cast<int>(p));
+	}
+}
+
+void _priv::MotionGridHelper::grid_to_tensor(const cv::Mat &grid, const cv::Size &size, Tensor<float> &out)
+{
+	cv::Mat resized;
+	if (size.width != 0 || size.height != 0)
+		cv::resize(grid, resized, size);
+	const cv::Mat &frame = resized.empty() ? grid : resized;
+
+	size_t height = frame.rows;
+	size_t width = frame.cols;
+	out = Tensor<float>(Shape({height, width, 1, 1}));
+	for (size_t i = 0; i < height; i++)
+	{
+		std::copy(frame.ptr<float>(i), frame.ptr<float>(i) + width, out.begin() + i * width);
+	}
+}
+
 //
 //	MotionGrid
 //
 static RegisterClassParameter<MotionGrid, ProcessFactory> _register_1("MotionGrid");
 
 MotionGrid::MotionGrid() : UniquePassProcess(_register_1), _expName(""), _draw(0), _frames_width(0), _frames_height(0),
-						   _mg_vertical_frames(0), _mg_horizontal_frames(0), _scaler(0), _frames_total(0), _width(0), _height(0), _depth(0), _conv_depth(0)
+						   _mg_vertical_frames(0), _mg_horizontal_frames(0), _scaler(0), _frames_total(0), _width(0), _height(0), _depth(0), _conv_depth(0), _cache_directory(), _cache_size(MOTION_GRID_CACHE_SIZE)
 {
 	add_parameter("draw", _draw);
 	add_parameter("frames_total", _frames_total);
@@ -50,6 +202,12 @@ MotionGrid::MotionGrid(std::string expName, size_t draw, size_t frames_width, si
 	}
 }
 
+void MotionGrid::set_cache(bool cache, const std::string &directory, size_t size)
+{
+	_cache_directory = cache ? directory : "";
+	_cache_size = size;
+}
+
 void MotionGrid::process_train(const std::string &label, Tensor<float> &sample)
 {
 	_process(label, sample);
@@ -87,119 +245,44 @@ void MotionGrid::_process(const std::string &label, Tensor<InputType> &in) const
 	std::vector<cv::Mat> _frames;
 
 	// This function returns a list of frames that have gone through background subtraction.
-	Tensor<float>::tensor_to_matrices(_frames, in);
+	_priv::MotionGridHelper::tensor_to_frames(in, _frames);
 
-	int imagerow = 0;
-	int imagecolumn = 0;
-	float SCALER = _scaler;
+	// Each frame pair fills a cell of four frames (Vx-, Vx+, Vy-, Vy+), the frames after the last cell are not used.
+	size_t cell_columns = _mg_horizontal_frames / 4;
+	size_t pair_number = std::min(_frames.size() > 0 ? _frames.size() - 1 : 0, _mg_vertical_frames * cell_columns);
 
-	int VERTICAL_FRAMES = _mg_vertical_frames;
-	int HORIZONTAL_FRAMES = _mg_horizontal_frames;
-	int maxImagecolumn = ((HORIZONTAL_FRAMES / 4) - 1);
-	int maxImagerow = VERTICAL_FRAMES - 1;
+	cv::Mat totalframe = cv::Mat::zeros(_height * _mg_vertical_frames, _width * _mg_horizontal_frames, CV_32FC1);
 
-	Tensor<InputType> out(Shape({_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, _depth, 1})); //, _conv_depth / _frames_total}));
-	cv::Size _frame_size(_width, _height);
-	cv::Size _frame_size2(_frames_width, _frames_height);
+	// The negative velocities were compared to -_scaler / 2 computed on the unsigned scaler, which is always true,
+	// so every velocity below _scaler / 2 goes in Vx- or Vy-.
+	float gain = _scaler;
+	float threshold = _scaler / 2;
 
-	cv::Mat totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
-	cv::Mat reducedtotalframe = cv::Mat::zeros(_frames_height, _frames_width, CV_32FC1);
-
-	for (int _i = 0; _i < _frames.size() - 1; _i++)
+	auto compute_pairs = [&](size_t, size_t begin, size_t end)
 	{
-		cv::Mat flow(_frame_size, CV_32FC1);
-
-		cv::calcOpticalFlowFarneback(_frames[_i], _frames[_i + 1], flow, 0.5, 3, 15, 3, 5, 1.2, 0);
-
-		// TODO: change uint8_t to float. and remove the variation limit.
-		// visualization
+		// Allocated by the first frame pair of the thread, reused by the next ones
+		cv::Mat flow;
 		cv::Mat flow_parts[2];
-		split(flow, flow_parts);
-
-		cv::Mat Vxplus(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat Vxminus(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat Vyplus(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat Vyminus(_frame_size, CV_8UC1, cv::Scalar(0));
-
-		for (int y = 0; y < _frame_size.height; y++)
-			for (int x = 0; x < _frame_size.width; x++)
-			{
-				float a = _scaler * flow_parts[0].at<float>(y, x); //_scaler * (std::abs(flow_parts[0].at<float>(y, x)) - flow_parts[0].at<float>(y, x)) / 2;
-				float b = _scaler * flow_parts[1].at<float>(y, x); //_scaler * (std::abs(flow_parts[1].at<float>(y, x)) - flow_parts[1].at<float>(y, x)) / 2;
-				
-				if (a > 255)
-					a = 255;
-				if (a < -255)
-					a = -255;
-
-				if (b > 255)
-					b = 255;
-				if (b < -255)
-					b = -255;
-
-				if (a >= _scaler / 2)
-				{
-					Vxplus.at<uint8_t>(y, x) = (uint8_t)(a);
-					Vxminus.at<uint8_t>(y, x) = 0;
-				}
-				else if (a <= -_scaler / 2)
-				{
-					Vxminus.at<uint8_t>(y, x) = (uint8_t)(std::abs(a));
-					Vxplus.at<uint8_t>(y, x) = 0;
-				}
-
-				if (b >= _scaler / 2)
-				{
-					Vyplus.at<uint8_t>(y, x) = (uint8_t)(b);
-					Vyminus.at<uint8_t>(y, x) = 0;
-				}
-				else if (b <= -_scaler / 2)
-				{
-					Vyminus.at<uint8_t>(y, x) = (uint8_t)(std::abs(b));
-					Vyplus.at<uint8_t>(y, x) = 0;
-				}
-			}
-
-		// imwrite("/home/melassal/Workspace/CSNN/csnn-simulator-build/Input_frames/test/Vxminus.png", Vxminus);
-		// imwrite("/home/melassal/Workspace/CSNN/csnn-simulator-build/Input_frames/test/Vxplus.png", Vxplus);
-		// imwrite("/home/melassal/Workspace/CSNN/csnn-simulator-build/Input_frames/test/Vyminus.png", Vyminus);
-		// imwrite("/home/melassal/Workspace/CSNN/csnn-simulator-build/Input_frames/test/Vyplus.png", Vyplus);
-
-		for (int i = 0; i < _width; i++)
-			for (int j = 0; j < _height; j++)
-			{
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn) * _width + i) = Vxminus.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 1) * _width + i) = Vxplus.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 2) * _width + i) = Vyminus.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 3) * _width + i) = Vyplus.at<uint8_t>(j, i);
-			}
-
-		imagecolumn = imagecolumn + 1;
-		if (imagecolumn > maxImagecolumn)
+		for (size_t i = begin; i < end; i++)
 		{
-			imagecolumn = 0;
-			imagerow = imagerow + 1;
-		}
-
-		if (imagerow > maxImagerow)
-		{
-			imagerow = 0;
+			_priv::MotionGridHelper::optical_flow(_frames[i], _frames[i + 1], flow, _cache_directory, _cache_size);
+			cv::split(flow, flow_parts);
 
-			if (_frames_width != 0 || _frames_height != 0)
+			size_t row = i / cell_columns;
+			size_t column = 4 * (i % cell_columns);
+			for (size_t y = 0; y < _height; y++)
 			{
-				cv::resize(totalframe, reducedtotalframe, _frame_size2);
-				Tensor<float>::matrix_to_tensor(reducedtotalframe, out);
+				_priv::MotionGridHelper::split_velocity(flow_parts[0].ptr<float>(y), _priv::MotionGridHelper::grid_row(totalframe, row, column, y, _height, _width),
+														_priv::MotionGridHelper::grid_row(totalframe, row, column + 1, y, _height, _width), _width, gain, threshold);
+				_priv::MotionGridHelper::split_velocity(flow_parts[1].ptr<float>(y), _priv::MotionGridHelper::grid_row(totalframe, row, column + 2, y, _height, _width),
+														_priv::MotionGridHelper::grid_row(totalframe, row, column + 3, y, _height, _width), _width, gain, threshold);
 			}
-			else
-				Tensor<float>::matrix_to_tensor(totalframe, out);
-
-			if (_draw == 1)
-				Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", out);
+		}
+	};
+	parallel_range(pair_number, 1, compute_pairs);
 
-			totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
+	_priv::MotionGridHelper::grid_to_tensor(totalframe, cv::Size(_frames_width, _frames_height), in);
 
-			break;
-		}
-	}
-	in = out;
-}
\ No newline at end of file
+	if (_draw == 1)
+		Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", in);
+}
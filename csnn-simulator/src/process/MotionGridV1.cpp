@@ -14,7 +14,7 @@ using namespace process;
 static RegisterClassParameter<MotionGridV1, ProcessFactory> _register_1("MotionGridV1");
 
 MotionGridV1::MotionGridV1() : UniquePassProcess(_register_1), _expName(""), _draw(0), _frames_width(0), _frames_height(0),
-							   _mg_vertical_frames(0), _mg_horizontal_frames(0), _scaler(0), _frames_total(0), _width(0), _height(0), _depth(0), _conv_depth(0)
+							   _mg_vertical_frames(0), _mg_horizontal_frames(0), _scaler(0), _frames_total(0), _width(0), _height(0), _depth(0), _conv_depth(0), _cache_directory(), _cache_size(MOTION_GRID_CACHE_SIZE)
 {
 	add_parameter("draw", _draw);
 	add_parameter("frames_total", _frames_total);
@@ -50,6 +50,12 @@ MotionGridV1::MotionGridV1(std::string expName, size_t draw, size_t frames_width
 	}
 }
 
+void MotionGridV1::set_cache(bool cache, const std::string &directory, size_t size)
+{
+	_cache_directory = cache ? directory : "";
+	_cache_size = size;
+}
+
 void MotionGridV1::process_train(const std::string &label, Tensor<float> &sample)
 {
 	_process(label, sample);
@@ -87,98 +93,39 @@ void MotionGridV1::_process(const std::string &label, Tensor<InputType> &in) con
 	std::vector<cv::Mat> _frames;
 
 	// This function returns a list of frames that have gone through background subtraction.
-	Tensor<float>::tensor_to_matrices(_frames, in);
+	_priv::MotionGridHelper::tensor_to_frames(in, _frames);
 
-	int imagerow = 0;
-	int imagecolumn = 0;
-	float SCALER = _scaler;
+	// Each frame pair fills a cell of four frames (up, down, left, right), the frames after the last cell are not used.
+	size_t cell_columns = _mg_horizontal_frames / 4;
+	size_t pair_number = std::min(_frames.size() > 0 ? _frames.size() - 1 : 0, _mg_vertical_frames * cell_columns);
 
-	int VERTICAL_FRAMES = _mg_vertical_frames;
-	int HORIZONTAL_FRAMES = _mg_horizontal_frames;
-	int maxImagecolumn = ((HORIZONTAL_FRAMES / 4) - 1);
-	int maxImagerow = VERTICAL_FRAMES - 1;
+	cv::Mat totalframe = cv::Mat::zeros(_height * _mg_vertical_frames, _width * _mg_horizontal_frames, CV_32FC1);
 
-	Tensor<InputType> out(Shape({_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, _depth, 1})); //, _conv_depth / _frames_total}));
-	cv::Size _frame_size(_width, _height);
-	cv::Size _frame_size2(_frames_width, _frames_height);
-
-	cv::Mat totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
-	cv::Mat reducedtotalframe = cv::Mat::zeros(_frames_height, _frames_width, CV_32FC1);
-
-	for (int _i = 0; _i < _frames.size() - 1; _i++)
+	auto compute_pairs = [&](size_t, size_t begin, size_t end)
 	{
-		cv::Mat flow(_frame_size, CV_32FC1);
-
-		cv::calcOpticalFlowFarneback(_frames[_i], _frames[_i + 1], flow, 0.5, 3, 15, 3, 5, 1.2, 0);
-
-		// TODO: change uint8_t to float. and remove the variation limit.
-		// visualization
+		// Allocated by the first frame pair of the thread, reused by the next ones
+		cv::Mat flow;
 		cv::Mat flow_parts[2];
-		split(flow, flow_parts);
-
-		cv::Mat upframe(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat downframe(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat leftframe(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat rightframe(_frame_size, CV_8UC1, cv::Scalar(0));
-
-		for (int y = 0; y < _frame_size.height; y++)
-			for (int x = 0; x < _frame_size.width; x++)
-			{
-				float upframefloat = _scaler * (std::abs(flow_parts[1].at<float>(y, x)) - flow_parts[1].at<float>(y, x)) / 2;
-				float downframefloat = _scaler * (std::abs(flow_parts[1].at<float>(y, x)) + flow_parts[1].at<float>(y, x)) / 2;
-				float leftframefloat = _scaler * (std::abs(flow_parts[0].at<float>(y, x)) - flow_parts[0].at<float>(y, x)) / 2;
-				float rightframefloat = _scaler * (std::abs(flow_parts[0].at<float>(y, x)) + flow_parts[0].at<float>(y, x)) / 2;
-
-				if (upframefloat > 255)
-					upframefloat = 255;
-				if (downframefloat > 255)
-					downframefloat = 255;
-				if (leftframefloat > 255)
-					leftframefloat = 255;
-				if (rightframefloat > 255)
-					rightframefloat = 255;
-
-				upframe.at<uint8_t>(y, x) = (uint8_t)(upframefloat);
-				downframe.at<uint8_t>(y, x) = (uint8_t)(downframefloat);
-				leftframe.at<uint8_t>(y, x) = (uint8_t)(leftframefloat);
-				rightframe.at<uint8_t>(y, x) = (uint8_t)(rightframefloat);
-			}
-
-		for (int i = 0; i < _width; i++)
-			for (int j = 0; j < _height; j++)
-			{
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn) * _width + i) = upframe.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 1) * _width + i) = downframe.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 2) * _width + i) = leftframe.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 3) * _width + i) = rightframe.at<uint8_t>(j, i);
-			}
-
-		imagecolumn = imagecolumn + 1;
-		if (imagecolumn > maxImagecolumn)
+		for (size_t i = begin; i < end; i++)
 		{
-			imagecolumn = 0;
-			imagerow = imagerow + 1;
-		}
+			_priv::MotionGridHelper::optical_flow(_frames[i], _frames[i + 1], flow, _cache_directory, _cache_size);
+			cv::split(flow, flow_parts);
 
-		if (imagerow > maxImagerow)
-		{
-			imagerow = 0;
-
-			if (_frames_width != 0 || _frames_height != 0)
+			size_t row = i / cell_columns;
+			size_t column = 4 * (i % cell_columns);
+			for (size_t y = 0; y < _height; y++)
 			{
-				cv::resize(totalframe, reducedtotalframe, _frame_size2);
-				Tensor<float>::matrix_to_tensor(reducedtotalframe, out);
+				_priv::MotionGridHelper::split_direction(flow_parts[1].ptr<float>(y), _priv::MotionGridHelper::grid_row(totalframe, row, column, y, _height, _width),
+														 _priv::MotionGridHelper::grid_row(totalframe, row, column + 1, y, _height, _width), _width, _scaler);
+				_priv::MotionGridHelper::split_direction(flow_parts[0].ptr<float>(y), _priv::MotionGridHelper::grid_row(totalframe, row, column + 2, y, _height, _width),
+														 _priv::MotionGridHelper::grid_row(totalframe, row, column + 3, y, _height, _width), _width, _scaler);
 			}
-			else
-				Tensor<float>::matrix_to_tensor(totalframe, out);
-
-			if (_draw == 1)
-				Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", out);
+		}
+	};
+	parallel_range(pair_number, 1, compute_pairs);
 
-			totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
+	_priv::MotionGridHelper::grid_to_tensor(totalframe, cv::Size(_frames_width, _frames_height), in);
 
-			break;
-		}
-	}
-	in = out;
+	if (_draw == 1)
+		Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", in);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "process/MotionGridV3.h"
+#include "process/MotionGrid.h"
 
 using namespace process;
 
@@ -83,91 +84,39 @@ void MotionGridV3::_process(const std::string &label, Tensor<InputType> &in) con
 	std::string _layerIndex = _label.substr(0, _label.find(delimiter));
 	_label.erase(0, _layerIndex.length() + delimiter.length());
 	//////////////////////////////
-
 	std::string _file_path = std::filesystem::current_path();
 	std::vector<cv::Mat> _frames;
 
 	// This function returns a list of frames that have gone through background subtraction.
-	Tensor<float>::tensor_to_matrices(_frames, in);
-
-	int imagerow = 0;
-	int imagecolumn = 0;
-	float SCALER = _scaler;
-
-	int VERTICAL_FRAMES = _mg_vertical_frames;
-	int HORIZONTAL_FRAMES = _mg_horizontal_frames;
-	int maxImagecolumn = ((HORIZONTAL_FRAMES / 2) - 1);
-	int maxImagerow = VERTICAL_FRAMES - 1;
+	_priv::MotionGridHelper::tensor_to_frames(in, _frames);
 
-	Tensor<InputType> out(Shape({_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, _depth, 1})); //, _conv_depth / _frames_total}));
-	cv::Size _frame_size(_width, _height);
-	cv::Size _frame_size2(_frames_width, _frames_height);
+	// Each frame pair fills a cell of two frames (negative and positive difference), the frames after the last cell are not used.
+	size_t cell_columns = _mg_horizontal_frames / 2;
+	size_t pair_number = std::min(_frames.size() > 0 ? _frames.size() - 1 : 0, _mg_vertical_frames * cell_columns);
 
-	cv::Mat totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
-	cv::Mat reducedtotalframe = cv::Mat::zeros(_frames_height, _frames_width, CV_32FC1);
+	cv::Mat totalframe = cv::Mat::zeros(_height * _mg_vertical_frames, _width * _mg_horizontal_frames, CV_32FC1);
 
-	for (int _i = 0; _i < _frames.size() - 1; _i++)
+	auto compute_pairs = [&](size_t, size_t begin, size_t end)
 	{
-		cv::Mat _frame_diff, _frame_diff_2;
-
-		_frame_diff = _frames[_i] - _frames[_i + 1];
-
-		// _frame_diff.convertTo(_frame_diff, CV_32S, 100, 0.5);
-
-		cv::Mat Vxplus(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat Vxminus(_frame_size, CV_8UC1, cv::Scalar(0));
-
-		for (int y = 0; y < _frame_size.height; y++)
-			for (int x = 0; x < _frame_size.width; x++)
-			{
-
-				float a = _frame_diff.at<float>(y, x);
-
-				if (a >= 0) //_scaler / 2)
-				{
-					Vxplus.at<uint8_t>(y, x) = (uint8_t)(a);
-					Vxminus.at<uint8_t>(y, x) = 0;
-				}
-				else if (a < 0) //= -_scaler / 2)
-				{
-					Vxminus.at<uint8_t>(y, x) = (uint8_t)(std::abs(a));
-					Vxplus.at<uint8_t>(y, x) = 0;
-				}
-			}
-
-		for (int i = 0; i < _width; i++)
-			for (int j = 0; j < _height; j++)
-			{
-				totalframe.at<float>(imagerow * _height + j, (2 * imagecolumn) * _width + i) = Vxminus.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (2 * imagecolumn + 1) * _width + i) = Vxplus.at<uint8_t>(j, i);
-			}
-
-		imagecolumn = imagecolumn + 1;
-		if (imagecolumn > maxImagecolumn)
-		{
-			imagecolumn = 0;
-			imagerow = imagerow + 1;
-		}
-
-		if (imagerow > maxImagerow)
+		// Allocated by the first frame pair of the thread, reused by the next ones
+		cv::Mat _frame_diff;
+		for (size_t i = begin; i < end; i++)
 		{
-			imagerow = 0;
+			cv::subtract(_frames[i], _frames[i + 1], _frame_diff);
 
-			if (_frames_width != 0 || _frames_height != 0)
+			size_t row = i / cell_columns;
+			size_t column = 2 * (i % cell_columns);
+			for (size_t y = 0; y < _height; y++)
 			{
-				cv::resize(totalframe, reducedtotalframe, _frame_size2, cv::INTER_LINEAR);
-				Tensor<float>::matrix_to_tensor(reducedtotalframe, out);
+				_priv::MotionGridHelper::split_velocity(_frame_diff.ptr<float>(y), _priv::MotionGridHelper::grid_row(totalframe, row, column, y, _height, _width),
+														_priv::MotionGridHelper::grid_row(totalframe, row, column + 1, y, _height, _width), _width, 1.0f, 0.0f);
 			}
-			else
-				Tensor<float>::matrix_to_tensor(totalframe, out);
-
-			if (_draw == 1)
-				Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", out);
+		}
+	};
+	parallel_range(pair_number, 1, compute_pairs);
 
-			totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
+	_priv::MotionGridHelper::grid_to_tensor(totalframe, cv::Size(_frames_width, _frames_height), in);
 
-			break;
-		}
-	}
-	in = out;
+	if (_draw == 1)
+		Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", in);
 }
\ No newline at end of file
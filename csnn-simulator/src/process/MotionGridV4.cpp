@@ -1,4 +1,5 @@
 #include "process/MotionGridV4.h"
+#include "process/MotionGrid.h"
 
 using namespace process;
 
@@ -91,103 +92,42 @@ void MotionGridV4::_process(const std::string &label, Tensor<InputType> &in) con
 	std::vector<cv::Mat> _frames;
 
 	// This function returns a list of frames that have gone through background subtraction.
-	Tensor<float>::tensor_to_matrices(_frames, in);
+	_priv::MotionGridHelper::tensor_to_frames(in, _frames);
 
-	int imagerow = 0;
-	int imagecolumn = 0;
-	float SCALER = _scaler;
+	// Each frame pair fills a cell of four frames (Vx-, Vx+, Vy-, Vy+) from the differences with the next two frames, the frames after the last cell are not used.
+	size_t cell_columns = _mg_horizontal_frames / 4;
+	size_t pair_number = std::min(_frames.size() > 1 ? _frames.size() - 2 : 0, _mg_vertical_frames * cell_columns);
 
-	int VERTICAL_FRAMES = _mg_vertical_frames;
-	int HORIZONTAL_FRAMES = _mg_horizontal_frames;
-	int maxImagecolumn = ((HORIZONTAL_FRAMES / 4) - 1);
-	int maxImagerow = VERTICAL_FRAMES - 1;
+	cv::Mat totalframe = cv::Mat::zeros(_height * _mg_vertical_frames, _width * _mg_horizontal_frames, CV_32FC1);
 
-	Tensor<InputType> out(Shape({_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, _depth, 1})); //, _conv_depth / _frames_total}));
-	cv::Size _frame_size(_width, _height);
-	cv::Size _frame_size2(_width_1, _height_1);
-
-	cv::Mat totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
-	cv::Mat reducedtotalframe = cv::Mat::zeros(_height_1, _width_1, CV_32FC1);
-
-	for (int _i = 0; _i < _frames.size() - 2; _i++)
+	auto compute_pairs = [&](size_t, size_t begin, size_t end)
 	{
+		// Allocated by the first frame pair of the thread, reused by the next ones
 		cv::Mat _frame_diff, _frame_diff_2;
-
-		_frame_diff = _frames[_i] - _frames[_i + 1];
-		_frame_diff_2 = _frames[_i + 1] - _frames[_i + 2];
-
-		// _frame_diff.convertTo(_frame_diff, CV_32S, 100, 0.5);
-
-		cv::Mat Vxplus(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat Vxminus(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat Vyplus(_frame_size, CV_8UC1, cv::Scalar(0));
-		cv::Mat Vyminus(_frame_size, CV_8UC1, cv::Scalar(0));
-
-		for (int y = 0; y < _frame_size.height; y++)
-			for (int x = 0; x < _frame_size.width; x++)
-			{
-
-				float a = _frame_diff.at<float>(y, x);
-				float b = _frame_diff_2.at<float>(y, x);
-
-				if (a >= 0)
-				{
-					Vxplus.at<uint8_t>(y, x) = (uint8_t)(a);
-					Vxminus.at<uint8_t>(y, x) = 0;
-				}
-				else if (a < 0)
-				{
-					Vxminus.at<uint8_t>(y, x) = (uint8_t)(std::abs(a));
-					Vxplus.at<uint8_t>(y, x) = 0;
-				}
-
-				if (b >= 0)
-				{
-					Vyplus.at<uint8_t>(y, x) = (uint8_t)(b);
-					Vyminus.at<uint8_t>(y, x) = 0;
-				}
-				else if (b < 0)
-				{
-					Vyminus.at<uint8_t>(y, x) = (uint8_t)(std::abs(b));
-					Vyplus.at<uint8_t>(y, x) = 0;
-				}
-			}
-
-		for (int i = 0; i < _width; i++)
-			for (int j = 0; j < _height; j++)
-			{
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn) * _width + i) = Vxminus.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 1) * _width + i) = Vxplus.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 2) * _width + i) = Vyminus.at<uint8_t>(j, i);
-				totalframe.at<float>(imagerow * _height + j, (4 * imagecolumn + 3) * _width + i) = Vyplus.at<uint8_t>(j, i);
-			}
-
-		imagecolumn = imagecolumn + 1;
-		if (imagecolumn > maxImagecolumn)
-		{
-			imagecolumn = 0;
-			imagerow = imagerow + 1;
-		}
-
-		if (imagerow > maxImagerow)
+		for (size_t i = begin; i < end; i++)
 		{
-			imagerow = 0;
+			// The second difference of a pair is the first one of the next pair
+			if (i == begin)
+				cv::subtract(_frames[i], _frames[i + 1], _frame_diff);
+			else
+				std::swap(_frame_diff, _frame_diff_2);
+			cv::subtract(_frames[i + 1], _frames[i + 2], _frame_diff_2);
 
-			if (_frames_width != 0 || _frames_height != 0)
+			size_t row = i / cell_columns;
+			size_t column = 4 * (i % cell_columns);
+			for (size_t y = 0; y < _height; y++)
 			{
-				cv::resize(totalframe, reducedtotalframe, _frame_size2, cv::INTER_LINEAR);
-				Tensor<float>::matrix_to_tensor(reducedtotalframe, out);
+				_priv::MotionGridHelper::split_velocity(_frame_diff.ptr<float>(y), _priv::MotionGridHelper::grid_row(totalframe, row, column, y, _height, _width),
+														_priv::MotionGridHelper::grid_row(totalframe, row, column + 1, y, _height, _width), _width, 1.0f, 0.0f);
+				_priv::MotionGridHelper::split_velocity(_frame_diff_2.ptr<float>(y), _priv::MotionGridHelper::grid_row(totalframe, row, column + 2, y, _height, _width),
+														_priv::MotionGridHelper::grid_row(totalframe, row, column + 3, y, _height, _width), _width, 1.0f, 0.0f);
 			}
-			else
-				Tensor<float>::matrix_to_tensor(totalframe, out);
-
-			if (_draw == 1)
-				Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", out);
+		}
+	};
+	parallel_range(pair_number, 1, compute_pairs);
 
-			totalframe = cv::Mat::zeros(_height * VERTICAL_FRAMES, _width * HORIZONTAL_FRAMES, CV_32FC1);
+	_priv::MotionGridHelper::grid_to_tensor(totalframe, _frames_width != 0 || _frames_height != 0 ? cv::Size(_width_1, _height_1) : cv::Size(), in);
 
-			break;
-		}
-	}
-	in = out;
+	if (_draw == 1)
+		Tensor<float>::draw_nonscaled_tensor(_file_path + "/Input_frames/" + _expName + "/MG/MG_" + _label + "_" + std::to_string(rand() % 100) + "_" + std::to_string(rand() % 100) + "_", in);
 }
\ No newline at end of file
@@ -1,9 +1,57 @@
 #include "process/OnOffFilter.h"
 #include "Experiment.h"
 #include "Math.h"
+#include "Parallel.h"
+
+#include "Simd.h"
 
 using namespace process;
 
+// Minimum number of multiply-adds by thread, below it a sample is filtered in the calling thread.
+#define ON_OFF_FILTER_THREAD_COST (1 << 19)
+
+static inline size_t clamp_index(ptrdiff_t index, size_t size)
+{
+	return index < 0 ? 0 : std::min<size_t>(index, size - 1);
+}
+
+// y[i] += a * x[i]
+static inline void axpy(float *y, const float *x, float a, size_t n)
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	__m256 __a = _mm256_set1_ps(a);
+	for (; i + AVX_256_N <= n; i += AVX_256_N)
+	{
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(__a, _mm256_loadu_ps(x + i))));
+	}
+#endif
+	for (; i < n; i++)
+	{
+		y[i] += a * x[i];
+	}
+}
+
+// on[i] = max(0, v[i]), off[i] = max(0, -v[i])
+static inline void rectify(const float *v, float *on, float *off, size_t n)
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	__m256 __zero = _mm256_setzero_ps();
+	for (; i + AVX_256_N <= n; i += AVX_256_N)
+	{
+		__m256 __v = _mm256_loadu_ps(v + i);
+		_mm256_storeu_ps(on + i, _mm256_max_ps(__zero, __v));
+		_mm256_storeu_ps(off + i, _mm256_max_ps(__zero, _mm256_sub_ps(__zero, __v)));
+	}
+#endif
+	for (; i < n; i++)
+	{
+		on[i] = std::max<float>(0, v[i]);
+		off[i] = std::max<float>(0, -v[i]);
+	}
+}
+
 /**
  * @brief A on-center/off-center filter mimics the ratina if the eye, where the on-center receptive field shows an excitatory response when
  * stimulated at the center and an inhibitory response when stimulated at the peripheral part. In contrast, the off-center receptive field
@@ -58,6 +106,132 @@ Tensor<float> process::_priv::OnOffFilterHelper::generate_filter(size_t filter_s
 	return filter;
 }
 
+Tensor<float> process::_priv::OnOffFilterHelper::generate_gaussian(size_t filter_size, float dev)
+{
+	Tensor<float> filter(Shape({filter_size}));
+	float filter_sum = 0;
+	for (size_t i = 0; i < filter_size; i++)
+	{
+		// Same coordinates as generate_filter, the constant factor cancels with the normalization.
+		filter.at(i) = std::exp(-std::pow((i + 1) - static_cast<float>(filter_size) / 2.0f - 0.5f, 2.0f) / 2.0f / (dev * dev));
+		filter_sum += filter.at(i);
+	}
+
+	for (size_t i = 0; i < filter_size; i++)
+	{
+		filter.at(i) /= filter_sum;
+	}
+
+	return filter;
+}
+
+void process::_priv::OnOffFilterHelper::apply_separable_filter(const Tensor<float> &in, Tensor<float> &out, size_t height, size_t width, size_t depth, size_t conv_depth,
+																const Tensor<float> &center, const Tensor<float> &surround)
+{
+	size_t filter_size = center.shape().product();
+	ptrdiff_t radius = filter_size / 2;
+	// All the (z, k) planes of a pixel are contiguous, the passes are vectorized over them.
+	size_t channels = depth * conv_depth;
+	size_t row_size = width * channels;
+	const float *src = in.begin();
+	float *dst = out.begin();
+
+	auto filter_rows = [&](size_t, size_t begin, size_t end)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		// Horizontal pass of the input rows used by the output rows [begin, end)
+		size_t first = clamp_index(static_cast<ptrdiff_t>(begin) - radius, height);
+		size_t last = clamp_index(static_cast<ptrdiff_t>(end - 1) - radius + filter_size - 1, height);
+		std::vector<float> center_rows((last - first + 1) * row_size, 0);
+		std::vector<float> surround_rows((last - first + 1) * row_size, 0);
+
+		for (size_t x = first; x <= last; x++)
+		{
+			const float *line = src + x * row_size;
+			float *center_line = center_rows.data() + (x - first) * row_size;
+			float *surround_line = surround_rows.data() + (x - first) * row_size;
+			for (size_t y = 0; y < width; y++)
+			{
+				for (size_t f = 0; f < filter_size; f++)
+				{
+					const float *pixel = line + clamp_index(static_cast<ptrdiff_t>(y + f) - radius, width) * channels;
+					axpy(center_line + y * channels, pixel, center.at(f), channels);
+					axpy(surround_line + y * channels, pixel, surround.at(f), channels);
+				}
+			}
+		}
+
+		// Vertical pass, then the difference of the two gaussians is split in the on and off channels
+		std::vector<float> v(row_size);
+		for (size_t x = begin; x < end; x++)
+		{
+			std::fill(v.begin(), v.end(), 0.0f);
+			for (size_t f = 0; f < filter_size; f++)
+			{
+				size_t x_in = clamp_index(static_cast<ptrdiff_t>(x + f) - radius, height) - first;
+				axpy(v.data(), center_rows.data() + x_in * row_size, center.at(f), row_size);
+				axpy(v.data(), surround_rows.data() + x_in * row_size, -surround.at(f), row_size);
+			}
+
+			for (size_t y = 0; y < width; y++)
+			{
+				for (size_t z = 0; z < depth; z++)
+				{
+					float *on = dst + ((x * width + y) * depth * 2 + z * 2) * conv_depth;
+					rectify(v.data() + (y * depth + z) * conv_depth, on, on + conv_depth, conv_depth);
+				}
+			}
+		}
+	};
+
+	parallel_range(height, std::max<size_t>(1, ON_OFF_FILTER_THREAD_COST / (row_size * filter_size * 4)), filter_rows);
+}
+
+void process::_priv::OnOffFilterHelper::apply_temporal_filter(const Tensor<float> &in, Tensor<float> &out, size_t height, size_t width, size_t depth, size_t conv_depth,
+															   const Tensor<float> &filter)
+{
+	size_t filter_size = filter.shape().product();
+	ptrdiff_t radius = filter_size / 2;
+	const float *src = in.begin();
+	float *dst = out.begin();
+
+	auto filter_rows = [&](size_t, size_t begin, size_t end)
+	{
+		// Each (x, y, z) line is contiguous, it is padded with its replicated borders so that every tap is a contiguous multiply-add.
+		std::vector<float> padded(conv_depth + filter_size - 1);
+		std::vector<float> v(conv_depth);
+		for (size_t x = begin; x < end; x++)
+		{
+			for (size_t y = 0; y < width; y++)
+			{
+				for (size_t z = 0; z < depth; z++)
+				{
+					const float *line = src + ((x * width + y) * depth + z) * conv_depth;
+					for (size_t i = 0; i < padded.size(); i++)
+					{
+						padded[i] = line[clamp_index(static_cast<ptrdiff_t>(i) - radius, conv_depth)];
+					}
+
+					std::fill(v.begin(), v.end(), 0.0f);
+					for (size_t f = 0; f < filter_size; f++)
+					{
+						axpy(v.data(), padded.data() + f, filter.at(f), conv_depth);
+					}
+
+					float *on = dst + ((x * width + y) * depth * 2 + z * 2) * conv_depth;
+					rectify(v.data(), on, on + conv_depth, conv_depth);
+				}
+			}
+		}
+	};
+
+	parallel_range(height, std::max<size_t>(1, ON_OFF_FILTER_THREAD_COST / (width * depth * conv_depth * filter_size * 2)), filter_rows);
+}
+
 //
 //	DefaultOnOffFilter
 //
@@ -65,7 +239,7 @@ Tensor<float> process::_priv::OnOffFilterHelper::generate_filter(size_t filter_s
 static RegisterClassParameter<DefaultOnOffFilter, ProcessFactory> _register_1("DefaultOnOffFilter");
 
 DefaultOnOffFilter::DefaultOnOffFilter() : UniquePassProcess(_register_1),
-										   _filter_size(0), _center_dev(0), _surround_dev(0), _height(0), _width(0), _depth(0), _conv_depth(0), _filter()
+										   _filter_size(0), _center_dev(0), _surround_dev(0), _height(0), _width(0), _depth(0), _conv_depth(0), _center_filter(), _surround_filter()
 {
 	add_parameter("filter_size", _filter_size);
 	add_parameter("center_dev", _center_dev);
@@ -89,7 +263,8 @@ Shape DefaultOnOffFilter::compute_shape(const Shape &shape)
 	_width = shape.dim(1);
 	_depth = shape.dim(2);
 	_conv_depth = shape.number() > 3 ? shape.dim(3) : 1;
-	_filter = _priv::OnOffFilterHelper::generate_filter(_filter_size, _center_dev, _surround_dev);
+	_center_filter = _priv::OnOffFilterHelper::generate_gaussian(_filter_size, _center_dev);
+	_surround_filter = _priv::OnOffFilterHelper::generate_gaussian(_filter_size, _surround_dev);
 	if (shape.number() > 3)
 		return Shape({_height, _width, _depth * 2, _conv_depth});
 	else
@@ -108,59 +283,11 @@ void DefaultOnOffFilter::process_test(const std::string &, Tensor<float> &sample
 
 void DefaultOnOffFilter::_process(Tensor<InputType> &in) const
 {
-
-	if (in.shape().number() <= 3) // 2D Input
-	{
-		Tensor<InputType> out(Shape({_height, _width, _depth * 2})); // the depth is doubled because there must be two seperate channels for the off cells and the on cells.
-		for (size_t z = 0; z < _depth; z++)
-		{
-			for (size_t x = 0; x < _height; x++)
-				for (size_t y = 0; y < _width; y++)
-				{
-					float v = 0;
-					for (size_t fx = 0; fx < _filter_size; fx++)
-					{
-						for (size_t fy = 0; fy < _filter_size; fy++)
-						{
-							size_t x_in = x + fx > _filter_size / 2 ? std::min(x + fx - _filter_size / 2, _height - 1) : 0;
-							size_t y_in = y + fy > _filter_size / 2 ? std::min(y + fy - _filter_size / 2, _width - 1) : 0;
-
-							v += in.at(x_in, y_in, z) * _filter.at(fx, fy);
-						}
-					}
-
-					out.at(x, y, z * 2) = std::max<float>(0, v);
-					out.at(x, y, z * 2 + 1) = std::max<float>(0, -v);
-				}
-		}
-
-		in = out;
-	}
-	else // 3D Input
-	{
-		Tensor<InputType> out(Shape({_height, _width, _depth * 2, _conv_depth})); // the depth is doubled because there must be two seperate channels for the off cells and the on cells.
-		for (size_t x = 0; x < _height; x++)
-			for (size_t y = 0; y < _width; y++)
-				for (size_t z = 0; z < _depth; z++)
-					for (size_t k = 0; k < _conv_depth; k++)
-					{
-						float v = 0;
-						for (size_t fx = 0; fx < _filter_size; fx++)
-						{
-							for (size_t fy = 0; fy < _filter_size; fy++)
-							{
-								size_t x_in = x + fx > _filter_size / 2 ? std::min(x + fx - _filter_size / 2, _height - 1) : 0;
-								size_t y_in = y + fy > _filter_size / 2 ? std::min(y + fy - _filter_size / 2, _width - 1) : 0;
-
-								v += in.at(x_in, y_in, z, k) * _filter.at(fx, fy);
-							}
-						}
-
-						out.at(x, y, z * 2, k) = std::max<float>(0, v);
-						out.at(x, y, z * 2 + 1, k) = std::max<float>(0, -v);
-					}
-		in = out;
-	}
+	// the depth is doubled because there must be two seperate channels for the off cells and the on cells.
+	Tensor<InputType> out(in.shape().number() <= 3 ? Shape({_height, _width, _depth * 2}) : Shape({_height, _width, _depth * 2, _conv_depth}));
+	size_t conv_depth = in.shape().number() <= 3 ? 1 : _conv_depth;
+	_priv::OnOffFilterHelper::apply_separable_filter(in, out, _height, _width, _depth, conv_depth, _center_filter, _surround_filter);
+	in = std::move(out);
 }
 
 //
@@ -1,4 +1,5 @@
 #include "process/OnOffTempFilter.h"
+#include "process/OnOffFilter.h"
 #include "Experiment.h"
 #include "Math.h"
 
@@ -205,25 +206,8 @@ void DefaultOnOffTempFilter::process_test(const std::string &, Tensor<float> &sa
 void DefaultOnOffTempFilter::_process(Tensor<InputType> &in) const
 {
 	Tensor<InputType> out(Shape({_height, _width, _depth * 2, _conv_depth})); // the depth is doubled because there must be two seperate channels for the off cells and the on cells.
-
-	for (size_t x = 0; x < _height; x++)
-		for (size_t y = 0; y < _width; y++)
-			for (size_t z = 0; z < _depth; z++)
-				for (size_t k = 0; k < _conv_depth; k++)
-				{
-					float v = 0;
-					for (size_t fk = 0; fk < _tmp_filter_size; fk++)
-					{
-						size_t k_in = k + fk > _tmp_filter_size / 2 ? std::min(k + fk - _tmp_filter_size / 2, _conv_depth - 1) : 0;
-
-						v += in.at(x, y, z, k_in) * _temporal_filter.at(fk);
-					}
-
-					out.at(x, y, z * 2, k) = std::max<float>(0, v);
-					out.at(x, y, z * 2 + 1, k) = std::max<float>(0, -v);
-				}
-
-	in = out;
+	_priv::OnOffFilterHelper::apply_temporal_filter(in, out, _height, _width, _depth, _conv_depth, _temporal_filter);
+	in = std::move(out);
 	// Tensor<float>::draw_tensor("/home/melassal/Workspace/CSNN/csnn-simulator-build/test1/", out);
 }
 
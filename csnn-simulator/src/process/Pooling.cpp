@@ -2,10 +2,52 @@
 
 using namespace process;
 
+/**
+ * @brief Reduces the non-default values of a sparse sample into their pooled cells of out with reduce(cell, value).
+ * The values outside of the pooling windows, when a dimension is not a multiple of its filter, are dropped like in the dense pooling.
+ */
+template <typename Reduce>
+static void pool_sparse(const SparseTensor<float> &in, Tensor<float> &out, size_t filter_width, size_t filter_height, size_t filter_conv_depth, Reduce reduce)
+{
+	if (filter_width == 0 || filter_height == 0 || filter_conv_depth == 0)
+	{
+		return;
+	}
+
+	size_t input_height = in.shape().dim(1);
+	size_t input_depth = in.shape().dim(2);
+	size_t input_conv_depth = in.shape().number() > 3 ? in.shape().dim(3) : 1;
+
+	size_t output_width = out.shape().dim(0);
+	size_t output_height = out.shape().dim(1);
+	size_t output_depth = out.shape().dim(2);
+	size_t output_conv_depth = out.shape().dim(3);
+	float *data = out.begin();
+
+	for (const std::pair<uint32_t, float> &entry : in.values())
+	{
+		size_t index = entry.first;
+		size_t k = index % input_conv_depth;
+		index /= input_conv_depth;
+		size_t z = index % input_depth;
+		index /= input_depth;
+		size_t y = index % input_height;
+		size_t x = index / input_height;
+
+		size_t ox = x / filter_width;
+		size_t oy = y / filter_height;
+		size_t ok = k / filter_conv_depth;
+		if (ox < output_width && oy < output_height && z < output_depth && ok < output_conv_depth)
+		{
+			reduce(data[((ox * output_height + oy) * output_depth + z) * output_conv_depth + ok], entry.second);
+		}
+	}
+}
+
 static RegisterClassParameter<SumPooling, ProcessFactory> _register("SumPooling");
 
 SumPooling::SumPooling() : UniquePassProcess(_register),
-						   _target_width(0), _target_height(0), _target_conv_depth(0), _width(0), _height(0), _depth(0), _conv_depth(0)
+						   _target_width(0), _target_height(0), _target_conv_depth(0), _width(0), _height(0), _depth(0), _conv_depth(0), _buffer()
 {
 	add_parameter("width", _target_width);
 	add_parameter("height", _target_height);
@@ -30,9 +72,11 @@ Shape SumPooling::compute_shape(const Shape &shape)
 	// In case the user didn't want temporal pooling, the _target_conv_depth would be the same as the _conv_depth
 	_target_conv_depth = _target_conv_depth == 0 ? _conv_depth : _target_conv_depth;
 
-	return Shape({std::min<size_t>(_target_width, _width),
-				  std::min<size_t>(_target_height, _height),
-				  _depth, std::min<size_t>(_target_conv_depth, _conv_depth)});
+	Shape output_shape({std::min<size_t>(_target_width, _width),
+						std::min<size_t>(_target_height, _height),
+						_depth, std::min<size_t>(_target_conv_depth, _conv_depth)});
+	_buffer = Tensor<float>(output_shape);
+	return output_shape;
 }
 
 void SumPooling::process_train(const std::string &, Tensor<float> &sample)
@@ -49,6 +93,18 @@ void SumPooling::process_test(const std::string &, Tensor<float> &sample)
 	//draw_progress(_test_sample_count, get_test_count());
 }
 
+void SumPooling::process_train_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_train_sample_count++;
+	_process_sparse(sample);
+}
+
+void SumPooling::process_test_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_test_sample_count++;
+	_process_sparse(sample);
+}
+
 void SumPooling::_process(Tensor<float> &in) const
 {
 
@@ -65,8 +121,13 @@ void SumPooling::_process(Tensor<float> &in) const
 	size_t filter_height = _height / output_height;
 	size_t filter_conv_depth = _input_conv_depth / output_conv_depth;
 
-	// Tensor<float> out(Shape({output_width, output_height, _depth, output_conv_depth}));
-	Tensor<float> out = Tensor<float>(Shape({output_width, output_height, _depth, output_conv_depth}));
+	Tensor<float> out(Shape({output_width, output_height, _depth, output_conv_depth}));
+
+	// A 3D input is indexed as a 4D input with a conv depth of 1.
+	size_t input_height = in.shape().dim(1);
+	size_t input_depth = in.shape().dim(2);
+	const float *data = in.begin();
+	float *out_data = out.begin();
 
 	for (size_t x = 0; x < output_width; x++)
 		for (size_t y = 0; y < output_height; y++)
@@ -77,23 +138,48 @@ void SumPooling::_process(Tensor<float> &in) const
 
 					for (size_t fx = 0; fx < filter_width; fx++)
 						for (size_t fy = 0; fy < filter_height; fy++)
+						{
+							const float *window = data + (((x * filter_width + fx) * input_height + y * filter_height + fy) * input_depth + z) * _input_conv_depth + k * filter_conv_depth;
 							for (size_t fk = 0; fk < filter_conv_depth; fk++)
 							{
-								if (in.shape().number() > 3)
-									v += in.at(x * filter_width + fx, y * filter_height + fy, z, k * filter_conv_depth + fk);
-								else
-									v += in.at(x * filter_width + fx, y * filter_height + fy, z);
+								v += window[fk];
 							}
+						}
 
-					out.at(x, y, z, k) = v;
+					*out_data++ = v;
 				}
-	in = out;
+	in = std::move(out);
+}
+
+void SumPooling::_process_sparse(SparseTensor<float> &sample)
+{
+	// The sum of the default values is only known to be zero when the default value is zero.
+	if (sample.default_value() != 0)
+	{
+		Tensor<float> current = from_sparse_tensor(sample);
+		_process(current);
+		sample = to_sparse_tensor(current);
+		return;
+	}
+
+	size_t input_conv_depth = sample.shape().number() > 3 ? sample.shape().dim(3) : 1;
+	size_t filter_width = _width / _buffer.shape().dim(0);
+	size_t filter_height = _height / _buffer.shape().dim(1);
+	size_t filter_conv_depth = input_conv_depth / _buffer.shape().dim(3);
+
+	_buffer.fill(0);
+	pool_sparse(sample, _buffer, filter_width, filter_height, filter_conv_depth, [](float &cell, float value)
+				{ cell += value; });
+
+	SparseTensor<float> out(_buffer.shape());
+	to_sparse_tensor(_buffer, out);
+	sample = std::move(out);
 }
 
 static RegisterClassParameter<MaxPooling, ProcessFactory> _registerMax("MaxPooling");
 
 MaxPooling::MaxPooling() : UniquePassProcess(_registerMax),
-						   _target_width(0), _target_height(0), _target_conv_depth(0), _width(0), _height(0), _depth(0), _conv_depth(0)
+						   _target_width(0), _target_height(0), _target_conv_depth(0), _width(0), _height(0), _depth(0), _conv_depth(0), _buffer()
 {
 	add_parameter("width", _target_width);
 	add_parameter("height", _target_height);
@@ -116,9 +202,11 @@ Shape MaxPooling::compute_shape(const Shape &shape)
 	// In case the user didn't want temporal pooling, the _target_conv_depth would be the same as the _conv_depth
 	_target_conv_depth = _target_conv_depth == 0 ? _conv_depth : _target_conv_depth;
 
-	return Shape({std::min<size_t>(_target_width, _width),
-				  std::min<size_t>(_target_height, _height),
-				  _depth, std::min<size_t>(_target_conv_depth, _conv_depth)});
+	Shape output_shape({std::min<size_t>(_target_width, _width),
+						std::min<size_t>(_target_height, _height),
+						_depth, std::min<size_t>(_target_conv_depth, _conv_depth)});
+	_buffer = Tensor<float>(output_shape);
+	return output_shape;
 }
 
 void MaxPooling::process_train(const std::string &, Tensor<float> &sample)
@@ -131,6 +219,16 @@ void MaxPooling::process_test(const std::string &, Tensor<float> &sample)
 	_process(sample);
 }
 
+void MaxPooling::process_train_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_process_sparse(sample);
+}
+
+void MaxPooling::process_test_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_process_sparse(sample);
+}
+
 void MaxPooling::_process(Tensor<float> &in) const
 {
 
@@ -144,6 +242,13 @@ void MaxPooling::_process(Tensor<float> &in) const
 
 	Tensor<float> out(Shape({output_width, output_height, _depth, output_conv_depth}));
 
+	// A 3D input is indexed as a 4D input with a conv depth of 1.
+	size_t input_height = in.shape().dim(1);
+	size_t input_depth = in.shape().dim(2);
+	size_t input_conv_depth = in.shape().number() > 3 ? in.shape().dim(3) : 1;
+	const float *data = in.begin();
+	float *out_data = out.begin();
+
 	for (size_t x = 0; x < output_width; x++)
 		for (size_t y = 0; y < output_height; y++)
 			for (size_t z = 0; z < _depth; z++)
@@ -154,14 +259,41 @@ void MaxPooling::_process(Tensor<float> &in) const
 
 					for (size_t fx = 0; fx < filter_width; fx++)
 						for (size_t fy = 0; fy < filter_height; fy++)
+						{
+							const float *window = data + (((x * filter_width + fx) * input_height + y * filter_height + fy) * input_depth + z) * input_conv_depth + k * filter_conv_depth;
 							for (size_t fk = 0; fk < filter_conv_depth; fk++)
 							{
-								v = std::max<float>(v, in.at(x * filter_width + fx, y * filter_height + fy, z, k * filter_conv_depth + fk));
+								v = std::max<float>(v, window[fk]);
 							}
+						}
 
-					out.at(x, y, z, k) = v;
+					*out_data++ = v;
 				}
-	in = out;
+	in = std::move(out);
+}
+
+void MaxPooling::_process_sparse(SparseTensor<float> &sample)
+{
+	// The pooled cells start at 0 like in the dense pooling, which only matches the missing values when the default value is zero.
+	if (sample.default_value() != 0)
+	{
+		Tensor<float> current = from_sparse_tensor(sample);
+		_process(current);
+		sample = to_sparse_tensor(current);
+		return;
+	}
+
+	size_t filter_width = _width / _buffer.shape().dim(0);
+	size_t filter_height = _height / _buffer.shape().dim(1);
+	size_t filter_conv_depth = _conv_depth / _buffer.shape().dim(3);
+
+	_buffer.fill(0);
+	pool_sparse(sample, _buffer, filter_width, filter_height, filter_conv_depth, [](float &cell, float value)
+				{ cell = std::max<float>(cell, value); });
+
+	SparseTensor<float> out(_buffer.shape());
+	to_sparse_tensor(_buffer, out);
+	sample = std::move(out);
 }
 
 static RegisterClassParameter<TemporalPooling, ProcessFactory> _tmp_register("TemporalPooling");
@@ -1,4 +1,7 @@
 #include "process/ReichardtDetector.h"
+#include "Parallel.h"
+
+#include "Simd.h"
 
 using namespace process;
 
@@ -49,105 +52,84 @@ Shape ReichardtDetector::compute_shape(const Shape &shape)
 	return Shape({_height, _width, _depth, _conv_depth});
 }
 
-void ReichardtDetector::_process(const std::string &label, Tensor<InputType> &in) const
+/**
+ * @brief out[k] = center[k] * neighbour[k + 1] - center[k + 1] * neighbour[k], the correlation of the frame pairs (k, k + 1) with a neighbour pixel.
+ * The last frame is paired with itself.
+ */
+static inline void correlate(const float *center, const float *neighbour, float *out, size_t frame_number)
 {
-	std::vector<cv::Mat> _frames;
-	std::vector<Tensor<InputType>> _out_frames;
-
-	Tensor<InputType> out(Shape({_height, _width, _depth, _conv_depth}));
-
-	cv::Mat shift_left_current_gray_frame, current_gray_frame, reichardt_left, shift_left_prev_gray_frame, prev_gray_frame, reichardt_right, reichardt_full_h;
-	cv::Mat shift_up_current_gray_frame, reichardt_left1, shift_up_prev_gray_frame, reichardt_right1, reichardt_full_v;
-	cv::Mat shift_diag1_current_gray_frame, reichardt_left2, shift_diag1_prev_gray_frame, reichardt_right2, reichardt_full_d1;
-	cv::Mat shift_diag2_current_gray_frame, reichardt_left3, shift_diag2_prev_gray_frame, reichardt_right3, reichardt_full_d2;
-
-	// This function returns a list of frames that have gone through background subtraction.
-	Tensor<float>::tensor_to_matrices(_frames, in);
-	_frames.push_back(_frames[_frames.size() - 1]);
+	size_t k = 0;
+#ifdef SMID_AVX256
+	for (; k + AVX_256_N < frame_number; k += AVX_256_N)
+	{
+		__m256 __left = _mm256_mul_ps(_mm256_loadu_ps(center + k), _mm256_loadu_ps(neighbour + k + 1));
+		__m256 __right = _mm256_mul_ps(_mm256_loadu_ps(center + k + 1), _mm256_loadu_ps(neighbour + k));
+		_mm256_storeu_ps(out + k, _mm256_sub_ps(__left, __right));
+	}
+#endif
+	for (; k < frame_number; k++)
+	{
+		size_t next = k + 1 < frame_number ? k + 1 : k;
+		out[k] = center[k] * neighbour[next] - center[next] * neighbour[k];
+	}
+}
 
-	cv::Size _frame_size(_width, _height);
+void ReichardtDetector::_process(const std::string &label, Tensor<InputType> &in) const
+{
+	size_t in_depth = in.shape().dim(2);
+	size_t pixel_size = in_depth * _conv_depth;
 
-	for (int _i = 0; _i < _frames.size() - 1; _i++)
+	// Same scaling as cv::Mat / 255, which multiplies by the float 1 / 255.
+	float scale = static_cast<float>(1.0 / 255);
+	for (float &value : in)
 	{
-		std::vector<cv::Mat> _direction_frames;
-		Tensor<InputType> _direction_out(Shape({_height, _width, _depth, 1}));
-
-		prev_gray_frame = _frames[_i] / 255;
-		current_gray_frame = _frames[_i + 1] / 255;
-		// -----------Left - Right direction---------
-		cv::copyMakeBorder(current_gray_frame, shift_left_current_gray_frame, 0, 0, 1, 0, cv::BORDER_CONSTANT, cv::Scalar(0));
-		// Crop the full image to that image contained by the rectangle cropsizeRect
-		cv::Rect cropsizeRect(0, 0, shift_left_current_gray_frame.cols - 1, shift_left_current_gray_frame.rows);
-		shift_left_current_gray_frame = shift_left_current_gray_frame(cropsizeRect);
-		cv::multiply(prev_gray_frame, shift_left_current_gray_frame, reichardt_left);
-
-		cv::copyMakeBorder(prev_gray_frame, shift_left_prev_gray_frame, 0, 0, 1, 0, cv::BORDER_CONSTANT, cv::Scalar(0));
-		// Crop the full image to that image contained by the rectangle cropsizeRect
-		shift_left_prev_gray_frame = shift_left_prev_gray_frame(cropsizeRect);
-		cv::multiply(current_gray_frame, shift_left_prev_gray_frame, reichardt_right);
-
-		// Horizontal movement
-		reichardt_full_h = reichardt_left - reichardt_right;
-
-		// -----------Up - Down direction---------
-		cv::copyMakeBorder(current_gray_frame, shift_up_current_gray_frame, 1, 0, 0, 0, cv::BORDER_CONSTANT, cv::Scalar(0));
-		cv::Rect cropsizeRect1(0, 0, shift_up_current_gray_frame.cols, shift_up_current_gray_frame.rows - 1);
-		shift_up_current_gray_frame = shift_up_current_gray_frame(cropsizeRect1);
-		cv::multiply(prev_gray_frame, shift_up_current_gray_frame, reichardt_left1);
-
-		cv::copyMakeBorder(prev_gray_frame, shift_up_prev_gray_frame, 1, 0, 0, 0, cv::BORDER_CONSTANT, cv::Scalar(0));
-		shift_up_prev_gray_frame = shift_up_prev_gray_frame(cropsizeRect1);
-		cv::multiply(current_gray_frame, shift_up_prev_gray_frame, reichardt_right1);
-
-		// Vertical movement
-		reichardt_full_v = reichardt_left1 - reichardt_right1;
-
-		// -----------Up right diagonal direction---------
-		cv::copyMakeBorder(current_gray_frame, shift_diag1_current_gray_frame, 1, 0, 1, 0, cv::BORDER_CONSTANT, cv::Scalar(0));
-		cv::Rect cropsizeRect2(0, 0, shift_diag1_current_gray_frame.cols - 1, shift_diag1_current_gray_frame.rows - 1);
-		shift_diag1_current_gray_frame = shift_diag1_current_gray_frame(cropsizeRect2);
-		cv::multiply(prev_gray_frame, shift_diag1_current_gray_frame, reichardt_left2);
-
-		cv::copyMakeBorder(prev_gray_frame, shift_diag1_prev_gray_frame, 1, 0, 1, 0, cv::BORDER_CONSTANT, cv::Scalar(0));
-		shift_diag1_prev_gray_frame = shift_diag1_prev_gray_frame(cropsizeRect2);
-		cv::multiply(current_gray_frame, shift_diag1_prev_gray_frame, reichardt_right2);
-
-		// Diagonal movement
-		reichardt_full_d1 = reichardt_left2 - reichardt_right2;
-
-		// -----------Down right diagonal direction---------
-		cv::copyMakeBorder(current_gray_frame, shift_diag2_current_gray_frame, 0, 1, 0, 1, cv::BORDER_CONSTANT, cv::Scalar(0));
-		cv::Rect cropsizeRect3(1, 1, shift_diag2_current_gray_frame.cols - 1, shift_diag2_current_gray_frame.rows - 1);
-		shift_diag2_current_gray_frame = shift_diag2_current_gray_frame(cropsizeRect3);
-		cv::multiply(prev_gray_frame, shift_diag2_current_gray_frame, reichardt_left3);
-
-		cv::copyMakeBorder(prev_gray_frame, shift_diag2_prev_gray_frame, 0, 1, 0, 1, cv::BORDER_CONSTANT, cv::Scalar(0));
-		shift_diag2_prev_gray_frame = shift_diag2_prev_gray_frame(cropsizeRect3);
-		cv::multiply(current_gray_frame, shift_diag2_prev_gray_frame, reichardt_right3);
-
-		// Diagonal movement
-		reichardt_full_d2 = reichardt_left3 - reichardt_right3;
-
-		// reichardt_full_h, reichardt_full_v, reichardt_full_d1, reichardt_full_d2
-		_direction_frames.push_back(reichardt_full_h);
-		_direction_frames.push_back(reichardt_full_v);
-		_direction_frames.push_back(reichardt_full_d1);
-		_direction_frames.push_back(reichardt_full_d2);
-
-		Tensor<float>::direction_matrices_to_tensor(_direction_frames, _direction_out);
-
-		_out_frames.push_back(_direction_out);
+		value *= scale;
 	}
 
-	Tensor<float>::tensors_to_tensor(_out_frames, out);
+	Tensor<InputType> out(Shape({_height, _width, _depth, _conv_depth}));
+
+	// The frames are the last dimension of the tensors, so the correlations of all the frame pairs of a pixel are computed together,
+	// each direction with its neighbour pixel, which is zero past the border. Only the first depth of the input is used.
+	auto compute_rows = [&](size_t, size_t begin, size_t end)
+	{
+		std::vector<float> zero(_conv_depth, 0.0f);
+		const float *frames = in.begin();
+		for (size_t y = begin; y < end; y++)
+		{
+			for (size_t x = 0; x < _width; x++)
+			{
+				const float *center = frames + (y * _width + x) * pixel_size;
+				float *directions = out.begin() + (y * _width + x) * _depth * _conv_depth;
+
+				// Horizontal movement
+				correlate(center, x > 0 ? center - pixel_size : zero.data(), directions, _conv_depth);
+				// Vertical movement
+				correlate(center, y > 0 ? center - _width * pixel_size : zero.data(), directions + _conv_depth, _conv_depth);
+				// Up right diagonal movement
+				correlate(center, x > 0 && y > 0 ? center - (_width + 1) * pixel_size : zero.data(), directions + 2 * _conv_depth, _conv_depth);
+				// Down right diagonal movement
+				correlate(center, x + 1 < _width && y + 1 < _height ? center + (_width + 1) * pixel_size : zero.data(), directions + 3 * _conv_depth, _conv_depth);
+			}
+		}
+	};
+
+	// The threads take contiguous blocks of rows, so that they never write in the same cache lines of the output.
+	parallel_range(_height, 1, compute_rows);
 
 	if (_draw == 1)
 	{
-		Tensor<float>::draw_tensor(_file_path + "/Input_frames/" + _expName + "/RD/RD_h_" + label + "_", _out_frames[0]);
-		Tensor<float>::draw_tensor(_file_path + "/Input_frames/" + _expName + "/RD/RD_v_" + label + "_", _out_frames[1]);
-		Tensor<float>::draw_tensor(_file_path + "/Input_frames/" + _expName + "/RD/RD_d1_" + label + "_", _out_frames[2]);
-		Tensor<float>::draw_tensor(_file_path + "/Input_frames/" + _expName + "/RD/RD_d2_" + label + "_", _out_frames[3]);
+		// The first four frame pairs, as before
+		std::string names[4] = {"RD_h_", "RD_v_", "RD_d1_", "RD_d2_"};
+		for (size_t n = 0; n < 4 && n < _conv_depth; n++)
+		{
+			Tensor<InputType> pair(Shape({_height, _width, _depth, 1}));
+			for (size_t i = 0; i < _height; i++)
+				for (size_t j = 0; j < _width; j++)
+					for (size_t k = 0; k < _depth; k++)
+						pair.at(i, j, k, 0) = out.at(i, j, k, n);
+			Tensor<float>::draw_tensor(_file_path + "/Input_frames/" + _expName + "/RD/" + names[n] + label + "_", pair);
+		}
 	}
 
-	in = out;
+	in = std::move(out);
 }
\ No newline at end of file
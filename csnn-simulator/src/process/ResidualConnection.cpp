@@ -19,8 +19,8 @@ ResidualConnection::ResidualConnection(std::string exp_name, std::string layer_n
 	else
 		_file_path = _file_path + "/ResInput/" + exp_name + "-" + layer_name;
 
-	_data_list.push_back(_file_path + "_train.json");
-	_data_list.push_back(_file_path + "_test.json");
+	_data_list.push_back(_file_path + "_train.features");
+	_data_list.push_back(_file_path + "_test.features");
 }
 
 Shape ResidualConnection::compute_shape(const Shape &shape)
@@ -36,28 +36,36 @@ Shape ResidualConnection::compute_shape(const Shape &shape)
 void ResidualConnection::process_train(const std::string &, Tensor<float> &sample)
 {
 	// load original input.
-	if (_train_set.empty())
+	if (!_train_reader)
 	{
-		LoadPairVector(_data_list[0], _train_set);
+		_train_reader = OpenFeatureReader(_data_list[0]);
 		_train_res_sample_count = 0;
 	}
 
+	if (!_train_reader->has_next())
+		throw std::runtime_error("ResidualConnection: not enough samples in " + _data_list[0]);
+
 	_train_res_sample_count++;
-	_process(sample, _train_set[_train_res_sample_count - 1].second);
+	std::pair<std::string, Tensor<float>> original = _train_reader->next();
+	_process(sample, original.second);
 	//draw_progress(_train_res_sample_count, get_train_count());
 }
 
 void ResidualConnection::process_test(const std::string &, Tensor<float> &sample)
 {
 	// load original input.
-	if (_test_set.empty())
+	if (!_test_reader)
 	{
-		LoadPairVector(_data_list[1], _test_set);
+		_test_reader = OpenFeatureReader(_data_list[1]);
 		_test_res_sample_count = 0;
 	}
 
+	if (!_test_reader->has_next())
+		throw std::runtime_error("ResidualConnection: not enough samples in " + _data_list[1]);
+
 	_test_res_sample_count++;
-	_process(sample, _test_set[_test_res_sample_count - 1].second);
+	std::pair<std::string, Tensor<float>> original = _test_reader->next();
+	_process(sample, original.second);
 	//draw_progress(_test_res_sample_count, get_test_count());
 }
 
@@ -47,14 +47,14 @@ void SaveFeatures::process_train(const std::string &label, Tensor<float> &sample
 
 	_train_save_sample_count++; // a counter for the progress bar
 	draw_progress(_train_save_sample_count, get_train_count());
-	SaveFeature(_file_path + "/SaveFeatures/" + _exp_name + "/" + _exp_name + "_" + _layer_name + "_train.json", _label, sample, _train_save_sample_count, get_train_count());
+	SaveFeature(_file_path + "/SaveFeatures/" + _exp_name + "/" + _exp_name + "_" + _layer_name + "_train.features", _label, sample, _train_save_sample_count, get_train_count());
 }
 
 void SaveFeatures::process_test(const std::string &label, Tensor<float> &sample)
 {
 	_test_save_sample_count++; // a counter for the progress bar
 	draw_progress(_test_save_sample_count, get_test_count());
-	SaveFeature(_file_path + "/SaveFeatures/" + _exp_name + "/" + _exp_name + "_" + _layer_name + "_test.json", label, sample, _test_save_sample_count, get_test_count());
+	SaveFeature(_file_path + "/SaveFeatures/" + _exp_name + "/" + _exp_name + "_" + _layer_name + "_test.features", label, sample, _test_save_sample_count, get_test_count());
 }
 
 void SaveFeatures::_process(Tensor<float> &in) const
@@ -1,14 +1,71 @@
 #include "process/Scaling.h"
+#include "Parallel.h"
+
+#include "Simd.h"
 
 using namespace process;
 
+// Minimum number of values by thread of the scaling of a sample
+#define SCALING_PARALLEL_SIZE (1 << 16)
+
+/**
+ * @brief Minimum number of indexes by thread when each index has item_size values.
+ */
+static size_t parallel_min_size(size_t item_size)
+{
+	return std::max<size_t>(1, SCALING_PARALLEL_SIZE / std::max<size_t>(1, item_size));
+}
+
+/**
+ * @brief min[i] = std::min(min[i], in[i]) and max[i] = std::max(max[i], in[i]).
+ */
+static void reduce_min_max(const float *in, float *min, float *max, size_t size)
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	for (; i + AVX_256_N <= size; i += AVX_256_N)
+	{
+		__m256 __in = _mm256_loadu_ps(in + i);
+		_mm256_storeu_ps(min + i, _mm256_min_ps(__in, _mm256_loadu_ps(min + i)));
+		_mm256_storeu_ps(max + i, _mm256_max_ps(__in, _mm256_loadu_ps(max + i)));
+	}
+#endif
+	for (; i < size; i++)
+	{
+		min[i] = std::min(min[i], in[i]);
+		max[i] = std::max(max[i], in[i]);
+	}
+}
+
+/**
+ * @brief data[i] = range[i] == 0 ? 0 : (data[i] - min[i]) / range[i], range is max - min.
+ */
+static void scale_values(float *data, const float *min, const float *range, size_t size)
+{
+	size_t i = 0;
+#ifdef SMID_AVX256
+	__m256 __zero = _mm256_setzero_ps();
+	for (; i + AVX_256_N <= size; i += AVX_256_N)
+	{
+		__m256 __range = _mm256_loadu_ps(range + i);
+		__m256 __v = _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(data + i), _mm256_loadu_ps(min + i)), __range);
+		_mm256_storeu_ps(data + i, _mm256_blendv_ps(__v, __zero, _mm256_cmp_ps(__range, __zero, _CMP_EQ_OQ)));
+	}
+#endif
+	for (; i < size; i++)
+	{
+		data[i] = range[i] == 0 ? 0 : (data[i] - min[i]) / range[i];
+	}
+}
+
 //
 //	FeatureScaling
 //
 
 static RegisterClassParameter<FeatureScaling, ProcessFactory> _register_1("FeatureScaling");
 
-FeatureScaling::FeatureScaling() : TwoPassProcess(_register_1), _size(0), _min(), _max()
+FeatureScaling::FeatureScaling() : TwoPassProcess(_register_1), _size(0), _min(), _max(), _range(), _batch(), _batch_count(0),
+								   _sparse_count(), _sparse_sample_count(0), _keep_zero(false), _ready(false)
 {
 }
 
@@ -19,35 +76,144 @@ Shape FeatureScaling::compute_shape(const Shape &shape)
 	_min.fill(std::numeric_limits<float>::max());
 	_max = Tensor<float>(shape);
 	_max.fill(std::numeric_limits<float>::min());
+	_range = Tensor<float>(shape);
+	_batch = Tensor<float>(Shape({SCALING_BATCH_SIZE, _size}));
+	_batch_count = 0;
+	_sparse_count.assign(_size, 0);
+	_sparse_sample_count = 0;
+	_ready = false;
 	return shape;
 }
 
 void FeatureScaling::compute(const std::string &, const Tensor<float> &sample)
 {
-	for (size_t i = 0; i < _size; i++)
+	std::copy(sample.begin(), sample.begin() + _size, _batch.begin() + _batch_count * _size);
+	_batch_count++;
+	_ready = false;
+
+	if (_batch_count == SCALING_BATCH_SIZE)
 	{
-		_min.at_index(i) = std::min(_min.at_index(i), sample.at_index(i));
-		_max.at_index(i) = std::max(_max.at_index(i), sample.at_index(i));
+		_reduce_batch();
 	}
 }
 
-void FeatureScaling::process_train(const std::string &, Tensor<float> &sample)
+void FeatureScaling::compute_sparse(const std::string &label, const SparseTensor<float> &sample)
 {
-	//_train_scale_sample_count++; // a counter for the progress bar
-	for (size_t i = 0; i < _size; i++)
+	if (sample.default_value() != 0)
 	{
-		sample.at_index(i) = _min.at_index(i) == _max.at_index(i) ? 0 : (sample.at_index(i) - _min.at_index(i)) / (_max.at_index(i) - _min.at_index(i));
+		compute(label, from_sparse_tensor(sample));
+		return;
 	}
+
+	for (const std::pair<uint32_t, float> &entry : sample.values())
+	{
+		_min.at_index(entry.first) = std::min(_min.at_index(entry.first), entry.second);
+		_max.at_index(entry.first) = std::max(_max.at_index(entry.first), entry.second);
+		_sparse_count[entry.first]++;
+	}
+	_sparse_sample_count++;
+	_ready = false;
+}
+
+void FeatureScaling::process_train(const std::string &, Tensor<float> &sample)
+{
+	//_train_scale_sample_count++; // a counter for the progress bar
+	_update();
+	_process(sample);
 	//draw_progress(_train_scale_sample_count, get_train_count());
 }
 void FeatureScaling::process_test(const std::string &, Tensor<float> &sample)
 {
 	//_test_scale_sample_count++;  // a counter for the progress bar
+	_update();
+	_process(sample);
+	//draw_progress(_test_scale_sample_count, get_test_count());
+}
+
+void FeatureScaling::process_train_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_update();
+	_process_sparse(sample);
+}
+
+void FeatureScaling::process_test_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_update();
+	_process_sparse(sample);
+}
+
+void FeatureScaling::_reduce_batch()
+{
+	// Each thread reduces its range of features over the whole batch, the ranges don't overlap
+	const float *batch = _batch.begin();
+	size_t batch_count = _batch_count;
+	size_t size = _size;
+	float *min = _min.begin();
+	float *max = _max.begin();
+	parallel_range(size, parallel_min_size(batch_count), [batch, batch_count, size, min, max](size_t, size_t start, size_t end)
+				   {
+					   for (size_t b = 0; b < batch_count; b++)
+					   {
+						   reduce_min_max(batch + b * size + start, min + start, max + start, end - start);
+					   } });
+	_batch_count = 0;
+}
+
+void FeatureScaling::_update()
+{
+	if (_ready)
+	{
+		return;
+	}
+
+	_reduce_batch();
+
+	_keep_zero = true;
 	for (size_t i = 0; i < _size; i++)
 	{
-		sample.at_index(i) = _min.at_index(i) == _max.at_index(i) ? 0 : (sample.at_index(i) - _min.at_index(i)) / (_max.at_index(i) - _min.at_index(i));
+		if (_sparse_count[i] < _sparse_sample_count)
+		{
+			_min.at_index(i) = std::min(_min.at_index(i), 0.0f);
+			_max.at_index(i) = std::max(_max.at_index(i), 0.0f);
+		}
+		_range.at_index(i) = _max.at_index(i) - _min.at_index(i);
+		_keep_zero = _keep_zero && (_min.at_index(i) == 0 || _range.at_index(i) == 0);
 	}
-	//draw_progress(_test_scale_sample_count, get_test_count());
+	_ready = true;
+}
+
+void FeatureScaling::_process(Tensor<float> &sample)
+{
+	float *data = sample.begin();
+	const float *min = _min.begin();
+	const float *range = _range.begin();
+	parallel_range(_size, parallel_min_size(1), [data, min, range](size_t, size_t start, size_t end)
+				   { scale_values(data + start, min + start, range + start, end - start); });
+}
+
+void FeatureScaling::_process_sparse(SparseTensor<float> &sample)
+{
+	if (sample.default_value() != 0 || !_keep_zero)
+	{
+		Tensor<float> dense = from_sparse_tensor(sample);
+		_process(dense);
+		to_sparse_tensor(dense, sample);
+		return;
+	}
+
+	// The features keep 0 at 0, only the stored values change. The values scaled to 0 are dropped like in to_sparse_tensor.
+	SparseTensor<float> out(sample.shape());
+	for (const std::pair<uint32_t, float> &entry : sample.values())
+	{
+		float range = _range.at_index(entry.first);
+		float value = range == 0 ? 0 : (entry.second - _min.at_index(entry.first)) / range;
+		if (value != 0)
+		{
+			out.add_index(entry.first, value);
+		}
+	}
+	out.optimize_space();
+	sample = std::move(out);
 }
 
 //
@@ -57,7 +223,8 @@ void FeatureScaling::process_test(const std::string &, Tensor<float> &sample)
 static RegisterClassParameter<ChannelScaling, ProcessFactory> _register_2("ChannelScaling");
 
 ChannelScaling::ChannelScaling() : TwoPassProcess(_register_2),
-								   _width(0), _height(0), _depth(0), _conv_depth(0), _min(), _max()
+								   _width(0), _height(0), _depth(0), _conv_depth(0), _min(), _max(),
+								   _pixel_min(), _pixel_max(), _pixel_range(), _batch(), _batch_count(0), _sparse_zero(), _keep_zero(false), _ready(false)
 {
 }
 
@@ -71,41 +238,186 @@ Shape ChannelScaling::compute_shape(const Shape &shape)
 	_min.fill(std::numeric_limits<float>::max());
 	_max = Tensor<float>(Shape({_depth}));
 	_max.fill(std::numeric_limits<float>::min());
+	_pixel_min = Tensor<float>(Shape({_depth * _conv_depth}));
+	_pixel_min.fill(std::numeric_limits<float>::max());
+	_pixel_max = Tensor<float>(Shape({_depth * _conv_depth}));
+	_pixel_max.fill(std::numeric_limits<float>::min());
+	_pixel_range = Tensor<float>(Shape({_depth * _conv_depth}));
+	_batch = Tensor<float>(Shape({SCALING_BATCH_SIZE, shape.product()}));
+	_batch_count = 0;
+	_sparse_zero.assign(_depth, false);
+	_ready = false;
 	return shape;
 }
 
 void ChannelScaling::compute(const std::string &, const Tensor<float> &sample)
 {
-	for (size_t x = 0; x < _width; x++)
-		for (size_t y = 0; y < _height; y++)
-			for (size_t z = 0; z < _depth; z++)
-				for (size_t k = 0; k < _conv_depth; k++)
-				{
-					_min.at(z) = std::min(_min.at(z), sample.at(x, y, z, k));
-					_max.at(z) = std::max(_max.at(z), sample.at(x, y, z, k));
-				}
+	size_t size = _width * _height * _depth * _conv_depth;
+	std::copy(sample.begin(), sample.begin() + size, _batch.begin() + _batch_count * size);
+	_batch_count++;
+	_ready = false;
+
+	if (_batch_count == SCALING_BATCH_SIZE)
+	{
+		_reduce_batch();
+	}
+}
+
+void ChannelScaling::compute_sparse(const std::string &label, const SparseTensor<float> &sample)
+{
+	if (sample.default_value() != 0)
+	{
+		compute(label, from_sparse_tensor(sample));
+		return;
+	}
+
+	std::vector<size_t> count(_depth, 0);
+	for (const std::pair<uint32_t, float> &entry : sample.values())
+	{
+		size_t z = (entry.first / _conv_depth) % _depth;
+		_min.at(z) = std::min(_min.at(z), entry.second);
+		_max.at(z) = std::max(_max.at(z), entry.second);
+		count[z]++;
+	}
+
+	for (size_t z = 0; z < _depth; z++)
+	{
+		if (count[z] < _width * _height * _conv_depth)
+		{
+			_sparse_zero[z] = true;
+		}
+	}
+	_ready = false;
 }
 
 void ChannelScaling::process_train(const std::string &, Tensor<float> &sample)
 {
-	for (size_t x = 0; x < _width; x++)
-		for (size_t y = 0; y < _height; y++)
-			for (size_t z = 0; z < _depth; z++)
-				for (size_t k = 0; k < _conv_depth; k++)
-				{
-					sample.at(x, y, z, k) = _max.at(z) == _min.at(z) ? 0 : (sample.at(x, y, z, k) - _min.at(z)) / (_max.at(z) - _min.at(z));
-				}
+	_update();
+	_process(sample);
 }
 
 void ChannelScaling::process_test(const std::string &, Tensor<float> &sample)
 {
-	for (size_t x = 0; x < _width; x++)
-		for (size_t y = 0; y < _height; y++)
-			for (size_t z = 0; z < _depth; z++)
-				for (size_t k = 0; k < _conv_depth; k++)
-				{
-					sample.at(x, y, z, k) = _max.at(z) == _min.at(z) ? 0 : (sample.at(x, y, z, k) - _min.at(z)) / (_max.at(z) - _min.at(z));
-				}
+	_update();
+	_process(sample);
+}
+
+void ChannelScaling::process_train_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_update();
+	_process_sparse(sample);
+}
+
+void ChannelScaling::process_test_sparse(const std::string &, SparseTensor<float> &sample)
+{
+	_update();
+	_process_sparse(sample);
+}
+
+void ChannelScaling::_reduce_batch()
+{
+	// The values of a pixel are the channels by conv depth, each thread reduces its pixels in its own min and max, merged at the end.
+	size_t pixel_size = _depth * _conv_depth;
+	size_t pixel_number = _batch_count * _width * _height;
+	size_t thread_number = parallel_thread_number(pixel_number, parallel_min_size(pixel_size));
+	std::vector<std::vector<float>> thread_min(thread_number, std::vector<float>(_pixel_min.begin(), _pixel_min.end()));
+	std::vector<std::vector<float>> thread_max(thread_number, std::vector<float>(_pixel_max.begin(), _pixel_max.end()));
+
+	const float *batch = _batch.begin();
+	parallel_range(pixel_number, parallel_min_size(pixel_size), [batch, pixel_size, &thread_min, &thread_max](size_t thread, size_t start, size_t end)
+				   {
+					   float *min = thread_min[thread].data();
+					   float *max = thread_max[thread].data();
+					   for (size_t p = start; p < end; p++)
+					   {
+						   reduce_min_max(batch + p * pixel_size, min, max, pixel_size);
+					   } });
+
+	for (size_t t = 0; t < thread_min.size(); t++)
+	{
+		for (size_t i = 0; i < pixel_size; i++)
+		{
+			_pixel_min.at_index(i) = std::min(_pixel_min.at_index(i), thread_min[t][i]);
+			_pixel_max.at_index(i) = std::max(_pixel_max.at_index(i), thread_max[t][i]);
+		}
+	}
+	_batch_count = 0;
+}
+
+void ChannelScaling::_update()
+{
+	if (_ready)
+	{
+		return;
+	}
+
+	_reduce_batch();
+
+	_keep_zero = true;
+	for (size_t z = 0; z < _depth; z++)
+	{
+		for (size_t k = 0; k < _conv_depth; k++)
+		{
+			_min.at(z) = std::min(_min.at(z), _pixel_min.at(z * _conv_depth + k));
+			_max.at(z) = std::max(_max.at(z), _pixel_max.at(z * _conv_depth + k));
+		}
+		if (_sparse_zero[z])
+		{
+			_min.at(z) = std::min(_min.at(z), 0.0f);
+			_max.at(z) = std::max(_max.at(z), 0.0f);
+		}
+
+		float range = _max.at(z) - _min.at(z);
+		for (size_t k = 0; k < _conv_depth; k++)
+		{
+			_pixel_min.at(z * _conv_depth + k) = _min.at(z);
+			_pixel_max.at(z * _conv_depth + k) = _max.at(z);
+			_pixel_range.at(z * _conv_depth + k) = range;
+		}
+		_keep_zero = _keep_zero && (_min.at(z) == 0 || range == 0);
+	}
+	_ready = true;
+}
+
+void ChannelScaling::_process(Tensor<float> &sample)
+{
+	size_t pixel_size = _depth * _conv_depth;
+	float *data = sample.begin();
+	const float *min = _pixel_min.begin();
+	const float *range = _pixel_range.begin();
+	parallel_range(_width * _height, parallel_min_size(pixel_size), [data, min, range, pixel_size](size_t, size_t start, size_t end)
+				   {
+					   for (size_t p = start; p < end; p++)
+					   {
+						   scale_values(data + p * pixel_size, min, range, pixel_size);
+					   } });
+}
+
+void ChannelScaling::_process_sparse(SparseTensor<float> &sample)
+{
+	if (sample.default_value() != 0 || !_keep_zero)
+	{
+		Tensor<float> dense = from_sparse_tensor(sample);
+		_process(dense);
+		to_sparse_tensor(dense, sample);
+		return;
+	}
+
+	// The channels keep 0 at 0, only the stored values change. The values scaled to 0 are dropped like in to_sparse_tensor.
+	size_t pixel_size = _depth * _conv_depth;
+	SparseTensor<float> out(sample.shape());
+	for (const std::pair<uint32_t, float> &entry : sample.values())
+	{
+		size_t c = entry.first % pixel_size;
+		float range = _pixel_range.at(c);
+		float value = range == 0 ? 0 : (entry.second - _pixel_min.at(c)) / range;
+		if (value != 0)
+		{
+			out.add_index(entry.first, value);
+		}
+	}
+	out.optimize_space();
+	sample = std::move(out);
 }
 
 //
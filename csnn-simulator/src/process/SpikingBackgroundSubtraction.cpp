@@ -8,20 +8,95 @@ using namespace process;
 #include <opencv2/videoio.hpp>
 #include <opencv2/video.hpp>
 
+//
+//	SpikingBackgroundModel
+//
+
+SpikingBackgroundModel::SpikingBackgroundModel() : SpikingBackgroundModel(Shape({0, 0, 0}))
+{
+}
+
+SpikingBackgroundModel::SpikingBackgroundModel(const Shape &shape, Time decay, Time threshold, size_t lifetime) : _shape(shape), _decay(decay), _threshold(threshold), _lifetime(lifetime),
+																													_frame(lifetime + 1), _background(shape.product(), INFINITE_TIME), _last_frame(shape.product(), 0)
+{
+	if (decay <= 0 || decay > 1)
+	{
+		throw std::runtime_error("SpikingBackgroundModel: decay must be in (0, 1]");
+	}
+}
+
+void SpikingBackgroundModel::reset()
+{
+	// All the last frames become older than the lifetime
+	_frame += _lifetime + 1;
+}
+
+bool SpikingBackgroundModel::update(size_t pixel, Time time, Time &difference)
+{
+	uint64_t &last_frame = _last_frame[pixel];
+	if (last_frame == _frame)
+	{
+		return false;
+	}
+
+	Time &background = _background[pixel];
+	bool valid = _frame - last_frame <= _lifetime;
+	last_frame = _frame;
+
+	if (!valid)
+	{
+		background = time;
+		return false;
+	}
+
+	difference = time - background;
+	background = (1.0f - _decay) * background + _decay * time;
+	return difference > _threshold || difference < -_threshold;
+}
+
+void SpikingBackgroundModel::next_frame()
+{
+	_frame++;
+}
+
+void SpikingBackgroundModel::process_frame(const std::vector<Spike> &in, std::vector<Spike> &out, bool split)
+{
+	for (const Spike &spike : in)
+	{
+		Time difference;
+		if (update(_shape.to_index(spike.x, spike.y, spike.z), spike.time, difference))
+		{
+			uint16_t k = split ? 2 * spike.k + (difference < 0 ? 1 : 0) : spike.k;
+			out.emplace_back(std::abs(difference), spike.x, spike.y, spike.z, k);
+		}
+	}
+	next_frame();
+}
+
+const Shape &SpikingBackgroundModel::shape() const
+{
+	return _shape;
+}
+
 //
 //	SpikingBackgroundSubtraction
 //
 static RegisterClassParameter<SpikingBackgroundSubtraction, ProcessFactory> _register_1("SpikingBackgroundSubtraction");
 
-SpikingBackgroundSubtraction::SpikingBackgroundSubtraction() : UniquePassProcess(_register_1), _width(0), _height(0), _depth(0), _conv_depth(0), _expName(""), _method(0), _threshold(0)
+SpikingBackgroundSubtraction::SpikingBackgroundSubtraction() : UniquePassProcess(_register_1), _width(0), _height(0), _depth(0), _conv_depth(0), _expName(""), _method(0), _threshold(0),
+															   _decay(1.0f), _lifetime(1), _model(), _frame_spikes()
 {
 	add_parameter("threshold", _threshold);
+	add_parameter("decay", _decay);
+	add_parameter("lifetime", _lifetime);
 }
-SpikingBackgroundSubtraction::SpikingBackgroundSubtraction(std::string expName, size_t method, size_t threshold) : SpikingBackgroundSubtraction()
+SpikingBackgroundSubtraction::SpikingBackgroundSubtraction(std::string expName, size_t method, size_t threshold, float decay, size_t lifetime) : SpikingBackgroundSubtraction()
 {
 	parameter<size_t>("threshold").set(threshold);
 	_expName = expName;
 	_method = method;
+	parameter<float>("decay").set(decay);
+	parameter<size_t>("lifetime").set(lifetime);
 }
 
 void SpikingBackgroundSubtraction::process_train(const std::string &label, Tensor<float> &sample)
@@ -41,72 +116,63 @@ Shape SpikingBackgroundSubtraction::compute_shape(const Shape &shape)
 	_depth = shape.dim(2);
 	_conv_depth = _method == 0 ? shape.dim(3) * 2 : shape.dim(3);
 
+	_model = SpikingBackgroundModel(Shape({_height, _width, _depth}), _decay, static_cast<Time>(_threshold), _lifetime);
+	_frame_spikes.assign(shape.dim(3), std::vector<std::pair<size_t, Time>>());
+
 	return Shape({_height, _width, _depth, _conv_depth});
 }
 
-void SpikingBackgroundSubtraction::_process(const std::string &label, Tensor<Time> &in) const
+void SpikingBackgroundSubtraction::_process(const std::string &, Tensor<Time> &in)
 {
-	Tensor<Time> out(Shape({_height, _width, _depth, _conv_depth}));
+	size_t frame_number = in.shape().dim(3);
+	size_t pixel_number = in.shape().product() / frame_number;
 
-	// A tensor to recive the 3D time tensors
-	std::vector<Tensor<Time>> time_tensors_in;
-	std::vector<Tensor<Time>> time_tensors_out;
-	// This function seperates one 4D time tensors into multiple 3D time tensors
-	Tensor<Time>::time_tensor_to_tensors(in, time_tensors_in);
+	// The spikes of each frame in a single pass over the sample, the pixels at INFINITE_TIME don't spike
+	for (std::vector<std::pair<size_t, Time>> &spikes : _frame_spikes)
+	{
+		spikes.clear();
+	}
+	const Time *data = in.begin();
+	for (size_t pixel = 0; pixel < pixel_number; pixel++, data += frame_number)
+	{
+		for (size_t f = 0; f < frame_number; f++)
+		{
+			if (data[f] != INFINITE_TIME)
+			{
+				_frame_spikes[f].emplace_back(pixel, data[f]);
+			}
+		}
+	}
 
-	time_tensors_in.push_back(time_tensors_in[0]);
+	// Each frame is compared to the background left by the previous ones, the changes of the frame f are written in the output frame f - 1.
+	// The first frame is compared again after the last one.
+	Tensor<Time> out(Shape({_height, _width, _depth, _conv_depth}));
+	out.fill(INFINITE_TIME);
+	Time *out_data = out.begin();
 
-	size_t size = time_tensors_in[0].shape().product();
-	for (size_t _i = 0; _i < time_tensors_in.size() - 1; _i++)
+	_model.reset();
+	for (size_t f = 0; f <= frame_number; f++)
 	{
-		Tensor<Time> t1 = time_tensors_in[_i];
-		Tensor<Time> t2 = time_tensors_in[_i + 1];
-		// The splitted positive and negative time changes
-		Tensor<Time> t1_out(Shape({_height, _width, _depth, 1}));
-		Tensor<Time> t2_out(Shape({_height, _width, _depth, 1}));
-		if (_method == 0)
+		const std::vector<std::pair<size_t, Time>> &spikes = _frame_spikes[f % frame_number];
+		for (const std::pair<size_t, Time> &spike : spikes)
 		{
-			for (size_t i = 0; i < size; i++)
+			Time difference;
+			if (_model.update(spike.first, spike.second, difference) && f > 0)
 			{
-				Time t = t2.at_index(i) - t1.at_index(i);
-
-				if (t > 0)
-				{
-					t1_out.at_index(i) = t;
-					t2_out.at_index(i) = INFINITE_TIME;
-				}
-				else if (t < 0)
+				if (_method == 0)
 				{
-					t1_out.at_index(i) = INFINITE_TIME;
-					t2_out.at_index(i) = -t;
+					out_data[spike.first * _conv_depth + 2 * (f - 1) + (difference < 0 ? 1 : 0)] = std::abs(difference);
 				}
 				else
 				{
-					t1_out.at_index(i) = INFINITE_TIME;
-					t2_out.at_index(i) = INFINITE_TIME;
+					out_data[spike.first * _conv_depth + f - 1] = std::abs(difference);
 				}
 			}
-			time_tensors_out.push_back(t1_out);
-			time_tensors_out.push_back(t2_out);
-		}
-		if (_method == 1)
-		{
-			for (size_t i = 0; i < size; i++)
-			{
-				Time t = t2.at_index(i) - t1.at_index(i);
-
-				if (t > 0)
-					t1_out.at_index(i) = t;
-				else if (t < 0)
-					t1_out.at_index(i) = std::abs(t);
-				else
-					t1_out.at_index(i) = INFINITE_TIME;
-			}
-			time_tensors_out.push_back(t1_out);
 		}
+		_model.next_frame();
 	}
-	Tensor<Time>::time_tensors_to_tensor(time_tensors_out, out);
-	in = out;
+
+	in = std::move(out);
 }
 
 // void SpikingBackgroundSubtraction::_process(const std::string &label, Tensor<Time> &in) const
@@ -31,23 +31,25 @@ void Whitening::process_train(const std::string&, Tensor<float>& sample) {
 		size_t rows = _list.front().shape().product();
 		size_t cols = _list.size();
 
-		Tensor<float> x(Shape({rows, cols}));
-
-		for(size_t i=0; i<rows; i++) {
-			for(size_t j=0; j<cols; j++) {
-				x.at(i, j) = _list[j].at_index(i);
-			}
+		// The samples are the rows of x_t, x is its blocked transpose
+		Tensor<float> x_t(Shape({cols, rows}));
+		for(size_t j=0; j<cols; j++) {
+			std::copy(_list[j].begin(), _list[j].end(), x_t.begin()+j*rows);
 		}
 
 		_list.clear();
 		_list.shrink_to_fit();
+
+		Tensor<float> x;
+		transpose(x_t, x);
+		x_t = Tensor<float>();
 		//debug_tensor(x ,"X");
 		_mean = mean1(x);
 		//debug_tensor(_mean ,"Mean");
-		x = x-expand_in(_mean, Shape({cols}));
+		sub_expand_in(x, _mean);
 		//debug_tensor(x ,"X_center");
 
-		Tensor<float> cov = transpose(dot(x, transpose(x))/create(cols, Shape({rows, rows})));
+		Tensor<float> cov = dot_transpose(x, x, 1.0f/static_cast<float>(cols));
 		//debug_tensor(cov, "Cov");
 		Tensor<float> u(Shape({rows, rows}));
 		//Tensor<float> v(Shape({rows, rows}));
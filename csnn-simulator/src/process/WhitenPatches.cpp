@@ -5,7 +5,7 @@ using namespace process;
 static RegisterClassParameter<WhiteningPatches, ProcessFactory> _register("WhiteningPatches");
 
 WhiteningPatches::WhiteningPatches() : TwoPassProcess(_register), _eps(0), _pca_compress(0),
-	_patch_size(0), _stride(1), _max_sample(), _list(), _filter() {
+	_patch_size(0), _stride(1), _max_sample(), _filename(), _count(0), _shift(), _sum(), _gram(), _batch(), _whitening(), _filter() {
 	add_parameter("eps", _eps);
 	add_parameter("pca_compress", _pca_compress);
 	add_parameter("patch_size", _patch_size);
@@ -13,12 +13,13 @@ WhiteningPatches::WhiteningPatches() : TwoPassProcess(_register), _eps(0), _pca_
 	add_parameter("max_sample", _max_sample);
 }
 
-WhiteningPatches::WhiteningPatches(size_t patch_size, float eps, float pca_compress, size_t stride, size_t max_sample) : WhiteningPatches() {
+WhiteningPatches::WhiteningPatches(size_t patch_size, float eps, float pca_compress, size_t stride, size_t max_sample, const std::string& filename) : WhiteningPatches() {
 	parameter<float>("eps").set(eps);
 	parameter<float>("pca_compress").set(pca_compress);
 	parameter<size_t>("patch_size").set(patch_size);
 	parameter<size_t>("stride").set(stride);
 	parameter<size_t>("max_sample").set(max_sample);
+	_filename = filename;
 }
 
 Shape WhiteningPatches::compute_shape(const Shape& shape) {
@@ -32,96 +33,160 @@ void WhiteningPatches::compute(const std::string&, const Tensor<float>& sample)
 	size_t width = sample.shape().dim(0);
 	size_t height = sample.shape().dim(1);
 	size_t depth = sample.shape().dim(2);
-	if(_list.size() < _max_sample) {
-		Tensor<float> patch(Shape({_patch_size, _patch_size, depth}));
+	size_t patch_row = _patch_size*depth;
+	size_t patch_size = _patch_size*patch_row;
+
+	if(_count < _max_sample) {
+		if(_count == 0) {
+			_shift.assign(patch_size, 0);
+			_sum.assign(patch_size, 0);
+			_gram = Tensor<float>(Shape({patch_size, patch_size}));
+			_gram.fill(0);
+			_batch.reserve(WHITEN_PATCHES_BATCH_SIZE*patch_size);
+		}
+
 		for(size_t x=0; x<width-_patch_size+1; x+=_stride) {
 			for(size_t y=0; y<height-_patch_size+1; y+=_stride) {
-
+				// The values of a row fx of the patch, (fy, fz), are contiguous in the sample
 				for(size_t fx=0; fx<_patch_size; fx++) {
-					for(size_t fy=0; fy<_patch_size; fy++) {
-						for(size_t fz=0; fz<depth; fz++) {
-							patch.at(fx, fy, fz) = sample.at(x+fx, y+fy, fz);
-						}
+					const float* row = sample.begin()+((x+fx)*height+y)*depth;
+					if(_count == 0) {
+						std::copy(row, row+patch_row, _shift.begin()+fx*patch_row);
+					}
+					for(size_t i=0; i<patch_row; i++) {
+						_batch.push_back(row[i]-_shift[fx*patch_row+i]);
 					}
 				}
 
-				_list.emplace_back(patch);
+				_count++;
+				if(_batch.size() == WHITEN_PATCHES_BATCH_SIZE*patch_size) {
+					_update();
+				}
 			}
 		}
-
-
 	}
 }
 
 void WhiteningPatches::process_train(const std::string&, Tensor<float>& sample) {
-	size_t depth = sample.shape().dim(2);
-
-	if(!_list.empty()) {
-		size_t rows = _list.front().shape().product();
-		size_t cols = _list.size();
-
-		Tensor<float> x(Shape({rows, cols}));
+	if(_count > 0) {
+		_compute_filters(sample.shape().dim(2));
 
-		for(size_t i=0; i<rows; i++) {
-			for(size_t j=0; j<cols; j++) {
-				x.at(i, j) = _list[j].at_index(i);
-			}
+		if(!_filename.empty()) {
+			save(_filename);
 		}
+	}
 
-		_list.clear();
-		_list.shrink_to_fit();
+	_apply(sample);
+}
 
-		Tensor<float> x_mean = mean1(x);
-		x = x-expand_in(x_mean, Shape({cols}));
+void WhiteningPatches::_update() {
+	size_t patch_size = _shift.size();
+	size_t n = _batch.size()/patch_size;
+	if(n == 0) {
+		return;
+	}
 
-		Tensor<float> cov = transpose(dot(x, transpose(x))/create(cols, Shape({rows, rows})));
+	cblas_ssyrk(CblasRowMajor, CblasUpper, CblasTrans, patch_size, n, 1.0, _batch.data(), patch_size, 1.0, _gram.begin(), patch_size);
 
-		Tensor<float> u(Shape({rows, rows}));
-		//Tensor<float> v(Shape({rows, rows}));
-		Tensor<float> s(Shape({rows}));
+	for(size_t j=0; j<n; j++) {
+		const float* patch = _batch.data()+j*patch_size;
+		for(size_t i=0; i<patch_size; i++) {
+			_sum[i] += patch[i];
+		}
+	}
+	_batch.clear();
+}
 
-		int m = rows;
-		int n = rows;
-		int lda = rows;
-		int ldu = rows;
-		int ldvt = rows;
-		int lwork = -1;
+void WhiteningPatches::_compute_filters(size_t depth) {
+	_update();
 
-		int info;
-		float tmp_work;
-		sgesvd_("A", "N", &m, &n, cov.begin(), &lda, s.begin(), u.begin(), &ldu, nullptr, &ldvt, &tmp_work, &lwork, &info);
-		lwork = tmp_work;
-		if(info != 0) {
-			throw std::runtime_error("Error in sgesvd_ (1):"+std::to_string(info));
-		}
-		Tensor<float> work(Shape({lwork}));
-		sgesvd_("A", "N", &m, &n, cov.begin(), &lda, s.begin(), u.begin(), &ldu, nullptr, &ldvt, work.begin(), &lwork, &info);
-		if(info != 0) {
-			throw std::runtime_error("Error in sgesvd_ (2):"+std::to_string(info));
-		}
+	size_t rows = _shift.size();
 
-		size_t start_compress = static_cast<float>(rows)*_pca_compress;
-		for(size_t i=start_compress; i<rows; i++) {
-			//std::cout << i << ":" << s.at(i) << "-> 0" << std::endl;
-			//s.at(i) = 0;
-			for(size_t j=0; j<rows; j++) {
-				u.at(i, j) = 0;
-			}
+	// cov = E[(p-shift)(p-shift)^T]-(mean-shift)(mean-shift)^T, in the upper triangle
+	std::vector<float> shifted_mean(rows);
+	for(size_t i=0; i<rows; i++) {
+		shifted_mean[i] = _sum[i]/static_cast<double>(_count);
+	}
+	Tensor<float> cov(Shape({rows, rows}));
+	cov.fill(0);
+	for(size_t i=0; i<rows; i++) {
+		for(size_t j=i; j<rows; j++) {
+			cov.at(i, j) = _gram.at(i, j)/static_cast<float>(_count)-shifted_mean[i]*shifted_mean[j];
 		}
+	}
 
-		Tensor<float> w = transpose(dot(transpose(u), dot(diag(create(1.0, Shape({rows}))/sqrt(s+create(_eps, Shape({rows})))), u)));
+	_count = 0;
+	_shift.clear();
+	_sum.clear();
+	_gram = Tensor<float>();
+	_batch.clear();
+	_batch.shrink_to_fit();
+
+	// The upper triangle in row major order is the lower one for LAPACK.
+	// The eigenvalues are in ascending order, and the eigenvector i is the row i of cov.
+	Tensor<float> s(Shape({rows}));
+
+	char jobz = 'V';
+	char uplo = 'L';
+	int n = rows;
+	int lda = rows;
+	int lwork = -1;
+	int liwork = -1;
+
+	int info;
+	float tmp_work;
+	int tmp_iwork;
+	ssyevd_(&jobz, &uplo, &n, cov.begin(), &lda, s.begin(), &tmp_work, &lwork, &tmp_iwork, &liwork, &info);
+	lwork = tmp_work;
+	liwork = tmp_iwork;
+	if(info != 0) {
+		throw std::runtime_error("Error in ssyevd_ (1):"+std::to_string(info));
+	}
+	std::vector<float> work(lwork);
+	std::vector<int> iwork(liwork);
+	ssyevd_(&jobz, &uplo, &n, cov.begin(), &lda, s.begin(), work.data(), &lwork, iwork.data(), &liwork, &info);
+	if(info != 0) {
+		throw std::runtime_error("Error in ssyevd_ (2):"+std::to_string(info));
+	}
 
-		for(size_t z=0; z<depth; z++) {
-			Tensor<float> inpulse(Shape({_patch_size, _patch_size, depth}));
-			inpulse.fill(0);
-			inpulse.at(_patch_size/2, _patch_size/2, z) = 1.0;
+	// Same components as the singular values of the covariance, in decreasing order of magnitude
+	std::vector<size_t> order(rows);
+	std::iota(std::begin(order), std::end(order), 0);
+	std::stable_sort(std::begin(order), std::end(order), [&s](size_t i1, size_t i2) {
+		return std::abs(s.at(i1)) > std::abs(s.at(i2));
+	});
+
+	// w = sum_i u_i u_i^T/sqrt(s_i+eps) over the kept components, computed as y^T y with y_i = u_i/(s_i+eps)^(1/4)
+	size_t start_compress = static_cast<float>(rows)*_pca_compress;
+	start_compress = std::min(start_compress, rows);
+	Tensor<float> y(Shape({std::max<size_t>(start_compress, 1), rows}));
+	y.fill(0);
+	for(size_t i=0; i<start_compress; i++) {
+		float scale = 1.0/std::sqrt(std::sqrt(std::abs(s.at(order[i]))+_eps));
+		for(size_t j=0; j<rows; j++) {
+			y.at(i, j) = cov.at(order[i], j)*scale;
+		}
+	}
 
-			Tensor<float> response = reshape(dot(flatten(inpulse), w), inpulse.shape());
-			_filter.push_back(response-create(mean(response), response.shape()));
+	_whitening = Tensor<float>(Shape({rows, rows}));
+	_whitening.fill(0);
+	if(start_compress > 0) {
+		cblas_ssyrk(CblasRowMajor, CblasUpper, CblasTrans, rows, start_compress, 1.0, y.begin(), rows, 0.0, _whitening.begin(), rows);
+	}
+	for(size_t i=0; i<rows; i++) {
+		for(size_t j=0; j<i; j++) {
+			_whitening.at(i, j) = _whitening.at(j, i);
 		}
 	}
 
-	_apply(sample);
+	// The filter z is the response of the whitening to an impulse in the center of the channel z
+	_filter.clear();
+	for(size_t z=0; z<depth; z++) {
+		Tensor<float> response(Shape({_patch_size, _patch_size, depth}));
+		size_t center = ((_patch_size/2)*_patch_size+_patch_size/2)*depth+z;
+		std::copy(_whitening.begin()+center*rows, _whitening.begin()+(center+1)*rows, response.begin());
+		_filter.push_back(response-create(mean(response), response.shape()));
+	}
 }
 
 void WhiteningPatches::process_test(const std::string&, Tensor<float>& sample) {
@@ -173,6 +238,13 @@ void WhiteningPatches::save(const std::string& filename) const {
 	for(size_t i=0; i<_filter.size(); i++) {
 		Persistence::save_tensor(_filter[i], file);
 	}
+	if(_whitening.shape().number() > 0) {
+		Persistence::save_tensor(_whitening, file);
+	}
 
 	file.close();
 }
+
+const Tensor<float>& WhiteningPatches::whitening() const {
+	return _whitening;
+}
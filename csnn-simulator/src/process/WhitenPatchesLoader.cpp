@@ -5,7 +5,7 @@ using namespace process;
 static RegisterClassParameter<WhitenPatchesLoader, ProcessFactory> _register("WhitenPatchesLoader");
 
 WhitenPatchesLoader::WhitenPatchesLoader() : UniquePassProcess(_register), _eps(0), _pca_compress(0),
-	_patch_size(0), _stride(1), _max_sample(), _filter() {
+	_patch_size(0), _stride(1), _max_sample(), _whitening(), _filter() {
 	add_parameter("eps", _eps);
 	add_parameter("pca_compress", _pca_compress);
 	add_parameter("patch_size", _patch_size);
@@ -42,6 +42,11 @@ WhitenPatchesLoader::WhitenPatchesLoader(const std::string& filename) : WhitenPa
 		_filter.push_back(Persistence::load_tensor<float>(file));
 	}
 
+	// The files saved before the whitening matrix end after the filters
+	if(file.peek() != std::ifstream::traits_type::eof()) {
+		_whitening = Persistence::load_tensor<float>(file);
+	}
+
 	file.close();
 }
 
@@ -49,6 +54,10 @@ Shape WhitenPatchesLoader::compute_shape(const Shape& shape) {
 	return shape;
 }
 
+const Tensor<float>& WhitenPatchesLoader::whitening() const {
+	return _whitening;
+}
+
 void WhitenPatchesLoader::process_train(const std::string&, Tensor<float>& sample) {
 	_apply(sample);
 }
@@ -20,6 +20,11 @@ float Biological::process(float w, const Time pre, Time post) {
 	return std::max<float>(0, std::min<float>(1, v));
 }
 
+// exp(-(INFINITE_TIME-post)/tau) underflows to 0, so a synapse that did not fire keeps its weight.
+float Biological::process_silent(float w, uint32_t) {
+	return std::max<float>(0, std::min<float>(1, w));
+}
+
 void Biological::adapt_parameters(float factor) {
 	_alpha *= factor;
 }
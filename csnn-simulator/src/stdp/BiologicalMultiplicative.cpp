@@ -23,6 +23,10 @@ float BiologicalMultiplicative::process(float w, const Time pre, Time post) {
 	return std::max<float>(0, std::min<float>(1, v));
 }
 
+float BiologicalMultiplicative::process_silent(float w, uint32_t) {
+	return std::max<float>(0, std::min<float>(1, w));
+}
+
 void BiologicalMultiplicative::adapt_parameters(float factor) {
 	_alpha *= factor;
 }
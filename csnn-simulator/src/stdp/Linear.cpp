@@ -21,6 +21,10 @@ float Linear::process(float w, const Time pre, Time post) {
 	return std::max<float>(0, std::min<float>(1, v));
 }
 
+float Linear::process_silent(float w, uint32_t count) {
+	return count == 0 ? w : std::max<float>(0, std::min<float>(1, w-static_cast<float>(count)*_alpha_m));
+}
+
 void Linear::adapt_parameters(float factor) {
 	_alpha_p *= factor;
 	_alpha_m *= factor;
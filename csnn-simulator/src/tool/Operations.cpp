@@ -1,4 +1,6 @@
 #include "tool/Operations.h"
+#include <memory>
+#include <mutex>
 
 /**
  * @brief This function re-loads the descriptors that are previously saved using the SavePairVector.
@@ -17,52 +19,23 @@ static std::vector<std::tuple<size_t, size_t, size_t, size_t>> spike_coordinates
 
 void LoadPairVector(std::string fileName, std::vector<std::pair<std::string, Tensor<float>>> &output)
 {
-    // std::ifstream _jsonTextFile;
-    // _jsonTextFile.open(fileName, std::ifstream::in);
-    // std::string _jsonText;
-    // std::getline(_jsonTextFile, _jsonText);
-    // _jsonTextFile.close();
-
-    std::ifstream _jsonTextFile(fileName);
-    std::stringstream buffer;
-    buffer << _jsonTextFile.rdbuf();
-    std::string _jsonText;
-    _jsonText = buffer.str();
-
-    DynamicJsonDocument doc(JSON_ARRAY_SIZE(_jsonText.length()));
-    DeserializationError error = deserializeJson(doc, _jsonText.c_str());
-    // Test if parsing succeeds.
-    if (error)
+    if (FeatureStoreReader::is_feature_store(fileName))
     {
-        ASSERT_DEBUG("JSON PARSE FAILED");
+        LoadFeatureStore(fileName, output);
+        return;
     }
-    for (std::size_t _s = 0; _s < doc.size(); ++_s)
-    {
-        std::vector<float> _fusedSampleVector;
-        std::string _data = doc[_s]["data"];
-        std::string _label = doc[_s]["label"];
-        std::replace(_data.begin(), _data.end(), ',', ' ');
-        std::remove(_data.begin(), _data.end(), '[');
-        std::remove(_data.begin(), _data.end(), ']');
-
-        std::stringstream iss(_data);
 
-        float number;
-
-        while (iss >> number)
-            _fusedSampleVector.push_back(number);
-
-        std::vector<size_t> temp_dims = {};
-        for (size_t i = 0; i < 4; i++)
-            temp_dims.push_back(doc[_s]["dim_" + std::to_string(i)]);
-
-        Tensor<float> _fusedSample = Tensor<float>(Shape(temp_dims));
-
-        for (size_t i = 0; i < _fusedSampleVector.size(); i++)
-            _fusedSample.at_index(i) = _fusedSampleVector[i];
+    // The JSON files are parsed one sample at a time, the whole document is never loaded.
+    JsonFeatureReader reader(fileName);
+    while (reader.has_next())
+        output.emplace_back(reader.next());
+}
 
-        output.push_back(std::make_pair(_label, _fusedSample));
-    }
+std::unique_ptr<Input> OpenFeatureReader(const std::string &fileName)
+{
+    if (FeatureStoreReader::is_feature_store(fileName))
+        return std::make_unique<FeatureStoreReader>(fileName);
+    return std::make_unique<JsonFeatureReader>(fileName);
 }
 
 // void LoadPairVector(std::string fileName, std::vector<std::pair<std::string, Tensor<float>>> &output)
@@ -339,41 +312,7 @@ void SaveString(std::string fileName, std::string stringToSave)
  */
 void SavePairVector(std::string fileName, std::vector<std::pair<std::string, SparseTensor<float>>> sparseOutput)
 {
-    std::ofstream _jsonTextFile;
-    _jsonTextFile.open(fileName, std::ios_base::app);
-    std::string JSON_output;
-    std::string type_Name;
-    _jsonTextFile << "[";
-
-    for (std::size_t i = 0; i < sparseOutput.size(); ++i)
-    {
-        Tensor<float> output = from_sparse_tensor(sparseOutput[i].second);
-        DynamicJsonDocument doc(JSON_ARRAY_SIZE(sparseOutput[i].second.shape().product() + sparseOutput[i].second.shape().number() + 3));
-
-        doc["label"] = sparseOutput[i].first;
-
-        size_t size = sparseOutput[i].second.shape().product();
-
-        uint8_t dim_number = sparseOutput[i].second.shape().number();
-        for (size_t _j = 0; _j < dim_number; _j++)
-        {
-            type_Name = "dim_" + std::to_string(_j);
-            doc[type_Name] = sparseOutput[i].second.shape().dim(_j);
-        }
-
-        for (size_t _j = 0; _j < size; _j++)
-        {
-            doc["data"][_j] = output.at_index(_j);
-        }
-        serializeJson(doc, JSON_output);
-
-        _jsonTextFile << JSON_output;
-        if (i != sparseOutput.size() - 1)
-            _jsonTextFile << ",";
-        JSON_output = "";
-    }
-    _jsonTextFile << "]";
-    _jsonTextFile.close();
+    SaveFeatureStore(fileName, sparseOutput);
 }
 
 /**
@@ -384,42 +323,20 @@ void SavePairVector(std::string fileName, std::vector<std::pair<std::string, Spa
  */
 void SaveInputPairVector(std::string fileName, std::vector<std::pair<std::string, SparseTensor<float>>> sparseOutput)
 {
-    std::ofstream _jsonTextFile;
-    _jsonTextFile.open(fileName, std::ios_base::app);
-    std::string JSON_output;
-    std::string type_Name;
-    _jsonTextFile << "[";
+    if (sparseOutput.empty())
+        return;
 
-    for (std::size_t i = 0; i < sparseOutput.size(); ++i)
+    // Same normalization as Tensor<float>::normalize_tensor, applied to the stored values only.
+    const float scale = static_cast<float>(std::numeric_limits<uint8_t>::max());
+    FeatureStoreWriter writer(fileName, sparseOutput[0].second.shape());
+    for (const std::pair<std::string, SparseTensor<float>> &entry : sparseOutput)
     {
-        Tensor<float> output = from_sparse_tensor(sparseOutput[i].second);
-        Tensor<float>::normalize_tensor(output);
-        DynamicJsonDocument doc(JSON_ARRAY_SIZE(sparseOutput[i].second.shape().product() + sparseOutput[i].second.shape().number() + 3));
-
-        doc["label"] = sparseOutput[i].first;
-
-        size_t size = sparseOutput[i].second.shape().product();
-
-        uint8_t dim_number = sparseOutput[i].second.shape().number();
-        for (size_t _j = 0; _j < dim_number; _j++)
-        {
-            type_Name = "dim_" + std::to_string(_j);
-            doc[type_Name] = sparseOutput[i].second.shape().dim(_j);
-        }
-
-        for (size_t _j = 0; _j < size; _j++)
-        {
-            doc["data"][_j] = output.at_index(_j);
-        }
-        serializeJson(doc, JSON_output);
-
-        _jsonTextFile << JSON_output;
-        if (i != sparseOutput.size() - 1)
-            _jsonTextFile << ",";
-        JSON_output = "";
+        SparseTensor<float> normalized(entry.second.shape(), entry.second.default_value() / scale);
+        for (const std::pair<uint32_t, float> &value : entry.second.values())
+            normalized.add_index(value.first, value.second / scale);
+        writer.write(entry.first, normalized);
     }
-    _jsonTextFile << "]";
-    _jsonTextFile.close();
+    writer.close();
 }
 
 /**
@@ -430,34 +347,11 @@ void SaveInputPairVector(std::string fileName, std::vector<std::pair<std::string
  */
 void SaveTimeTensor(std::string fileName, Tensor<Time> time_output)
 {
-    std::ofstream _jsonTextFile;
-    _jsonTextFile.open(fileName, std::ios_base::app);
-    std::string JSON_output;
-    std::string type_Name;
-
-    DynamicJsonDocument doc(JSON_ARRAY_SIZE(time_output.shape().product() + time_output.shape().number() + 3));
-
-    // doc["label"] = "";
-
-    size_t size = time_output.shape().product();
-
-    uint8_t dim_number = time_output.shape().number();
-    for (size_t _j = 0; _j < dim_number; _j++)
-    {
-        type_Name = "dim_" + std::to_string(_j);
-        doc[type_Name] = time_output.shape().dim(_j);
-    }
-
-    for (size_t _j = 0; _j < size; _j++)
-    {
-        doc["data"][_j] = time_output.at_index(_j);
-    }
-    serializeJson(doc, JSON_output);
-
-    _jsonTextFile << JSON_output;
-    _jsonTextFile << ",";
-
-    _jsonTextFile.close();
+    // Each call adds a tensor to the file, as the JSON version did.
+    FeatureStoreWriter writer;
+    writer.append(fileName, time_output.shape());
+    writer.write("", time_output);
+    writer.close();
 }
 
 /**
@@ -468,41 +362,19 @@ void SaveTimeTensor(std::string fileName, Tensor<Time> time_output)
  */
 void SaveFeature(std::string fileName, std::string label, Tensor<float> time_output, size_t sample_index, size_t total_sample_nbr)
 {
-    std::ofstream _jsonTextFile;
-    _jsonTextFile.open(fileName, std::ios_base::app);
-    std::string JSON_output;
-    std::string type_Name;
+    // One writer per file, kept open between the samples. The train and test sets of several SaveFeatures can be saved at the same time.
+    static std::map<std::string, std::unique_ptr<FeatureStoreWriter>> _writers;
+    static std::mutex _writers_mutex;
 
-    if (sample_index == 1)
-        _jsonTextFile << "[";
+    std::lock_guard<std::mutex> lock(_writers_mutex);
+    std::unique_ptr<FeatureStoreWriter> &writer = _writers[fileName];
+    if (sample_index == 1 || !writer)
+        writer.reset(new FeatureStoreWriter(fileName, time_output.shape()));
 
-    DynamicJsonDocument doc(JSON_ARRAY_SIZE(time_output.shape().product() + time_output.shape().number() + 3));
-
-    doc["label"] = label;
-
-    size_t size = time_output.shape().product();
-
-    uint8_t dim_number = time_output.shape().number();
-    for (size_t _j = 0; _j < dim_number; _j++)
-    {
-        type_Name = "dim_" + std::to_string(_j);
-        doc[type_Name] = time_output.shape().dim(_j);
-    }
-
-    for (size_t _j = 0; _j < size; _j++)
-    {
-        doc["data"][_j] = time_output.at_index(_j);
-    }
-    serializeJson(doc, JSON_output);
-
-    _jsonTextFile << JSON_output;
-    if (sample_index != total_sample_nbr)
-        _jsonTextFile << ",";
+    writer->write(label, time_output);
 
     if (sample_index == total_sample_nbr)
-        _jsonTextFile << "]";
-
-    _jsonTextFile.close();
+        _writers.erase(fileName);
 }
 
 /**
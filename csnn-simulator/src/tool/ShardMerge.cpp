@@ -0,0 +1,78 @@
+#include "tool/ShardMerge.h"
+#include "FeatureStore.h"
+#include "TensorReader.h"
+
+void tool::merge_shards(const std::vector<std::string> &shard_files, const std::string &output_file)
+{
+	if (shard_files.empty())
+	{
+		throw std::runtime_error("merge_shards: no shard to merge");
+	}
+
+	if (FeatureStoreReader::is_feature_store(shard_files.front()))
+	{
+		FeatureStoreWriter writer;
+		Shape shape;
+		for (const std::string &file : shard_files)
+		{
+			if (!FeatureStoreReader::is_feature_store(file))
+			{
+				throw std::runtime_error("merge_shards: " + file + " is not a feature store");
+			}
+
+			FeatureStoreReader reader(file);
+			// An empty shard is saved with an empty shape, it has nothing to merge.
+			if (reader.size() == 0)
+			{
+				continue;
+			}
+
+			if (!writer.is_open())
+			{
+				shape = reader.shape();
+				writer.open(output_file, shape);
+			}
+			else if (reader.shape() != shape)
+			{
+				throw std::runtime_error("merge_shards: " + file + " has a different shape");
+			}
+
+			while (reader.has_next())
+			{
+				std::pair<std::string, SparseTensor<float>> sample = reader.next_sparse();
+				writer.write(sample.first, sample.second);
+			}
+		}
+
+		if (!writer.is_open())
+		{
+			writer.open(output_file, Shape());
+		}
+		writer.close();
+	}
+	else
+	{
+		TensorReader first(shard_files.front());
+		TensorWriter writer(output_file, first.sparse());
+		first.close();
+
+		for (const std::string &file : shard_files)
+		{
+			TensorReader reader(file);
+			while (reader.has_next())
+			{
+				if (reader.sparse())
+				{
+					std::pair<std::string, SparseTensor<float>> sample = reader.next_sparse();
+					writer.write(sample.first, sample.second);
+				}
+				else
+				{
+					std::pair<std::string, Tensor<float>> sample = reader.next();
+					writer.write(sample.first, sample.second);
+				}
+			}
+		}
+		writer.close();
+	}
+}
@@ -0,0 +1,101 @@
+#include "tool/SnapshotWriter.h"
+#include "tool/Operations.h"
+#include <filesystem>
+
+using namespace tool;
+
+SnapshotWriter::SnapshotWriter() : _thread(), _mutex(), _pending(), _done(), _jobs(), _directories(), _busy(false), _stop(false)
+{
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_pending.notify_one();
+
+	if (_thread.joinable())
+	{
+		_thread.join();
+	}
+}
+
+void SnapshotWriter::save_weights(const std::string &directory, const std::string &file_name, const std::string &label, const Tensor<float> &w)
+{
+	std::string path = directory + file_name;
+	_push(directory, [path, label, w]()
+		  { SaveWeights(path, label, w); });
+}
+
+void SnapshotWriter::draw_weights(const std::string &directory, const std::string &file_name, const Tensor<float> &w)
+{
+	std::string path = directory + file_name;
+	_push(directory, [path, w]()
+		  { Tensor<float>::draw_weight_tensor(path, w); });
+}
+
+void SnapshotWriter::log_spiking_neuron(const std::string &directory, const std::string &file_name, const std::string &label, size_t neuron)
+{
+	std::string path = directory + file_name;
+	_push(directory, [path, label, neuron]()
+		  { LogSpikingNeuron(path, label, neuron); });
+}
+
+void SnapshotWriter::wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this]()
+			   { return _jobs.empty() && !_busy; });
+}
+
+void SnapshotWriter::_push(const std::string &directory, std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.emplace_back(directory, std::move(job));
+
+		// The thread is only started by the layers that actually write something.
+		if (!_thread.joinable())
+		{
+			_thread = std::thread(&SnapshotWriter::_run, this);
+		}
+	}
+	_pending.notify_one();
+}
+
+void SnapshotWriter::_run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_pending.wait(lock, [this]()
+					  { return _stop || !_jobs.empty(); });
+
+		if (_jobs.empty())
+		{
+			break;
+		}
+
+		std::pair<std::string, std::function<void()>> job = std::move(_jobs.front());
+		_jobs.pop_front();
+		_busy = true;
+		bool create_directory = _directories.insert(job.first).second;
+		lock.unlock();
+
+		if (create_directory)
+		{
+			std::filesystem::create_directories(job.first);
+		}
+		job.second();
+
+		lock.lock();
+		_busy = false;
+		if (_jobs.empty())
+		{
+			_done.notify_all();
+		}
+	}
+}